@@ -10,7 +10,7 @@ class PgrEngineConan(ConanFile):
     author = "Your Name"
     
     settings = "os", "compiler", "build_type", "arch"
-    exports_sources = "CMakeLists.txt", "pgr_engine/*", "pgr_editor/*"
+    exports_sources = "CMakeLists.txt", "pgr_engine/*", "pgr_editor/*", "pgr_cook/*"
     
     requires = (
         "glm/0.9.9.8",
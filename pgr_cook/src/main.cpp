@@ -0,0 +1,266 @@
+#include <assets/textures/cubemap.h>
+#include <assets/textures/texture_cooker.h>
+#include <scene/imported_scene.h>
+#include <scene/scene_import.h>
+#include <utility/vfs.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+    // glTF is read in place at runtime, only its images are cooked
+    const std::set<std::string> scene_extensions{".dae", ".obj", ".fbx", ".3ds", ".ply", ".stl"};
+    const std::set<std::string> image_extensions{".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd",
+                                                 ".gif"};
+    // cubemap faces are named like the editor's skyboxes, <name>_<suffix>.<extension>
+    using face_enum_t = pgre::cubemap_texture_t::face_enum_t;
+    const std::map<std::string, face_enum_t> cubemap_face_suffixes{
+      {"_ft", face_enum_t::front}, {"_bk", face_enum_t::back},  {"_dn", face_enum_t::bottom},
+      {"_up", face_enum_t::top},   {"_lf", face_enum_t::left},  {"_rt", face_enum_t::right}};
+
+    constexpr std::string_view usage = R"(Usage: pgre_cook <directory> [options]
+
+Cooks the scenes and images under the directory into the caches next to them, .pgmesh for
+scenes and .pgtex for images, so loading them only reads and uploads. Images are only cooked
+with --compress-textures, .pgtex files hold compressed textures. The six faces of a cubemap,
+named <name>_{ft,bk,up,dn,lf,rt}.<extension>, are cooked together into a single .cube.pgtex
+file. Up to date caches are kept. Scenes have to be imported with the options they were cooked
+with to use the cache.
+
+Options:
+  --force               cook everything again
+  --no-images           only cook scenes
+  --pak <file>          pack all files under the directory into an archive for vfs_t, stored
+                        at their paths relative to the current directory
+  --compress-textures   import_options_t::compress_textures, also cooks the images
+  --atlas               import_options_t::build_texture_atlases
+  --compact             import_options_t::compact_vertices
+  --clusters <count>    import_options_t::cluster_triangle_count
+  --stream              import_options_t::stream_meshes
+  --no-optimize         disable import_options_t::optimize_meshes
+  --no-weld             disable import_options_t::weld_vertices
+  --no-dedup            disable import_options_t::deduplicate_meshes
+)";
+
+    struct cook_settings_t
+    {
+        std::filesystem::path directory{};
+        pgre::scene::import_options_t import_options{};
+        bool cook_images = true;
+        bool force = false;
+        std::filesystem::path pak_path{};
+    };
+
+    /**
+     * @throws std::invalid_argument on unknown or incomplete arguments.
+     */
+    cook_settings_t parse_args(int argc, char** argv) {
+        cook_settings_t settings{};
+        auto& options = settings.import_options;
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{argv[i]};
+            if (arg == "--force") {
+                settings.force = true;
+            } else if (arg == "--no-images") {
+                settings.cook_images = false;
+            } else if (arg == "--pak") {
+                if (++i == argc) throw std::invalid_argument("--pak needs a file");
+                settings.pak_path = argv[i];
+            } else if (arg == "--compress-textures") {
+                options.compress_textures = true;
+            } else if (arg == "--atlas") {
+                options.build_texture_atlases = true;
+            } else if (arg == "--compact") {
+                options.compact_vertices = true;
+            } else if (arg == "--clusters") {
+                if (++i == argc) throw std::invalid_argument("--clusters needs a count");
+                options.cluster_triangle_count = static_cast<uint32_t>(std::stoul(argv[i]));
+            } else if (arg == "--stream") {
+                options.stream_meshes = true;
+            } else if (arg == "--no-optimize") {
+                options.optimize_meshes = false;
+            } else if (arg == "--no-weld") {
+                options.weld_vertices = false;
+            } else if (arg == "--no-dedup") {
+                options.deduplicate_meshes = false;
+            } else if (arg.starts_with("--") || !settings.directory.empty()) {
+                throw std::invalid_argument(fmt::format("Unexpected argument {}", arg));
+            } else {
+                settings.directory = arg;
+            }
+        }
+        if (settings.directory.empty()) throw std::invalid_argument("No directory given");
+        return settings;
+    }
+
+    std::string get_extension(const std::filesystem::path& path) {
+        auto extension = path.extension().string();
+        std::ranges::transform(extension, extension.begin(),
+                               [](unsigned char c) { return std::tolower(c); });
+        return extension;
+    }
+
+    /**
+     * @brief Get the regular files under directory with one of the extensions, sorted.
+     */
+    std::vector<std::filesystem::path> find_files(const std::filesystem::path& directory,
+                                                  const std::set<std::string>& extensions) {
+        std::vector<std::filesystem::path> files{};
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+            if (entry.is_regular_file() && extensions.contains(get_extension(entry.path())))
+                files.push_back(entry.path());
+        }
+        std::ranges::sort(files);
+        return files;
+    }
+
+    /**
+     * @brief Packs every file under the directory, except temporaries and archives.
+     */
+    void pack(const cook_settings_t& settings) {
+        std::vector<std::filesystem::path> files{};
+        for (const auto& entry :
+             std::filesystem::recursive_directory_iterator(settings.directory)) {
+            const auto extension = get_extension(entry.path());
+            if (entry.is_regular_file() && extension != ".tmp" && extension != ".pak")
+                files.push_back(entry.path());
+        }
+        std::ranges::sort(files);
+        pgre::pak_archive_t::write(settings.pak_path, {}, files);
+        spdlog::info("Packed {} files into {}", files.size(), settings.pak_path.string());
+    }
+
+    struct cook_stats_t
+    {
+        size_t cooked = 0;
+        size_t up_to_date = 0;
+        size_t failed = 0;
+    };
+
+    void cook_scenes(const cook_settings_t& settings, cook_stats_t& stats) {
+        for (const auto& scene_file : find_files(settings.directory, scene_extensions)) {
+            try {
+                if (settings.force) {
+                    std::filesystem::remove(pgre::scene::imported_scene_t::get_cache_path(
+                      scene_file));
+                }
+                if (pgre::scene::import_job_t::cook(scene_file, settings.import_options)) {
+                    spdlog::info("Cooked {}", scene_file.string());
+                    stats.cooked++;
+                } else {
+                    stats.up_to_date++;
+                }
+            } catch (const std::exception& e) {
+                spdlog::error("Failed to cook {}: {}", scene_file.string(), e.what());
+                stats.failed++;
+            }
+        }
+    }
+
+    /**
+     * @brief Groups the complete sets of six cubemap faces among images, in GL face order, and
+     * removes them from images.
+     */
+    std::vector<std::vector<std::filesystem::path>>
+      take_cubemaps(std::vector<std::filesystem::path>& images) {
+        std::map<std::filesystem::path, std::unordered_map<face_enum_t, std::string>> cubemaps{};
+        for (const auto& image : images) {
+            const auto stem = image.stem().string();
+            if (stem.size() < 3) continue;
+            auto face = cubemap_face_suffixes.find(stem.substr(stem.size() - 3));
+            if (face == cubemap_face_suffixes.end()) continue;
+            auto name = image.parent_path() / stem.substr(0, stem.size() - 3);
+            name += image.extension();
+            cubemaps[name].emplace(face->second, image.string());
+        }
+
+        std::vector<std::vector<std::filesystem::path>> face_sources{};
+        for (const auto& [name, paths] : cubemaps) {
+            if (paths.size() != cubemap_face_suffixes.size()) continue;
+            face_sources.push_back(pgre::cubemap_texture_t::get_face_sources(paths));
+            std::erase_if(images, [&paths](const auto& image) {
+                return std::ranges::any_of(paths, [&image](const auto& face) {
+                    return image == face.second;
+                });
+            });
+        }
+        return face_sources;
+    }
+
+    void cook_image(const std::vector<std::filesystem::path>& face_sources,
+                    const cook_settings_t& settings, cook_stats_t& stats) {
+        const auto& first_face = face_sources.front();
+        try {
+            const auto cache_path
+              = pgre::texture_cooker_t::get_cache_path(first_face, face_sources.size());
+            if (settings.force) std::filesystem::remove(cache_path);
+            if (pgre::texture_cooker_t::is_cache_up_to_date(face_sources)) {
+                stats.up_to_date++;
+                return;
+            }
+            // not load_or_cook, which only warns when the cache can't be written
+            pgre::texture_cooker_t::cook(face_sources).write(cache_path);
+            spdlog::info("Cooked {}", first_face.string());
+            stats.cooked++;
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to cook {}: {}", first_face.string(), e.what());
+            stats.failed++;
+        }
+    }
+
+    void cook_images(const cook_settings_t& settings, cook_stats_t& stats) {
+        // after the scenes, so the atlases they wrote are cooked too
+        auto images = find_files(settings.directory, image_extensions);
+        for (const auto& face_sources : take_cubemaps(images)) {
+            cook_image(face_sources, settings, stats);
+        }
+        for (const auto& image : images) {
+            cook_image({image}, settings, stats);
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::level_enum::info);
+    cook_settings_t settings{};
+    try {
+        settings = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        spdlog::error(e.what());
+        fmt::print(stderr, "{}", usage);
+        return 2;
+    }
+    if (!std::filesystem::is_directory(settings.directory)) {
+        spdlog::error("{} isn't a directory", settings.directory.string());
+        return 2;
+    }
+
+    cook_stats_t stats{};
+    try {
+        cook_scenes(settings, stats);
+        // uncompressed textures are decoded from their sources at runtime
+        if (settings.cook_images && settings.import_options.compress_textures) {
+            cook_images(settings, stats);
+        } else if (settings.cook_images) {
+            spdlog::info("Images are only cooked with --compress-textures.");
+        }
+        if (!settings.pak_path.empty()) pack(settings);
+    } catch (const std::runtime_error& e) {
+        spdlog::error(e.what());
+        return 1;
+    }
+    spdlog::info("{} cooked, {} up to date, {} failed.", stats.cooked, stats.up_to_date,
+                 stats.failed);
+    return stats.failed == 0 ? 0 : 1;
+}
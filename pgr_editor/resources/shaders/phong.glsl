@@ -1,24 +1,12 @@
 shader::fragment {
 #version 410
-
-struct Material {      // structure that describes currently used material
-  vec3  ambient;       // ambient component
-  vec3  diffuse;       // diffuse component
-  vec3  specular;      // specular component
-  float shininess;     // sharpness of specular reflection
-  float opacity;
-
-  bool use_texture;    // defines whether the texture is used or not
-  float tex_coord_anim_speed;  
-  bool spritesheet;
-  float spritesheet_frame_duration;
-  ivec2 spritesheet_dims;
-};
+// USE_TEXTURE, SPRITESHEET, TEXTURE_ARRAY, FOG, REVERSE_PERSPECTIVE and INSTANCED are defined per
+// variant by phong_material_t
+shader::defines
 
 struct FogSettings {
   vec4 color;
   float density;
-  bool enable;
 };
 
 struct PointLight {
@@ -63,11 +51,43 @@ uniform mat4 view_matrix;
 // uniform mat4 model_matrix;
 uniform mat4 normal_matrix;  // inverse transposed model_matrix
 
+#ifdef USE_TEXTURE
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray color_tex_sampler;
+#else
 uniform sampler2D color_tex_sampler;
+#endif
 uniform double time;
+#endif
 
-uniform Material material;
+// per-material parameters, must match phong_material_t::material_block_t
+struct Material {
+  vec3  ambient;       // ambient component
+  float shininess;     // sharpness of specular reflection
+  vec3  diffuse;       // diffuse component
+  float opacity;
+  vec3  specular;      // specular component
+  float tex_coord_anim_speed;
+  ivec2 spritesheet_dims;
+  float spritesheet_frame_duration;
+  float texture_layer;
+};
+#ifdef INSTANCED
+// must match phong_material_t::max_instance_count
+#define MAX_INSTANCES 64
+layout(std140) uniform InstanceMaterialBlock {
+  Material instance_materials[MAX_INSTANCES];
+};
+flat in int v_instance;
+#define material instance_materials[v_instance]
+#else
+layout(std140) uniform MaterialBlock {
+  Material material;
+};
+#endif
+#ifdef FOG
 uniform FogSettings fog;
+#endif
     
 smooth in vec2 v_tex_coord;
 smooth in vec3 v_position_cam;
@@ -81,11 +101,13 @@ float calc_dist_attenuation(vec3 light_att, float dist_to_light) {
         + light_att[2] * pow(dist_to_light, 2));
 }
 
+#ifdef FOG
 vec4 add_fog(vec4 color) {
     float fog_factor = (fog.density* distance(vec3(0), v_position_cam))/100000;
     return mix(clamp(color, 0.0, 1.0), fog.color, clamp(fog_factor, 0.0, 1.0));
     // return vec4(vec3(distance(vec3(0), v_position_cam)/1000), 1);
 }
+#endif
 
 vec3 calc_point_l(PointLight light, vec3 ver_pos_cam, vec3 ver_normal_cam){
     vec3 light_pos_cam = (view_matrix * vec4(light.position, 1.0)).xyz;
@@ -164,61 +186,102 @@ void main() {
   }
   output_color = vec4(color, material.opacity);
 
-  if(material.use_texture) {
-    vec2 tex_coord = v_tex_coord;
-    tex_coord.x += float(time * material.tex_coord_anim_speed);
-    tex_coord.y += float(time * material.tex_coord_anim_speed);
-
-    if (material.spritesheet) {
-        vec2 offset = vec2(1.0) / vec2(material.spritesheet_dims);
-        int frame = int(time / material.spritesheet_frame_duration);
-        vec2 tmp = tex_coord / vec2(material.spritesheet_dims);
-        tex_coord
-          = tmp
-            + vec2(frame % material.spritesheet_dims.x,
-                   material.spritesheet_dims.y - 1 - (frame / material.spritesheet_dims.x))
-                * offset;
-    }
-    output_color *= texture(color_tex_sampler, tex_coord);
-  }
-  if(fog.enable) {
-    output_color = add_fog(output_color);
-  }
+#ifdef USE_TEXTURE
+  vec2 tex_coord = v_tex_coord;
+#ifdef SPRITESHEET
+  vec2 offset = vec2(1.0) / vec2(material.spritesheet_dims);
+  int frame = int(time / material.spritesheet_frame_duration);
+  vec2 tmp = tex_coord / vec2(material.spritesheet_dims);
+  tex_coord
+    = tmp
+      + vec2(frame % material.spritesheet_dims.x,
+             material.spritesheet_dims.y - 1 - (frame / material.spritesheet_dims.x))
+          * offset;
+#else
+  tex_coord.x += float(time * material.tex_coord_anim_speed);
+  tex_coord.y += float(time * material.tex_coord_anim_speed);
+#endif
+#ifdef TEXTURE_ARRAY
+  output_color *= texture(color_tex_sampler, vec3(tex_coord, material.texture_layer));
+#else
+  output_color *= texture(color_tex_sampler, tex_coord);
+#endif
+#endif
+#ifdef FOG
+  output_color = add_fog(output_color);
+#endif
 }
 } shader::fragment
 
 shader::vertex {
 #version 410
+shader::defines
 
 layout (location = 0) in vec3 position;           // vertex position in world space
 layout (location = 1) in vec3 normal;             // vertex normal
 layout (location = 2) in vec2 tex_coord;          // incoming texture coordinates
 
+#ifdef INSTANCED
+// must match phong_material_t::instance_matrices_t and max_instance_count
+#define MAX_INSTANCES 64
+struct InstanceMatrices {
+  mat4 pvm_matrix;
+  mat4 vm_matrix;
+  mat4 v_normal_matrix;
+};
+layout(std140) uniform InstanceBlock {
+  InstanceMatrices instances[MAX_INSTANCES];
+};
+flat out int v_instance;
+#define pvm_matrix instances[gl_InstanceID].pvm_matrix
+#define vm_matrix instances[gl_InstanceID].vm_matrix
+#define v_normal_matrix instances[gl_InstanceID].v_normal_matrix
+#else
 uniform mat4 pvm_matrix; 
 uniform mat4 vm_matrix;
 uniform mat4 v_normal_matrix; 
-uniform bool reverse_perspective;
+#endif
+
+// non-zero for compact vertices, whose normals are octahedral encoded in normal.xy and have to
+// be scaled like the positions before the normal matrix, see phong_material_t::set_vertex_format
+uniform vec3 compact_normal_scale;
 
 smooth out vec2 v_tex_coord;  // texture coordinates
 smooth out vec3 v_position_cam;   // fragment coordinates
 smooth out vec3 v_normal_cam;
 
+vec3 decode_octahedral(vec2 octahedral) {
+  vec3 direction = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+  // unfold the lower half folded over the diagonals
+  float fold = max(-direction.z, 0.0);
+  direction.xy -= fold * sign(direction.xy + vec2(1e-20));
+  return normalize(direction);
+}
+
+vec3 get_normal() {
+  if (compact_normal_scale == vec3(0.0)) return normal;
+  return decode_octahedral(normal.xy) * compact_normal_scale;
+}
+
 void main() {
-  if (!reverse_perspective) {
-    gl_Position = pvm_matrix * vec4(position, 1);
-  } else {
-    mat4 scale;
-    float scale_factor = 1.F;
-    scale[0].x = scale_factor;
-    scale[1].y = scale_factor;
-    scale[2].z = scale_factor;
-    scale[3].w = 1;
-    gl_Position = pvm_matrix * scale * vec4(position, 1);
-    gl_Position.w = 1500 - gl_Position.w;
-  } 
+#ifndef REVERSE_PERSPECTIVE
+  gl_Position = pvm_matrix * vec4(position, 1);
+#else
+  mat4 scale;
+  float scale_factor = 1.F;
+  scale[0].x = scale_factor;
+  scale[1].y = scale_factor;
+  scale[2].z = scale_factor;
+  scale[3].w = 1;
+  gl_Position = pvm_matrix * scale * vec4(position, 1);
+  gl_Position.w = 1500 - gl_Position.w;
+#endif
 
   v_tex_coord = tex_coord;
   v_position_cam = (vm_matrix * vec4(position, 1)).xyz;
-  v_normal_cam = (v_normal_matrix * vec4(normal, 0)).xyz;
+  v_normal_cam = (v_normal_matrix * vec4(get_normal(), 0)).xyz;
+#ifdef INSTANCED
+  v_instance = gl_InstanceID;
+#endif
 }
 } shader::vertex
@@ -1,4 +1,5 @@
 #include <components/all_components.h>
+#include <assets/asset_registry.h>
 #include "component_gui.h"
 
 namespace c = pgre::component;
@@ -67,16 +68,17 @@ bool component_gui_t::gui_impl(c::mesh_t& comp) {
         ImGui::Text("%s", fmt::format("Vertex Buffers: {}; Has Index Buffer: {}",
                                       vertex_buffers.size(), index_buffer ? "True" : "False")
                             .c_str());
-        if (index_buffer) ImGui::Text("Index Buffer Count: %i", index_buffer->get_count());
+        if (index_buffer) ImGui::Text("Index Buffer Count: %i", comp.v_array->get_index_count());
         for (size_t i = 0; i < vertex_buffers.size(); i++) {
             ImGui::Text("VBO[%zu] Count: %i", i, vertex_buffers[i].first->get_count());
         }
         ImGui::TreePop();
     }
     if (ImGui::TreeNode("Material")) {
-        if (auto material = std::dynamic_pointer_cast<pgre::phong_material_t>(comp.material);
+        if (auto* material
+            = comp.material ? std::get_if<pgre::phong_material_t>(&*comp.material) : nullptr;
             material) {
-            ImGui::Text("In use by ~%li meshes", material.use_count()-1);
+            ImGui::Text("In use by %u meshes", comp.material.use_count());
             if (ImGui::SmallButton("Make instance unique")) {
                 comp.realize_material_instance();
                 ImGui::TreePop();
@@ -115,8 +117,14 @@ bool component_gui_t::gui_impl(c::mesh_t& comp) {
             } else {
                 ImGui::InputString("Texture path", &tex_path);
                 if (!tex_path.empty() && std::filesystem::is_regular_file(tex_path) && ImGui::Button("Add Texture")) {
-                    material->_color_texture
-                      = std::make_shared<pgre::texture2D_t>(std::filesystem::absolute(tex_path).string());
+                    // loads in the background, the material keeps rendering untextured until then
+                    pgre::spawn([](pgre::material_ref_t material_ref,
+                                   std::filesystem::path path) -> pgre::task_t<> {
+                        auto texture = co_await pgre::asset_registry_t::get().load_texture2D(
+                          std::move(path));
+                        if (auto* phong = std::get_if<pgre::phong_material_t>(&*material_ref))
+                            phong->_color_texture = std::move(texture);
+                    }(comp.material, std::filesystem::absolute(tex_path)));
                 }
             }
         } else {
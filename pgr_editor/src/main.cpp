@@ -1,6 +1,8 @@
 #include <spdlog/spdlog.h>
 
 #include <app.h>
+#include <scene/hot_reloader.h>
+#include <utility/vfs.h>
 
 
 #include "scene_gui.h"
@@ -10,7 +12,14 @@
 int main() {
     // spdlog::set_level(spdlog::level::warn);
     try {
+        // assets packed with pgre_cook --pak are read from the archive
+        if (std::filesystem::is_regular_file("assets.pak")) pgre::vfs_t::get().mount("assets.pak");
         pgre::app_t app(1280, 720, "PGR\"E\" Editor", false);
+        // edited textures and models show up in the open scene
+        for (const auto* directory : {"assets", "resources"}) {
+            if (std::filesystem::is_directory(directory))
+                pgre::scene::hot_reloader_t::get().watch(directory);
+        }
         spdlog::set_level(spdlog::level::level_enum::warn);
         std::shared_ptr<pgre::scene::scene_t> scene{};
         auto scene_l = std::make_shared<scene_layer_t>(scene);
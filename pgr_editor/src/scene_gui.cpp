@@ -1,6 +1,8 @@
 #include <imgui_helpers.h>
 #include <components/all_components.h>
 #include <renderer/renderer.h>
+#include <assets/textures/mip_streamer.h>
+#include <algorithm>
 #include <limits>
 
 #include "scene_layer.h"
@@ -73,6 +75,19 @@ void scene_gui_layer_t::scene_window() {
             selected_entity = new_entity;
         }
     };
+    std::erase_if(imports, [this](auto& import) {
+        auto& [job, parent] = import;
+        if (!job->is_done()) {
+            // imports into a scene that was replaced since are never continued
+            const auto& running = _scene_layer->scene->get_imports();
+            return std::ranges::find(running, job) == running.end();
+        }
+        // the parent may have been deleted while the import was running
+        if (auto root = job->get_root(); root && parent && parent->is_valid()) {
+            parent->add_child(*root);
+        }
+        return true;
+    });
     ImGui::Begin("Scene");
     auto top_level_entities = _scene_layer->scene->get_top_level_entities();
     for (auto& entity : top_level_entities) {
@@ -89,15 +104,35 @@ void scene_gui_layer_t::scene_window() {
     if (ImGui::TreeNode("Import")) {
         ImGui::Text("The file may contain a full 3D scene including lights, meshes. Embedded"
                     "textures, cameras, and many other things\nare not yet supported...");
-        ImGui::InputString("3D file path (e.g. Collada)", &import_file_path);
+        ImGui::InputString("3D file path (e.g. Collada, glTF)", &import_file_path);
+        ImGui::Checkbox("Build texture atlases", &import_options.build_texture_atlases);
+        ImGui::Checkbox("Compress textures", &import_options.compress_textures);
+        ImGui::Checkbox("Optimize meshes", &import_options.optimize_meshes);
+        ImGui::Checkbox("Compact vertices", &import_options.compact_vertices);
+        ImGui::Checkbox("Weld vertices", &import_options.weld_vertices);
+        if (import_options.weld_vertices) {
+            ImGui::InputFloat("Position epsilon", &import_options.weld_position_epsilon, 0.0f,
+                              0.0f, "%g");
+            ImGui::InputFloat("Normal epsilon", &import_options.weld_normal_epsilon, 0.0f, 0.0f,
+                              "%g");
+            ImGui::InputFloat("UV epsilon", &import_options.weld_uv_epsilon, 0.0f, 0.0f, "%g");
+        }
+        ImGui::Checkbox("Deduplicate meshes", &import_options.deduplicate_meshes);
+        ImGui::InputScalar("Cluster triangles (0 = off)", ImGuiDataType_U32,
+                           &import_options.cluster_triangle_count);
+        ImGui::Checkbox("Stream meshes through cache", &import_options.stream_meshes);
         if (std::filesystem::is_regular_file(import_file_path)) {
             if (ImGui::SmallButton("Import...")) {
-                auto new_node = _scene_layer->import_objects(import_file_path);
-                if (new_node) parent_to_selected(new_node.value());
+                imports.emplace_back(_scene_layer->import_objects(import_file_path, import_options),
+                                     selected_entity);
             }
         } else {
             pgre::imgui::colored_component_255(ImGui::Text, {200, 0, 0, 255}, "File doesn't exist");
         }
+        for (const auto& [job, parent] : imports) {
+            ImGui::ProgressBar(job->get_progress(), ImVec2{0, 0},
+                               job->get_scene_file().filename().string().c_str());
+        }
         ImGui::TreePop();
     }
     ImGui::Separator();
@@ -118,6 +153,18 @@ void scene_gui_layer_t::scene_window() {
     ImGui::Checkbox("Reverse Perspective", &_reverse_perspective);
     pgre::phong_material_t::set_reverse_perspective_enabled(_reverse_perspective);
 
+    ImGui::Checkbox("Texture Arrays", &_texture_arrays);
+    pgre::phong_material_t::set_texture_arrays_enabled(_texture_arrays);
+
+    ImGui::Checkbox("Mip Streaming", &_mip_streaming);
+    pgre::mip_streamer_t::set_enabled(_mip_streaming);
+    auto& mip_streamer = pgre::mip_streamer_t::get();
+    if (ImGui::SliderInt("Texture Budget (MiB)", &_texture_budget_mib, 16, 4096)) {
+        mip_streamer.set_budget(static_cast<size_t>(_texture_budget_mib) * 1024 * 1024);
+    }
+    ImGui::Text("Streamed textures: %.1f MiB",
+                static_cast<double>(mip_streamer.get_resident_bytes()) / (1024.0 * 1024.0));
+
     if (ImGui::SmallButton("Recompile Shaders")) {
         try {
             pgre::renderer::recompile_shaders();
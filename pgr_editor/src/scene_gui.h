@@ -12,6 +12,9 @@ class scene_gui_layer_t : public pgre::layers::imgui_layer_t
 {
     bool hidden = false;
     bool _reverse_perspective = false;
+    bool _texture_arrays = false;
+    bool _mip_streaming = true;
+    int _texture_budget_mib = 256;
     
     std::shared_ptr<scene_layer_t> _scene_layer;
     kframe_animator_gui_t kframe_animator_gui{};
@@ -20,6 +23,13 @@ class scene_gui_layer_t : public pgre::layers::imgui_layer_t
     
     std::string scene_file_path{};
     std::string import_file_path{};
+    pgre::scene::import_options_t import_options{};
+    /**
+     * @brief Running imports, with the entity to parent their root to.
+     */
+    std::vector<std::pair<std::shared_ptr<pgre::scene::import_job_t>,
+                          std::optional<pgre::scene::entity_t>>>
+      imports{};
     std::string texture_file_path{};
     std::string skybox_name{};
 
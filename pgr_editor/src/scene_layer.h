@@ -8,11 +8,13 @@
 #include <primitives/vertex_array.h>
 #include <events/keyboard_events.h>
 #include <input/keyboard.h>
+#include <assets/asset_registry.h>
 #include <assets/textures/texture2d.h>
 #include <assets/materials/phong_material.h>
 #include <renderer/camera.h>
 #include <scene/scene.h>
 #include <scene/entity.h>
+#include <utility/task.h>
 
 #include <components/all_components.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -64,8 +66,8 @@ public:
         return scene->import_from_file("resources/test_cubes/scene.dae").value();
     }
 
-    auto import_objects(const std::string& path){
-        return scene->import_from_file(path);
+    auto import_objects(const std::string& path, const pgre::scene::import_options_t& options = {}){
+        return scene->import_from_file_async(path, options);
     }
 
     void open_scene(const std::string& path_s) {
@@ -102,12 +104,26 @@ public:
             {face::right, fmt::format("assets/skyboxes/{}_rt.{}", cubemap_name, ext)},
             {face::left, fmt::format("assets/skyboxes/{}_lf.{}", cubemap_name, ext)}
         };
-        auto skybox_entity = scene->create_entity(cubemap_name + "_skybox");
-        auto texture = std::make_shared<pgre::cubemap_texture_t>(paths, GL_NEAREST);
-        auto skybox_material = std::make_shared<pgre::skybox_material_t>(texture);
-        skybox_entity.add_component<pgre::component::mesh_t>(pgre::builtin_meshes::get_cube_vao(skybox_material), skybox_material);
-        skybox_entity.get_component<pgre::component::transform_t>().set_orientation_euler({-90, 0, 0});
-        entity.add_child(skybox_entity);
+        // cooked once into a single compressed file, the skybox is added once it's uploaded
+        pgre::spawn([](std::weak_ptr<pgre::scene::scene_t> weak_scene, entt::entity parent_handle,
+                       std::string name,
+                       std::unordered_map<face, std::string> face_paths) -> pgre::task_t<> {
+            auto texture = co_await pgre::asset_registry_t::get().load_cubemap(
+              std::move(face_paths), GL_NEAREST, GL_LINEAR_MIPMAP_LINEAR, true);
+            auto loaded_scene = weak_scene.lock();
+            if (!loaded_scene) co_return;
+            auto parent = loaded_scene->get_entity_helper(parent_handle);
+            if (!parent.is_valid()) co_return;
+
+            auto skybox_entity = loaded_scene->create_entity(name + "_skybox");
+            auto skybox_material = pgre::make_material<pgre::skybox_material_t>(texture);
+            skybox_entity.add_component<pgre::component::mesh_t>(
+              pgre::builtin_meshes::get_cube_vao(pgre::skybox_material_t::get_shader_s()),
+              skybox_material);
+            skybox_entity.get_component<pgre::component::transform_t>().set_orientation_euler(
+              {-90, 0, 0});
+            parent.add_child(skybox_entity);
+        }(scene, entity.get_handle(), cubemap_name, std::move(paths)));
     }
 
     void create_scene(){
@@ -0,0 +1,94 @@
+#pragma once
+#include <assets/asset_table.h>
+#include <assets/materials/all_materials.h>
+#include <primitives/vertex_array.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <cereal/archives/adapters.hpp>
+
+namespace pgre {
+
+/**
+ * @brief Assets of one type referenced by a serialized scene, written once each, ahead of the
+ * components, which refer to them by their index in the list.
+ */
+template<typename AssetTy>
+class asset_list_t
+{
+    std::vector<asset_ref_t<AssetTy>> _refs{};
+    /**
+     * @brief Index in _refs by handle value.
+     */
+    std::unordered_map<uint32_t, uint32_t> _indices{};
+
+public:
+    /**
+     * @brief Index written for null refs.
+     */
+    constexpr static uint32_t null_index = UINT32_MAX;
+
+    /**
+     * @brief Adds the asset unless it's already in the list.
+     */
+    void add(const asset_ref_t<AssetTy>& ref) {
+        if (!ref) return;
+        auto [it, inserted] = _indices.try_emplace(ref.get_handle().get_value(),
+                                                   static_cast<uint32_t>(_refs.size()));
+        if (inserted) _refs.push_back(ref);
+    }
+
+    [[nodiscard]] uint32_t get_index(const asset_ref_t<AssetTy>& ref) const {
+        if (!ref) return null_index;
+        auto it = _indices.find(ref.get_handle().get_value());
+        debug_assert(it != _indices.end(), "Serialized asset missing from the asset list.");
+        return it->second;
+    }
+
+    [[nodiscard]] asset_ref_t<AssetTy> get_ref(uint32_t index) const {
+        if (index == null_index) return {};
+        debug_assert(index < _refs.size(), "Asset index out of range.");
+        return _refs[index];
+    }
+
+    [[nodiscard]] auto begin() const { return _refs.cbegin(); }
+    [[nodiscard]] auto end() const { return _refs.cend(); }
+
+    template<class Archive>
+    void save(Archive& archive) const {
+        archive(static_cast<uint32_t>(_refs.size()));
+        for (const auto& ref : _refs) archive(*ref);
+    }
+
+    template<class Archive>
+    void load(Archive& archive) {
+        uint32_t count{};
+        archive(count);
+        _refs.clear();
+        _indices.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            auto ref = asset_table_t<AssetTy>::get().create();
+            archive(*ref);
+            _indices.emplace(ref.get_handle().get_value(), i);
+            _refs.push_back(std::move(ref));
+        }
+    }
+};
+
+/**
+ * @brief User data of the archives scenes are serialized with (see cereal::UserDataAdapter),
+ * components get it using cereal::get_user_data to translate asset refs to list indices.
+ */
+struct asset_archive_context_t
+{
+    asset_list_t<primitives::vertex_array_t> vertex_arrays{};
+    asset_list_t<material_variant_t> materials{};
+
+    template<class Archive>
+    void serialize(Archive& archive) {
+        archive(vertex_arrays, materials);
+    }
+};
+
+} // namespace pgre
@@ -0,0 +1,185 @@
+#pragma once
+#include <assets/asset_table.h>
+#include <assets/textures/cubemap.h>
+#include <assets/textures/texture2d.h>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+
+namespace pgre {
+
+/**
+ * @brief Deduplicates assets by key, keys of assets loaded from files are built from the
+ * content hash of the files, so the same file reached through different paths (or a copy of
+ * it) is loaded once. Only weak references are held, assets are freed once unused. Assets
+ * managed by shared_ptr and assets in an asset_table_t (held by handle) are kept apart.
+ *
+ * Not thread safe, use from the GL thread, except for get_file_key().
+ */
+class asset_registry_t
+{
+    struct file_hash_t
+    {
+        std::filesystem::file_time_type write_time;
+        uintmax_t size;
+        uint64_t hash;
+    };
+
+    struct handle_entry_t
+    {
+        uint32_t handle;
+        /**
+         * @brief asset_table_t<AssetTy>::contains for the type the handle belongs to.
+         */
+        bool (*is_alive)(uint32_t handle);
+    };
+
+    std::map<std::pair<std::type_index, std::string>, std::weak_ptr<void>> _assets{};
+    std::map<std::pair<std::type_index, std::string>, handle_entry_t> _handles{};
+    /**
+     * @brief Content hashes by canonical path, recomputed when the file changes.
+     */
+    std::map<std::filesystem::path, file_hash_t> _file_hashes{};
+    std::mutex _file_hashes_mutex{};
+    size_t _insertions_since_sweep{0};
+
+    asset_registry_t() = default;
+
+    void insert(std::type_index type, const std::string& key, std::weak_ptr<void> asset);
+    void insert(std::type_index type, const std::string& key, handle_entry_t asset);
+    [[nodiscard]] std::shared_ptr<void> find(std::type_index type, const std::string& key) const;
+    [[nodiscard]] uint32_t find_handle(std::type_index type, const std::string& key) const;
+    /**
+     * @brief Drops expired entries once in a while, so the maps don't grow with every freed
+     * asset.
+     */
+    void sweep();
+
+    std::string make_texture2D_key(const std::filesystem::path& path, GLint upscaling_algo,
+                                   GLint downscaling_algo, bool compressed);
+    std::string make_cubemap_key(
+      const std::unordered_map<cubemap_texture_t::face_enum_t, std::string>& paths,
+      GLint upscaling_algo, GLint downscaling_algo, bool compressed);
+
+public:
+    asset_registry_t(const asset_registry_t&) = delete;
+    asset_registry_t& operator=(const asset_registry_t&) = delete;
+
+    static asset_registry_t& get();
+
+    /**
+     * @brief Get a key identifying the contents of a file, based on a hash of its contents,
+     * which is cached until the file is modified. Files in archives mounted in vfs_t use the
+     * hash stored in the archive. Falls back to the canonical path if the file can't be read.
+     * Thread safe, the hash is computed on the calling thread.
+     */
+    std::string get_file_key(const std::filesystem::path& path);
+
+    /**
+     * @brief Get the asset registered under key, or create and register it if there's none or
+     * it was already freed.
+     *
+     * @param key key unique among assets of type AssetTy
+     * @param create callable returning std::shared_ptr<AssetTy>
+     */
+    template<typename AssetTy, typename CreateFuncTy>
+    std::shared_ptr<AssetTy> get_or_create(const std::string& key, CreateFuncTy&& create) {
+        if (auto asset = find<AssetTy>(key)) return asset;
+        std::shared_ptr<AssetTy> asset = create();
+        insert(typeid(AssetTy), key, asset);
+        return asset;
+    }
+
+    /**
+     * @brief Get the asset registered under key, nullptr if there's none or it was freed.
+     */
+    template<typename AssetTy>
+    [[nodiscard]] std::shared_ptr<AssetTy> find(const std::string& key) const {
+        return std::static_pointer_cast<AssetTy>(find(typeid(AssetTy), key));
+    }
+
+    /**
+     * @brief get_or_create for assets in asset_table_t<AssetTy>.
+     *
+     * @param create callable returning asset_ref_t<AssetTy>
+     */
+    template<typename AssetTy, typename CreateFuncTy>
+    asset_ref_t<AssetTy> get_or_create_ref(const std::string& key, CreateFuncTy&& create) {
+        if (auto asset = find_ref<AssetTy>(key)) return asset;
+        asset_ref_t<AssetTy> asset = create();
+        insert(typeid(AssetTy), key,
+               handle_entry_t{asset.get_handle().get_value(), [](uint32_t handle) {
+                                  return asset_table_t<AssetTy>::get().contains(
+                                    asset_handle_t<AssetTy>::from_value(handle));
+                              }});
+        return asset;
+    }
+
+    /**
+     * @brief find for assets in asset_table_t<AssetTy>, a null ref if there's none or it was
+     * freed.
+     */
+    template<typename AssetTy>
+    [[nodiscard]] asset_ref_t<AssetTy> find_ref(const std::string& key) const {
+        return asset_table_t<AssetTy>::get().lock(
+          asset_handle_t<AssetTy>::from_value(find_handle(typeid(AssetTy), key)));
+    }
+
+    /**
+     * @brief Loads a texture, see texture2D_t::texture2D_t, or returns an already loaded one
+     * with the same contents and parameters.
+     */
+    std::shared_ptr<texture2D_t> get_texture2D(const std::filesystem::path& path,
+                                               GLint upscaling_algo = GL_LINEAR,
+                                               GLint downscaling_algo = GL_LINEAR,
+                                               bool compressed = false);
+
+    /**
+     * @brief get_texture2D without blocking the GL thread, the file is hashed and the texture
+     * loaded with texture2D_t::load_async. Start on the GL thread, the task finishes there.
+     */
+    task_t<std::shared_ptr<texture2D_t>> load_texture2D(std::filesystem::path path,
+                                                        GLint upscaling_algo = GL_LINEAR,
+                                                        GLint downscaling_algo = GL_LINEAR,
+                                                        bool compressed = false);
+
+    /**
+     * @brief Loads a cubemap, see cubemap_texture_t::cubemap_texture_t, or returns an already
+     * loaded one with the same contents and parameters.
+     */
+    std::shared_ptr<cubemap_texture_t>
+      get_cubemap(const std::unordered_map<cubemap_texture_t::face_enum_t, std::string>& paths,
+                  GLint upscaling_algo = GL_LINEAR, GLint downscaling_algo = GL_LINEAR,
+                  bool compressed = false);
+
+    /**
+     * @brief get_cubemap without blocking the GL thread, see load_texture2D and
+     * cubemap_texture_t::load_async.
+     */
+    task_t<std::shared_ptr<cubemap_texture_t>>
+      load_cubemap(std::unordered_map<cubemap_texture_t::face_enum_t, std::string> paths,
+                   GLint upscaling_algo = GL_LINEAR, GLint downscaling_algo = GL_LINEAR,
+                   bool compressed = false);
+
+    /**
+     * @brief Replaces texture by an already loaded equivalent if there is one, otherwise
+     * registers it. For textures created outside the registry, e.g. by deserialization.
+     */
+    void deduplicate(std::shared_ptr<texture2D_t>& texture);
+    void deduplicate(std::shared_ptr<cubemap_texture_t>& texture);
+
+    /**
+     * @brief Reloads the registered textures and cubemaps loaded from a file that changed, in
+     * place, and registers them under the key of the new contents. Textures deduplicated with
+     * one loaded from another path aren't affected.
+     *
+     * @return size_t number of assets reloaded.
+     */
+    size_t reload_file(const std::filesystem::path& path);
+};
+
+} // namespace pgre
@@ -0,0 +1,194 @@
+#pragma once
+#include <error_handling.h>
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace pgre {
+
+template<typename AssetTy>
+class asset_table_t;
+
+/**
+ * @brief 32-bit non-owning reference to an asset in asset_table_t<AssetTy>, an index into the
+ * table and the generation of the slot, which detects use of a freed asset after its slot was
+ * reused. A default constructed handle is null (no slot has generation 0).
+ */
+template<typename AssetTy>
+class asset_handle_t
+{
+    constexpr static uint32_t index_bits = 20;
+    constexpr static uint32_t index_mask = (1U << index_bits) - 1;
+
+    uint32_t _value{0};
+
+public:
+    constexpr static uint32_t max_index = index_mask;
+    constexpr static uint32_t max_generation = (1U << (32 - index_bits)) - 1;
+
+    constexpr asset_handle_t() = default;
+    constexpr asset_handle_t(uint32_t index, uint32_t generation)
+      : _value((generation << index_bits) | index) {}
+
+    /**
+     * @brief Reconstructs a handle from get_value().
+     */
+    constexpr static asset_handle_t from_value(uint32_t value) {
+        asset_handle_t handle{};
+        handle._value = value;
+        return handle;
+    }
+
+    [[nodiscard]] constexpr uint32_t get_index() const { return _value & index_mask; }
+    [[nodiscard]] constexpr uint32_t get_generation() const { return _value >> index_bits; }
+    [[nodiscard]] constexpr uint32_t get_value() const { return _value; }
+
+    constexpr explicit operator bool() const { return _value != 0; }
+    constexpr bool operator==(const asset_handle_t& other) const = default;
+};
+
+/**
+ * @brief Owning reference to an asset in asset_table_t<AssetTy>, the asset is freed when the
+ * last asset_ref_t to it is destroyed. Same size as a handle, the reference count lives in the
+ * table and isn't atomic, so refs must only be copied on the GL thread.
+ */
+template<typename AssetTy>
+class asset_ref_t
+{
+    asset_handle_t<AssetTy> _handle{};
+
+    friend class asset_table_t<AssetTy>;
+
+    explicit asset_ref_t(asset_handle_t<AssetTy> handle) : _handle(handle) {
+        if (_handle) asset_table_t<AssetTy>::get().acquire(_handle);
+    }
+
+public:
+    asset_ref_t() = default;
+    asset_ref_t(const asset_ref_t& other) : asset_ref_t(other._handle) {}
+    asset_ref_t(asset_ref_t&& other) noexcept : _handle(std::exchange(other._handle, {})) {}
+    asset_ref_t& operator=(asset_ref_t other) noexcept {
+        std::swap(_handle, other._handle);
+        return *this;
+    }
+    ~asset_ref_t() { reset(); }
+
+    void reset() {
+        if (_handle) asset_table_t<AssetTy>::get().release(std::exchange(_handle, {}));
+    }
+
+    [[nodiscard]] asset_handle_t<AssetTy> get_handle() const { return _handle; }
+    /**
+     * @brief The reference is invalidated by creating assets of the same type.
+     */
+    AssetTy& operator*() const { return asset_table_t<AssetTy>::get()[_handle]; }
+    AssetTy* operator->() const { return &**this; }
+    [[nodiscard]] uint32_t use_count() const {
+        return _handle ? asset_table_t<AssetTy>::get().get_use_count(_handle) : 0;
+    }
+
+    explicit operator bool() const { return static_cast<bool>(_handle); }
+    bool operator==(const asset_ref_t& other) const = default;
+};
+
+/**
+ * @brief Stores all assets of one type in a contiguous array, addressed by asset_handle_t.
+ * Slots of freed assets are reused, with their generation incremented.
+ *
+ * Not thread safe, use from the GL thread.
+ */
+template<typename AssetTy>
+class asset_table_t
+{
+    std::vector<std::optional<AssetTy>> _assets{};
+    std::vector<uint32_t> _generations{};
+    std::vector<uint32_t> _ref_counts{};
+    std::vector<uint32_t> _free_indices{};
+
+    asset_table_t() = default;
+
+    friend class asset_ref_t<AssetTy>;
+
+    void acquire(asset_handle_t<AssetTy> handle) {
+        debug_assert(contains(handle), "Acquiring an asset that was already freed.");
+        _ref_counts[handle.get_index()]++;
+    }
+
+    void release(asset_handle_t<AssetTy> handle) {
+        debug_assert(contains(handle), "Releasing an asset that was already freed.");
+        const auto index = handle.get_index();
+        if (--_ref_counts[index] != 0) return;
+        // invalidate handles before the destructor runs
+        _generations[index]
+          = _generations[index] == asset_handle_t<AssetTy>::max_generation ? 1
+                                                                           : _generations[index] + 1;
+        _assets[index].reset();
+        _free_indices.push_back(index);
+    }
+
+public:
+    asset_table_t(const asset_table_t&) = delete;
+    asset_table_t& operator=(const asset_table_t&) = delete;
+
+    static asset_table_t& get() {
+        static asset_table_t table{};
+        return table;
+    }
+
+    /**
+     * @brief Constructs an asset from args in a free slot.
+     *
+     * @return asset_ref_t<AssetTy> the only reference to the new asset.
+     */
+    template<typename... ArgTys>
+    asset_ref_t<AssetTy> create(ArgTys&&... args) {
+        uint32_t index{};
+        if (!_free_indices.empty()) {
+            index = _free_indices.back();
+            _assets[index].emplace(std::forward<ArgTys>(args)...);
+            _free_indices.pop_back();
+        } else {
+            if (_assets.size() > asset_handle_t<AssetTy>::max_index)
+                throw std::runtime_error("Asset table is full.");
+            index = static_cast<uint32_t>(_assets.size());
+            _assets.emplace_back(std::in_place, std::forward<ArgTys>(args)...);
+            _generations.push_back(1);
+            _ref_counts.push_back(0);
+        }
+        return asset_ref_t<AssetTy>{asset_handle_t<AssetTy>{index, _generations[index]}};
+    }
+
+    [[nodiscard]] bool contains(asset_handle_t<AssetTy> handle) const {
+        return handle && handle.get_index() < _generations.size()
+               && _generations[handle.get_index()] == handle.get_generation();
+    }
+
+    /**
+     * @brief Get an owning reference to the asset, a null one if it was already freed.
+     */
+    [[nodiscard]] asset_ref_t<AssetTy> lock(asset_handle_t<AssetTy> handle) {
+        return contains(handle) ? asset_ref_t<AssetTy>{handle} : asset_ref_t<AssetTy>{};
+    }
+
+    /**
+     * @brief The reference is invalidated by create().
+     */
+    AssetTy& operator[](asset_handle_t<AssetTy> handle) {
+        debug_assert(contains(handle), "Accessing an asset that was already freed.");
+        return *_assets[handle.get_index()];
+    }
+
+    [[nodiscard]] uint32_t get_use_count(asset_handle_t<AssetTy> handle) const {
+        return contains(handle) ? _ref_counts[handle.get_index()] : 0;
+    }
+
+    /**
+     * @brief Number of live assets.
+     */
+    [[nodiscard]] size_t size() const { return _assets.size() - _free_indices.size(); }
+};
+
+} // namespace pgre
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "skybox_material.h"
+#include "flat_color_material.h"
+#include "phong_material.h"
+
+#include <assets/asset_table.h>
+
+#include <variant>
+
+#include <cereal/types/variant.hpp>
+
+/**
+ * @brief All concrete material types, ordered by material_sort_index (render order).
+ */
+#define PGRE_MATERIAL_TYPES                                                                        \
+    pgre::skybox_material_t, pgre::flat_color_material_t, pgre::phong_material_t
+
+namespace pgre {
+
+/**
+ * @brief Materials are stored by value in one asset table, the alternative index equals
+ * material_sort_index.
+ */
+using material_variant_t = std::variant<PGRE_MATERIAL_TYPES>;
+using material_handle_t = asset_handle_t<material_variant_t>;
+using material_ref_t = asset_ref_t<material_variant_t>;
+
+/**
+ * @brief Creates a MaterialTy constructed from args in the material table.
+ */
+template<typename MaterialTy, typename... ArgTys>
+material_ref_t make_material(ArgTys&&... args) {
+    return asset_table_t<material_variant_t>::get().create(std::in_place_type<MaterialTy>,
+                                                           std::forward<ArgTys>(args)...);
+}
+
+} // namespace pgre
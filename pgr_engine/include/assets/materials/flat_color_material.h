@@ -10,11 +10,12 @@
 
 namespace pgre {
 
-class flat_color_material_t : public material_t
+class flat_color_material_t final : public material_t
 {
     inline static std::unique_ptr<shader_program_t> _shader_program{nullptr};
     glm::vec3 _color{1.0};
 public:
+    constexpr static uint32_t material_sort_index = 1;
 
     /**
      * @brief Must be called once an OpenGL context is setup (but before rendering)
@@ -23,10 +24,10 @@ public:
     static void init();
 
     virtual ~flat_color_material_t() = default;
-    flat_color_material_t() = default;
+    flat_color_material_t() : material_t(material_sort_index) {}
     
     explicit flat_color_material_t(const glm::vec3& color)
-      : _color(color) {}
+      : material_t(material_sort_index), _color(color) {}
 
 
     [[nodiscard]] bool has_transparency() const override {
@@ -58,10 +59,6 @@ public:
         archive(_color);
     }
 
-    inline uint32_t get_material_sort_index() override {
-        return 1;
-    }
-
     inline void set_scene_uniforms(scene::scene_t& scene) override {}
 };
 
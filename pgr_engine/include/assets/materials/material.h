@@ -17,7 +17,18 @@ namespace scene {
 
 class material_t
 {
+    uint32_t _material_sort_index;
+
+protected:
+    /**
+     * @param material_sort_index the concrete material type's position in PGRE_MATERIAL_TYPES,
+     * determines render order.
+     */
+    explicit material_t(uint32_t material_sort_index) : _material_sort_index(material_sort_index) {}
+
 public:
+    virtual ~material_t() = default;
+
     /**
      * @brief Binds the shader, sets texture uniforms, etc.
      */
@@ -25,7 +36,11 @@ public:
     [[nodiscard]] virtual bool has_transparency() const = 0;
     virtual shader_program_t& get_shader() = 0;
     virtual void set_matrices(const glm::mat4& M, const glm::mat4& V, const glm::mat4& P, const glm::mat4& PV) = 0;
-    virtual uint32_t get_material_sort_index() = 0;
+    /**
+     * @brief Non-virtual, the position of the concrete type in PGRE_MATERIAL_TYPES and
+     * material_variant_t.
+     */
+    [[nodiscard]] uint32_t get_material_sort_index() const { return _material_sort_index; }
     virtual void set_scene_uniforms(scene::scene_t& scene) = 0;
 };
 
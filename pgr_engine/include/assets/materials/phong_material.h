@@ -1,6 +1,13 @@
 #pragma once
 
+#include <array>
+#include <optional>
+#include <span>
+
+#include <assets/textures/texture2d_array.h>
+#include <primitives/buffer.h>
 #include <primitives/shader_program.h>
+#include <primitives/vertex_array.h>
 #include "material.h"
 
 #include <cerealization/archive_types.h>
@@ -15,12 +22,19 @@ struct fog_settings_t
     float _density = 200;
 
     void apply_changes() { _settings_updated = true; }
-    void set_uniforms(pgre::shader_program_t& program) {
-        if (!_settings_updated) return;
-        glClearColor(_color.r, _color.g, _color.b, _color.a);
-        program.set_uniform("fog.enable", _enable);
+    /**
+     * @brief Sets fog uniforms for the program, which should be a variant compiled with FOG defined.
+     */
+    void set_uniforms(pgre::shader_program_t& program) const {
         program.set_uniform("fog.color", _color);
         program.set_uniform("fog.density", _density);
+    }
+    /**
+     * @brief Sets the clear color to the fog color if the settings changed since the last call.
+     */
+    void update_clear_color() {
+        if (!_settings_updated) return;
+        glClearColor(_color.r, _color.g, _color.b, _color.a);
         _settings_updated = false;
     }
 
@@ -33,13 +47,108 @@ private:
     bool _settings_updated = true;
 };
 
-class phong_material_t : public material_t
+class phong_material_t final : public material_t
 {
+public:
+    constexpr static uint32_t material_sort_index = 2;
+
+    /**
+     * @brief Bits selecting the shader variant, each corresponds to a define in phong.glsl.
+     */
+    enum variant_flags_t : uint8_t
+    {
+        use_texture_flag = 1U << 0U,
+        spritesheet_flag = 1U << 1U,
+        fog_flag = 1U << 2U,
+        reverse_perspective_flag = 1U << 3U,
+        texture_array_flag = 1U << 4U,
+        instanced_flag = 1U << 5U,
+        variant_count = 1U << 6U
+    };
+
+    /**
+     * @brief Maximum number of instances of a single instanced draw, must match MAX_INSTANCES in
+     * phong.glsl. Their matrices fit in the 16 KiB uniform block size every implementation
+     * supports.
+     */
+    constexpr static uint32_t max_instance_count = 64;
+
+    /**
+     * @brief A draw merged into an instanced one, see draw_instanced.
+     */
+    struct instance_t
+    {
+        const phong_material_t* material;
+        glm::mat4 model_matrix;
+    };
+
+private:
+    /**
+     * @brief std140 layout of the MaterialBlock uniform block in phong.glsl.
+     */
+    struct material_block_t
+    {
+        glm::vec3 ambient{};
+        float shininess{};
+        glm::vec3 diffuse{};
+        float opacity{};
+        glm::vec3 specular{};
+        float tex_coord_anim_speed{};
+        glm::ivec2 spritesheet_dims{};
+        float spritesheet_frame_duration{};
+        float texture_layer{};
+
+        bool operator==(const material_block_t& other) const = default;
+    };
+    static_assert(sizeof(material_block_t) == 64, "material_block_t must match std140 layout");
+
+    /**
+     * @brief std140 layout of an element of the InstanceBlock array in phong.glsl.
+     */
+    struct instance_matrices_t
+    {
+        glm::mat4 pvm_matrix;
+        glm::mat4 vm_matrix;
+        glm::mat4 v_normal_matrix;
+    };
+
+    constexpr static GLuint material_block_binding = 0;
+    constexpr static GLuint instance_block_binding = 1;
+    constexpr static GLuint instance_material_block_binding = 2;
+
     inline static std::unique_ptr<shader_program_t> _shader_program{nullptr};
+    /**
+     * @brief Variants of _shader_program indexed by variant flags, filled in lazily.
+     */
+    inline static std::array<shader_program_t*, variant_count> _variants{};
     inline static fog_settings_t _fog_settings{};
     inline static bool _reverse_perspective;
+    inline static bool _use_texture_arrays = false;
+    /**
+     * @brief Per-instance matrices and material blocks of instanced draws, refilled for each.
+     */
+    inline static std::unique_ptr<primitives::uniform_buffer_t> _instance_buffer{nullptr};
+    inline static std::unique_ptr<primitives::uniform_buffer_t> _instance_material_buffer{nullptr};
     bool _animate_texture_coords = false;
 
+    /**
+     * @brief Created on first use(), reuploaded only when the material parameters change.
+     */
+    std::unique_ptr<primitives::uniform_buffer_t> _uniform_buffer{nullptr};
+    material_block_t _uploaded_block{};
+    /**
+     * @brief Copy of _color_texture in a pooled texture array, only used if texture arrays are
+     * enabled.
+     */
+    std::shared_ptr<texture_array_layer_t> _texture_layer{nullptr};
+
+    [[nodiscard]] material_block_t make_material_block() const;
+    void update_uniform_buffer();
+    void update_texture_layer();
+    void bind_color_texture() const;
+    [[nodiscard]] uint8_t get_variant_flags() const;
+    static shader_program_t& get_variant(uint8_t flags);
+
 public:
     bool spritesheet = false;
     glm::ivec2 spritesheet_dims{};
@@ -60,9 +169,10 @@ public:
     static void init();
 
     virtual ~phong_material_t() = default;
-    phong_material_t() = default;
+    phong_material_t() : material_t(material_sort_index) {}
     phong_material_t(phong_material_t& other)
-      : spritesheet(other.spritesheet),
+      : material_t(material_sort_index),
+        spritesheet(other.spritesheet),
         spritesheet_dims(other.spritesheet_dims),
         spritesheet_fps(other.spritesheet_fps),
         texcoord_anim_speed(other.texcoord_anim_speed),
@@ -73,11 +183,13 @@ public:
         _shininess(other._shininess),
         _transparency(other._transparency),
         _color_texture(other._color_texture) {}
+    phong_material_t(phong_material_t&& other) noexcept = default;
+    phong_material_t& operator=(phong_material_t&& other) noexcept = default;
 
     explicit phong_material_t(const glm::vec3& diffuse_c, const glm::vec3& ambient_c,
                               const glm::vec3& specular_c, float shininess = 0.5f,
                               float transparency = 0.0f)
-      : material_t(),
+      : material_t(material_sort_index),
         _diffuse{diffuse_c},
         _ambient(ambient_c),
         _specular(specular_c),
@@ -89,7 +201,8 @@ public:
                               const glm::vec3& ambient_c = glm::vec3{0.2f},
                               const glm::vec3& specular_c = glm::vec3{1.0f}, float shininess = 0.5f,
                               float transparency = 0.0f)
-      : _color_texture(std::move(color_texture)),
+      : material_t(material_sort_index),
+        _color_texture(std::move(color_texture)),
         _diffuse{diffuse_c},
         _ambient(ambient_c),
         _specular(specular_c),
@@ -97,11 +210,12 @@ public:
         _transparency(transparency) {}
 
     [[nodiscard]] bool has_transparency() const override {
-        return _transparency == 0.0f || _color_texture->has_alpha();
+        return _transparency > 0.0f || (_color_texture && _color_texture->has_alpha());
     }
 
     /**
-     * @brief Set all instance-specific material uniforms, and bind shader program.
+     * @brief Bind shader program and the material's uniform block, reuploading it if any
+     * parameters changed since the last call.
      *
      * @param scene the scene to get lights from.
      */
@@ -109,6 +223,35 @@ public:
 
     void toggle_texture_animation() { _animate_texture_coords = !_animate_texture_coords; }
 
+    /**
+     * @brief Get the key of materials whose draws of the same vertex array can be merged into
+     * one instanced draw, as they use the same shader variant and bind the same texture. Only
+     * materials without a texture, or with their texture in an array, can be instanced, and only
+     * while texture arrays are enabled.
+     *
+     * @return std::optional<uint64_t> the key, nullopt if draws with this material can't be
+     * instanced.
+     */
+    [[nodiscard]] std::optional<uint64_t> get_instancing_key();
+
+    /**
+     * @brief Draws the vertex array once per instance, each with its own material and model
+     * matrix, in as few instanced draws as max_instance_count allows. All instance materials
+     * must have the instancing key of this one. Binds the instanced shader variant, use() has to
+     * be called again before drawing non-instanced.
+     */
+    void draw_instanced(const primitives::vertex_array_t& vao, GLenum primitive,
+                        std::span<const instance_t> instances, const glm::mat4& V,
+                        const glm::mat4& PV) const;
+
+    /**
+     * @brief Reports the color texture to mip_streamer_t as drawn on an object of the given
+     * size.
+     *
+     * @param screen_size projected size of the object in pixels, infinity if unknown.
+     */
+    void request_texture_detail(float screen_size) const;
+
     /**
      * @brief Sets all scene-global uniforms (lights, fog, etc.)
      * Should be called once per frame per scene.
@@ -124,6 +267,13 @@ public:
     void set_matrices(const glm::mat4& M, const glm::mat4& V, const glm::mat4& P,
                       const glm::mat4& PV) override;
 
+    /**
+     * @brief Tells the shader how normals of the vertex array drawn next are encoded. Vertex
+     * arrays with a position transform hold compact vertices, see import_options_t. Call after
+     * use().
+     */
+    void set_vertex_format(const primitives::vertex_array_t& vao) const;
+
     shader_program_t& get_shader() override {
         debug_assert(_shader_program != nullptr, "phong_material_t::init never called");
         return *_shader_program;
@@ -139,6 +289,13 @@ public:
             glDisable(GL_DEPTH_CLAMP);
     }
 
+    /**
+     * @brief If enabled, textures are copied into layers of shared texture arrays (see
+     * texture_array_pool_t), so materials with different textures of the same size and format
+     * bind the same texture.
+     */
+    static void set_texture_arrays_enabled(bool enabled) { _use_texture_arrays = enabled; }
+
     static shader_program_t& get_shader_s() {
         debug_assert(_shader_program != nullptr, "phong_material_t::init never called");
         return *_shader_program;
@@ -150,8 +307,6 @@ public:
                 _fog_settings, _animate_texture_coords, texcoord_anim_speed, spritesheet,
                 spritesheet_dims, spritesheet_fps);
     }
-
-    inline uint32_t get_material_sort_index() override { return 2; }
 };
 
 } // namespace pgre
@@ -10,11 +10,12 @@
 
 namespace pgre {
 
-class skybox_material_t : public material_t
+class skybox_material_t final : public material_t
 {
     inline static std::unique_ptr<shader_program_t> _shader_program{nullptr};
 
 public:
+    constexpr static uint32_t material_sort_index = 0;
 
     std::shared_ptr<cubemap_texture_t> _cubemap_texture;
 
@@ -25,10 +26,10 @@ public:
     static void init();
 
     virtual ~skybox_material_t() = default;
-    skybox_material_t() = default;
+    skybox_material_t() : material_t(material_sort_index) {}
     
     explicit skybox_material_t(std::shared_ptr<cubemap_texture_t> cubemap_texture)
-      : material_t(), _cubemap_texture(std::move(cubemap_texture)) {}
+      : material_t(material_sort_index), _cubemap_texture(std::move(cubemap_texture)) {}
 
 
     [[nodiscard]] bool has_transparency() const override {
@@ -60,10 +61,6 @@ public:
         archive(_cubemap_texture);
     }
 
-    inline uint32_t get_material_sort_index() override {
-        return 0;
-    }
-
     inline void set_scene_uniforms(scene::scene_t& scene) override {
     }
 };
@@ -1,10 +1,14 @@
 #pragma once
 #include "texture.h"
+#include <utility/task.h>
 
 #include <cereal/types/unordered_map.hpp>
 #include <cereal/types/string.hpp>
 
 namespace pgre {
+struct cooked_texture_t;
+struct texture_stream_request_t;
+
 class cubemap_texture_t : public texture_t
 {
 public:
@@ -22,11 +26,23 @@ private:
 
     uint32_t _width{0}, _height{0};
     bool _has_alpha{true};
+    bool _compressed{false};
 
     std::unordered_map<face_enum_t, std::string > _paths;
     int _upscaling_algo{}, _downscaling_algo{};
 
+    /**
+     * @brief Pending texture_streamer_t load, nothing is bound until it's done.
+     */
+    std::shared_ptr<texture_stream_request_t> _stream_request{nullptr};
+
     void load_from_file();
+    void request_streaming();
+    void apply_sampling_parameters() const;
+    /**
+     * @brief Creates the texture object from decoded or cooked faces, in GL face order.
+     */
+    void upload(const cooked_texture_t& cooked);
 
 public:
     cubemap_texture_t() = default;
@@ -38,13 +54,50 @@ public:
      * @param path path to texture file
      * @param upscaling_algo Upscaling algorithm to use, e.g. GL_LINEAR
      * @param downscaling_algo Downscaling algorithm to use, e.g. GL_LINEAR
+     * @param compressed if true, BC1/BC3 compressed faces with full mip chains are loaded from a
+     * single cooked .pgtex file next to the right face, which is (re)created if missing or
+     * outdated. Otherwise the faces are decoded in parallel.
      */
     explicit cubemap_texture_t(std::unordered_map<face_enum_t,std::string> paths, GLint upscaling_algo = GL_LINEAR,
-                               GLint downscaling_algo = GL_LINEAR);
+                               GLint downscaling_algo = GL_LINEAR, bool compressed = false);
+
+    /**
+     * @brief Loads a cubemap without blocking the GL thread, see texture2D_t::load_async. The
+     * cubemap is never streamed.
+     *
+     * @throws image_loading_error from the task if the faces can't be loaded.
+     */
+    static task_t<std::shared_ptr<cubemap_texture_t>>
+      load_async(std::unordered_map<face_enum_t, std::string> paths,
+                 GLint upscaling_algo = GL_LINEAR, GLint downscaling_algo = GL_LINEAR,
+                 bool compressed = false);
+
+    /**
+     * @brief Get the face images ordered by GL face (layer) index, as cooked.
+     */
+    static std::vector<std::filesystem::path>
+      get_face_sources(const std::unordered_map<face_enum_t, std::string>& paths);
 
     [[nodiscard]] bool has_alpha() const { return _has_alpha; }
+    [[nodiscard]] inline bool is_compressed() const { return _compressed; }
+    /**
+     * @brief False while the texture is being streamed in.
+     */
+    [[nodiscard]] inline bool is_resident() const { return _gl_id != 0; }
     [[nodiscard]] inline uint32_t get_width() const { return _width; }
     [[nodiscard]] inline uint32_t get_height() const { return _height; }
+    [[nodiscard]] inline const auto& get_paths() const { return _paths; }
+    [[nodiscard]] inline GLint get_upscaling_mode() const { return _upscaling_algo; }
+    [[nodiscard]] inline GLint get_downscaling_mode() const { return _downscaling_algo; }
+
+    /**
+     * @brief Loads the faces again, after a face file changed, see texture2D_t::reload.
+     *
+     * @return false if a load is already pending.
+     * @throws std::runtime_error if the faces can't be loaded or cooked, the current contents
+     * are kept.
+     */
+    bool reload();
 
     void set_upscaling_mode(GLint upscaling_algo);
     void set_downscaling_mode(GLint downscaling_algo);
@@ -52,11 +105,11 @@ public:
     inline void bind(uint32_t slot) const override {
         // glActiveTexture(GL_TEXTURE0 + slot);
         // glBindTexture(GL_TEXTURE_2D, _gl_id);
-        glBindTextureUnit(slot, _gl_id);
+        glBindTextureUnit(slot, _gl_id); // unbinds the unit while not resident
     }
 
     template<class Archive>
-    void save(Archive& archive) const {
+    void save(Archive& archive, const std::uint32_t /*version*/) const {
         if (_paths.empty())
             throw std::runtime_error(
               "Serialization of cubemaps not loaded from files is not implemented yet.");
@@ -64,16 +117,19 @@ public:
         for (const auto& x: _paths){
             paths[x.first] = std::filesystem::absolute(x.second).string();
         }
-        archive(paths, _upscaling_algo, _downscaling_algo);
+        archive(paths, _upscaling_algo, _downscaling_algo, _compressed);
     }
 
     template<class Archive>
-    void load(Archive& archive) {
-        archive(_paths, _upscaling_algo, _downscaling_algo);
+    void load(Archive& archive, const std::uint32_t /*version*/) {
+        // scenes saved before version 1 have no version to tell them apart, they can't be read
+        archive(_paths, _upscaling_algo, _downscaling_algo, _compressed);
         this->load_from_file();
     }
 };
 } // namespace pgre
 
+CEREAL_CLASS_VERSION(pgre::cubemap_texture_t, 1);
+
 CEREAL_REGISTER_TYPE(pgre::cubemap_texture_t);
 CEREAL_REGISTER_POLYMORPHIC_RELATION(pgre::texture_t, pgre::cubemap_texture_t);
\ No newline at end of file
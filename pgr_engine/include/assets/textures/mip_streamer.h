@@ -0,0 +1,103 @@
+#pragma once
+#include "texture2d.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Keeps only the mip levels of compressed textures that are needed for the size they
+ * appear at on screen resident, within a texture memory budget. Materials report the projected
+ * size of objects using a texture with request() while rendering, update() then reallocates
+ * textures with finer base levels, and evicts the finest levels of the least recently used
+ * textures when over budget.
+ */
+class mip_streamer_t
+{
+    struct entry_t
+    {
+        /**
+         * @brief Finest level needed by any of the draws in the last frame the texture was used.
+         */
+        uint32_t wanted_base_level;
+        uint64_t last_used_frame;
+    };
+
+    inline static bool _enabled = true;
+
+    std::unordered_map<texture2D_t*, entry_t> _textures{};
+    size_t _budget = 256 * 1024 * 1024;
+    size_t _resident_bytes{0};
+    uint64_t _frame{0};
+
+    mip_streamer_t() = default;
+
+    static size_t get_byte_size(const texture2D_t& texture, uint32_t base_level);
+    static uint32_t get_wanted_base_level(const texture2D_t& texture, float screen_size);
+
+    /**
+     * @brief Lowers the detail of textures, least recently used first, until extra_bytes more
+     * fit into the budget. Textures used in the last frame keep the levels they need.
+     *
+     * @return true if extra_bytes fit into the budget.
+     */
+    bool evict(size_t extra_bytes, const std::vector<std::pair<texture2D_t*, entry_t*>>& lru);
+
+public:
+    /**
+     * @brief Textures are never reduced further than the level at which their larger side is at
+     * most this many texels.
+     */
+    constexpr static uint32_t min_resident_size = 64;
+
+    ~mip_streamer_t() = default;
+    mip_streamer_t(const mip_streamer_t&) = delete;
+    mip_streamer_t& operator=(const mip_streamer_t&) = delete;
+
+    static mip_streamer_t& get();
+
+    /**
+     * @brief If disabled, textures are restored to full detail by the next update().
+     */
+    static void set_enabled(bool enabled) { _enabled = enabled; }
+    [[nodiscard]] static bool is_enabled() { return _enabled; }
+
+    /**
+     * @brief Set the maximum number of bytes of texture memory used by streamed mips.
+     */
+    void set_budget(size_t bytes) { _budget = bytes; }
+    [[nodiscard]] size_t get_budget() const { return _budget; }
+    /**
+     * @brief Get the memory used by managed textures as of the last update(), including pending
+     * loads.
+     */
+    [[nodiscard]] size_t get_resident_bytes() const { return _resident_bytes; }
+
+    /**
+     * @brief Get the coarsest base level a width x height texture is reduced to.
+     */
+    static uint32_t get_coarsest_base_level(uint32_t width, uint32_t height);
+
+    /**
+     * @brief Records that texture is drawn this frame on an object covering screen_size pixels.
+     * Textures that aren't mip streamable are ignored.
+     *
+     * @param texture the texture
+     * @param screen_size projected size of the object in pixels, infinity if unknown.
+     */
+    void request(texture2D_t& texture, float screen_size);
+
+    /**
+     * @brief Stops tracking texture, called by texture2D_t on destruction.
+     */
+    void remove(texture2D_t& texture);
+
+    /**
+     * @brief Requests loads and evictions based on the textures used since the last call. Call
+     * once per frame on the GL thread, before texture_streamer_t::pump().
+     */
+    void update();
+};
+
+} // namespace pgre
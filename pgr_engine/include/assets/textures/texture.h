@@ -21,6 +21,34 @@ public:
     explicit image_loading_error(const std::string& err) : std::runtime_error(err) {}
 };
 
+/**
+ * @brief stbi_info of an image opened through vfs_t.
+ *
+ * @return false if the file doesn't exist or isn't a supported image.
+ */
+bool get_image_info(const std::filesystem::path& path, int* width, int* height, int* channels);
+
+/**
+ * @brief stbi_load of an image opened through vfs_t, decoded in place from a mounted archive or
+ * the mapped file. Rows are ordered bottom to top, as OpenGL expects, on any thread.
+ *
+ * @return stbi_uc* pixels to free with stbi_image_free, null on failure.
+ */
+stbi_uc* load_image(const std::filesystem::path& path, int* width, int* height, int* channels,
+                    int desired_channels);
+
+/**
+ * @brief Get the mipmapped equivalent of a GL_TEXTURE_MIN_FILTER value, for textures with more
+ * than one mip level.
+ */
+inline GLint get_mipmap_min_filter(GLint filter) {
+    switch (filter) {
+        case GL_LINEAR: return GL_LINEAR_MIPMAP_LINEAR;
+        case GL_NEAREST: return GL_NEAREST_MIPMAP_NEAREST;
+        default: return filter;
+    }
+}
+
 class texture_t
 {
 protected:
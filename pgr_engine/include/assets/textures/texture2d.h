@@ -1,29 +1,76 @@
 #pragma once
 #include "texture.h"
+#include "texture_cooker.h"
+
+#include <utility/task.h>
 
 namespace pgre {
+struct texture_stream_request_t;
+struct texture_stream_result_t;
+
 class texture2D_t : public texture_t
 {
     uint32_t _width{0}, _height{0};
     bool _has_alpha{true};
+    GLenum _internal_format{GL_RGBA8};
+    uint32_t _level_count{1};
+    /**
+     * @brief Mip level stored in level 0 of the texture object, finer levels aren't resident.
+     * Only compressed textures loaded from file are reallocated with a different base level, by
+     * mip_streamer_t.
+     */
+    uint32_t _base_level{0};
+    /**
+     * @brief Base level the texture will have once the pending load is done.
+     */
+    uint32_t _target_base_level{0};
+    bool _compressed{false};
+    /**
+     * @brief Incremented whenever a reload replaces the contents.
+     */
+    uint32_t _revision{0};
 
     std::filesystem::path _path{};
     int _upscaling_algo{}, _downscaling_algo{};
 
+    /**
+     * @brief Pending texture_streamer_t load, the texture binds a placeholder until it's done.
+     */
+    std::shared_ptr<texture_stream_request_t> _stream_request{nullptr};
+
     void load_from_file();
+    void request_streaming();
+    void on_streamed(const texture_stream_result_t& result);
+    void upload(const cooked_texture_t& cooked);
+    void apply_sampling_parameters() const;
+    static uint32_t get_placeholder_gl_id();
 
 public:
     texture2D_t() = default;
     ~texture2D_t() override;
 
     /**
-     * @brief Loads texture from specified file.
+     * @brief Loads texture from specified file. If texture streaming is enabled (see
+     * texture_streamer_t), only the image header is read here and the texture becomes resident
+     * later.
      *
      * @param path path to texture file
      * @param upscaling_algo Upscaling algorithm to use, e.g. GL_LINEAR
      * @param downscaling_algo Downscaling algorithm to use, e.g. GL_LINEAR
+     * @param compressed if true, a BC1/BC3 compressed texture with a full mip chain is loaded
+     * from a cooked .pgtex file next to path, which is (re)created if missing or outdated.
      */
     explicit texture2D_t(const std::string& path, GLint upscaling_algo = GL_LINEAR,
+                         GLint downscaling_algo = GL_LINEAR, bool compressed = false);
+
+    /**
+     * @brief Uploads already cooked texture data.
+     *
+     * @param cooked cooked texture with a single face
+     * @param upscaling_algo Upscaling algorithm to use, e.g. GL_LINEAR
+     * @param downscaling_algo Downscaling algorithm to use, e.g. GL_LINEAR
+     */
+    explicit texture2D_t(const cooked_texture_t& cooked, GLint upscaling_algo = GL_LINEAR,
                          GLint downscaling_algo = GL_LINEAR);
 
     /**
@@ -51,9 +98,72 @@ public:
     explicit texture2D_t(const aiTexel* data, int width, int height,
                          GLint upscaling_algo = GL_LINEAR, GLint downscaling_algo = GL_LINEAR);
 
+    /**
+     * @brief Loads a texture from file without blocking the GL thread, the image is decoded, or
+     * cooked, on a worker thread and uploaded on the GL thread, where the task finishes. The
+     * texture is the same as one constructed from the path, except that it's never streamed.
+     *
+     * @throws image_loading_error from the task if the file can't be loaded.
+     */
+    static task_t<std::shared_ptr<texture2D_t>> load_async(std::filesystem::path path,
+                                                           GLint upscaling_algo = GL_LINEAR,
+                                                           GLint downscaling_algo = GL_LINEAR,
+                                                           bool compressed = false);
+
     [[nodiscard]] bool has_alpha() const { return _has_alpha; }
+    /**
+     * @brief False while the texture is being streamed in.
+     */
+    [[nodiscard]] inline bool is_resident() const { return _gl_id != 0; }
+    /**
+     * @brief Get the width of mip level 0, regardless of the resident levels.
+     */
     [[nodiscard]] inline uint32_t get_width() const { return _width; }
+    /**
+     * @brief Get the height of mip level 0, regardless of the resident levels.
+     */
     [[nodiscard]] inline uint32_t get_height() const { return _height; }
+    [[nodiscard]] inline GLenum get_internal_format() const { return _internal_format; }
+    /**
+     * @brief Get the number of resident mip levels.
+     */
+    [[nodiscard]] inline uint32_t get_level_count() const { return _level_count; }
+    [[nodiscard]] inline uint32_t get_base_level() const { return _base_level; }
+    [[nodiscard]] inline uint32_t get_target_base_level() const { return _target_base_level; }
+    [[nodiscard]] inline bool is_compressed() const { return _compressed; }
+    /**
+     * @brief Only compressed textures loaded from file have cooked mips to reload levels from.
+     */
+    [[nodiscard]] inline bool is_mip_streamable() const {
+        return _compressed && !_path.empty();
+    }
+
+    /**
+     * @brief Reallocates the texture with base_level as its finest level, asynchronously if
+     * texture streaming is enabled. The current levels stay bound until then.
+     *
+     * @return false if a load is already pending, in which case nothing is done.
+     */
+    bool request_base_level(uint32_t base_level);
+    /**
+     * @brief Loads the texture from its file again, after the file changed. The texture2D_t
+     * stays the same, so materials using it pick up the new contents, the current ones stay
+     * bound until then. Asynchronous if texture streaming is enabled.
+     *
+     * @return false if the texture isn't loaded from file or a load is already pending.
+     * @throws image_loading_error if the file can't be loaded, the current contents are kept.
+     */
+    bool reload();
+    /**
+     * @brief Copies of the texture, e.g. in texture arrays, are outdated once this changes.
+     */
+    [[nodiscard]] inline uint32_t get_revision() const { return _revision; }
+    /**
+     * @brief Get the path the texture was loaded from, empty if not loaded from file.
+     */
+    [[nodiscard]] inline const std::filesystem::path& get_path() const { return _path; }
+    [[nodiscard]] inline GLint get_upscaling_mode() const { return _upscaling_algo; }
+    [[nodiscard]] inline GLint get_downscaling_mode() const { return _downscaling_algo; }
 
     void set_upscaling_mode(GLint upscaling_algo);
     void set_downscaling_mode(GLint downscaling_algo);
@@ -61,27 +171,31 @@ public:
     inline void bind(uint32_t slot) const override {
         // glActiveTexture(GL_TEXTURE0 + slot);
         // glBindTexture(GL_TEXTURE_2D, _gl_id);
-        glBindTextureUnit(slot, _gl_id);
+        glBindTextureUnit(slot, is_resident() ? _gl_id : get_placeholder_gl_id());
     }
 
     template<class Archive>
-    void save(Archive& archive) const {
+    void save(Archive& archive, const std::uint32_t /*version*/) const {
         if (_path.empty())
             throw std::runtime_error(
               "Serialization of textures not loaded from file not implemented");
         auto u8str  = _path.u8string();
-        archive(std::string(u8str.begin(), u8str.end()), _upscaling_algo, _downscaling_algo);
+        archive(std::string(u8str.begin(), u8str.end()), _upscaling_algo, _downscaling_algo,
+                _compressed);
     }
 
     template<class Archive>
-    void load(Archive& archive) {
+    void load(Archive& archive, const std::uint32_t version) {
         std::string path;
         archive(path, _upscaling_algo, _downscaling_algo);
+        if (version >= 1) archive(_compressed);
         _path = std::filesystem::path{std::u8string(path.begin(), path.end())};
         this->load_from_file();
     }
 };
 } // namespace pgre
 
+CEREAL_CLASS_VERSION(pgre::texture2D_t, 1);
+
 CEREAL_REGISTER_TYPE(pgre::texture2D_t);
 CEREAL_REGISTER_POLYMORPHIC_RELATION(pgre::texture_t, pgre::texture2D_t);
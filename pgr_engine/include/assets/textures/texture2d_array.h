@@ -0,0 +1,147 @@
+#pragma once
+#include "texture2d.h"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+namespace pgre {
+/**
+ * @brief GL_TEXTURE_2D_ARRAY with full mip chains, whose layers are filled by copying existing 2D
+ * textures of the same size and format. Storage grows (by reallocating and copying) as layers are
+ * added.
+ */
+class texture2D_array_t : public texture_t
+{
+    uint32_t _width, _height;
+    uint32_t _level_count;
+    uint32_t _layer_count{0};
+    GLenum _internal_format;
+    int _upscaling_algo, _downscaling_algo;
+
+    std::vector<uint32_t> _free_layers{};
+
+    void allocate_storage(uint32_t layer_count);
+    /**
+     * @brief Downsamples the levels of a single layer from first_level on, each from the one
+     * above it.
+     */
+    void generate_layer_levels(uint32_t layer, uint32_t first_level);
+    [[nodiscard]] glm::ivec2 get_level_size(uint32_t level) const;
+
+public:
+    /**
+     * @brief Creates an empty array.
+     *
+     * @param width layer width
+     * @param height layer height
+     * @param internal_format sized internal format of all layers, e.g. GL_RGBA8
+     * @param initial_layer_count number of layers to allocate storage for upfront
+     * @param upscaling_algo Upscaling algorithm to use, e.g. GL_LINEAR
+     * @param downscaling_algo Downscaling algorithm to use, e.g. GL_LINEAR
+     */
+    texture2D_array_t(uint32_t width, uint32_t height, GLenum internal_format,
+                      uint32_t initial_layer_count, GLint upscaling_algo = GL_LINEAR,
+                      GLint downscaling_algo = GL_LINEAR);
+    ~texture2D_array_t() override;
+
+    texture2D_array_t(const texture2D_array_t&) = delete;
+    texture2D_array_t& operator=(const texture2D_array_t&) = delete;
+
+    /**
+     * @brief Maximum number of layers of a single array, limited by the implementation.
+     */
+    static uint32_t get_max_layer_count();
+
+    /**
+     * @brief Copies texture into a free layer, with its mip levels. Missing levels of
+     * uncompressed textures are generated.
+     *
+     * @param texture must match the array's size and internal format
+     * @return std::optional<uint32_t> the layer index, or nullopt if the array is full and can't
+     * grow any further.
+     */
+    std::optional<uint32_t> add_layer(const texture2D_t& texture);
+
+    /**
+     * @brief Marks layer as free, its contents are overwritten by a subsequent add_layer() call.
+     */
+    void free_layer(uint32_t layer);
+
+    [[nodiscard]] bool is_empty() const { return _free_layers.size() == _layer_count; }
+    [[nodiscard]] inline uint32_t get_width() const { return _width; }
+    [[nodiscard]] inline uint32_t get_height() const { return _height; }
+    [[nodiscard]] inline GLenum get_internal_format() const { return _internal_format; }
+
+    inline void bind(uint32_t slot) const override { glBindTextureUnit(slot, _gl_id); }
+};
+
+/**
+ * @brief A copy of a texture2D_t in a texture array layer, the layer is freed on destruction.
+ */
+class texture_array_layer_t
+{
+    std::shared_ptr<texture2D_array_t> _array;
+    uint32_t _layer;
+    std::weak_ptr<texture2D_t> _source;
+    uint32_t _source_revision;
+
+public:
+    texture_array_layer_t(std::shared_ptr<texture2D_array_t> array, uint32_t layer,
+                          const std::shared_ptr<texture2D_t>& source)
+      : _array(std::move(array)), _layer(layer), _source(source),
+        _source_revision(source->get_revision()) {}
+    ~texture_array_layer_t() { _array->free_layer(_layer); }
+
+    texture_array_layer_t(const texture_array_layer_t&) = delete;
+    texture_array_layer_t& operator=(const texture_array_layer_t&) = delete;
+
+    [[nodiscard]] const texture2D_array_t& get_array() const { return *_array; }
+    [[nodiscard]] uint32_t get_layer() const { return _layer; }
+
+    /**
+     * @brief Check whether this layer holds a copy of the current contents of texture.
+     */
+    [[nodiscard]] bool is_copy_of(const std::shared_ptr<texture2D_t>& texture) const {
+        return !_source.expired() && _source.lock() == texture
+               && texture->get_revision() == _source_revision;
+    }
+};
+
+/**
+ * @brief Packs textures of matching size, format and filtering into shared texture arrays, so
+ * differently textured materials can share a texture binding.
+ */
+class texture_array_pool_t
+{
+    using array_key_t = std::tuple<uint32_t, uint32_t, GLenum, GLint, GLint>;
+
+    inline static std::map<array_key_t, std::vector<std::shared_ptr<texture2D_array_t>>> _arrays{};
+    inline static std::unordered_map<const texture2D_t*, std::weak_ptr<texture_array_layer_t>>
+      _layers{};
+
+public:
+    constexpr static uint32_t initial_layer_count = 4;
+
+    /**
+     * @brief Get the array layer holding a copy of texture, copying it into a layer first if
+     * there's no such layer yet.
+     *
+     * @param texture the texture to copy
+     * @return std::shared_ptr<texture_array_layer_t> the layer, freed once no longer referenced.
+     */
+    static std::shared_ptr<texture_array_layer_t>
+      acquire(const std::shared_ptr<texture2D_t>& texture);
+
+    /**
+     * @brief Releases the pool's references to all arrays, layers still in use keep their arrays
+     * alive.
+     */
+    static void clear();
+};
+} // namespace pgre
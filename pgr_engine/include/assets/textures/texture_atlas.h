@@ -0,0 +1,151 @@
+#pragma once
+#include "texture2d.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace pgre {
+
+/**
+ * @brief Skyline bottom-left rectangle packer.
+ */
+class skyline_packer_t
+{
+    struct segment_t
+    {
+        uint32_t x, y, width;
+    };
+
+    uint32_t _width, _height;
+    std::vector<segment_t> _skyline;
+
+    /**
+     * @brief Get the y coordinate a rect of the given size would be placed at if its left edge
+     * was placed at the segment at segment_ix.
+     *
+     * @return std::nullopt if it doesn't fit.
+     */
+    [[nodiscard]] std::optional<uint32_t> fit(size_t segment_ix, uint32_t width,
+                                              uint32_t height) const;
+    void add_segment(size_t segment_ix, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+public:
+    skyline_packer_t(uint32_t width, uint32_t height);
+
+    /**
+     * @brief Finds space for a width x height rect.
+     *
+     * @return std::optional<glm::uvec2> position of the rect's lower left corner, or nullopt if
+     * it doesn't fit.
+     */
+    std::optional<glm::uvec2> insert(uint32_t width, uint32_t height);
+};
+
+/**
+ * @brief Combines images into RGBA8 atlases, each image surrounded by padding filled by its
+ * clamped edge pixels to avoid bleeding when filtering.
+ */
+class texture_atlas_builder_t
+{
+public:
+    struct image_t
+    {
+        std::vector<unsigned char> rgba_data;
+        uint32_t width, height;
+    };
+
+    /**
+     * @brief Placement of an added image.
+     */
+    struct entry_t
+    {
+        size_t atlas_ix;
+        /**
+         * @brief Maps the image's UV coordinates to atlas UV coordinates:
+         * atlas_uv = uv * uv_scale_offset.xy + uv_scale_offset.zw
+         */
+        glm::vec4 uv_scale_offset;
+    };
+
+private:
+    struct atlas_t
+    {
+        skyline_packer_t packer;
+        image_t image;
+    };
+
+    struct decoded_entry_t
+    {
+        std::filesystem::file_time_type write_time;
+        std::shared_ptr<const image_t> image;
+        uint64_t last_use;
+    };
+
+    /**
+     * @brief Size of the decoded images kept by load_image.
+     */
+    constexpr static size_t decoded_cache_budget = 64ULL << 20U;
+
+    uint32_t _atlas_size, _padding;
+    std::vector<atlas_t> _atlases{};
+
+    void blit_padded(atlas_t& atlas, const image_t& image, glm::uvec2 padded_pos) const;
+
+public:
+    /**
+     * @param atlas_size width and height of each atlas
+     * @param padding number of pixels around each image
+     */
+    texture_atlas_builder_t(uint32_t atlas_size, uint32_t padding);
+
+    /**
+     * @brief Loads an image to be packed, with rows ordered bottom to top like texture2D_t does.
+     * Decoded images stay resident up to decoded_cache_budget bytes, so reimports and imports
+     * sharing textures don't decode them again until the file changes.
+     *
+     * @throws image_loading_error
+     */
+    static std::shared_ptr<const image_t> load_image(const std::filesystem::path& path);
+
+    /**
+     * @brief Reads the dimensions of an image without decoding it.
+     *
+     * @return std::optional<glm::uvec2> nullopt if the image can't be read.
+     */
+    static std::optional<glm::uvec2> get_image_size(const std::filesystem::path& path);
+
+    /**
+     * @brief Packs image into the first atlas it fits into, creating a new atlas if needed.
+     *
+     * @return std::optional<entry_t> the placement, nullopt if image doesn't fit into an empty
+     * atlas.
+     */
+    std::optional<entry_t> add(const image_t& image);
+
+    [[nodiscard]] size_t get_atlas_count() const { return _atlases.size(); }
+
+    /**
+     * @brief Writes atlas at atlas_ix to a png file, doesn't touch OpenGL.
+     */
+    void write_atlas(size_t atlas_ix, const std::filesystem::path& path) const;
+
+    /**
+     * @brief Writes atlas at atlas_ix to a png file and loads it as a texture. The file is kept
+     * around so the texture can be serialized.
+     *
+     * @param atlas_ix atlas index
+     * @param path png file path
+     * @param upscaling_algo Upscaling algorithm to use, e.g. GL_LINEAR
+     * @param downscaling_algo Downscaling algorithm to use, e.g. GL_LINEAR
+     * @param compressed load the texture compressed, see texture2D_t
+     */
+    std::shared_ptr<texture2D_t> save_atlas(size_t atlas_ix, const std::filesystem::path& path,
+                                            GLint upscaling_algo = GL_LINEAR,
+                                            GLint downscaling_algo = GL_LINEAR,
+                                            bool compressed = false) const;
+};
+} // namespace pgre
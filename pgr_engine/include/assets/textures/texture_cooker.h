@@ -0,0 +1,152 @@
+#pragma once
+#include "texture.h"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// S3TC formats, glad is not necessarily generated with EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace pgre {
+
+/**
+ * @brief GPU-ready texture data, a full mip chain of each face compressed to BC1 (no alpha) or
+ * BC3 (alpha).
+ */
+struct cooked_texture_t
+{
+    constexpr static std::array<char, 4> magic{'P', 'G', 'T', 'X'};
+    constexpr static uint32_t format_version = 1;
+
+    uint32_t width{}, height{};
+    GLenum internal_format{};
+    bool has_alpha{};
+    /**
+     * @brief Mip level stored in faces[face][0], finer levels are not loaded.
+     */
+    uint32_t base_level{0};
+    /**
+     * @brief Compressed blocks, indexed by [face][mip level - base_level].
+     */
+    std::vector<std::vector<std::vector<uint8_t>>> faces{};
+
+    /**
+     * @brief Get the number of stored levels, starting at base_level.
+     */
+    [[nodiscard]] uint32_t get_level_count() const {
+        return faces.empty() ? 0 : static_cast<uint32_t>(faces.front().size());
+    }
+    /**
+     * @brief Get the size of a mip level, level 0 being width x height.
+     */
+    [[nodiscard]] glm::uvec2 get_level_size(uint32_t level) const {
+        return {std::max(1U, width >> level), std::max(1U, height >> level)};
+    }
+
+    /**
+     * @brief Writes the texture in the .pgtex format, all levels must be loaded. The file is
+     * written to a temp file first and renamed into place, so mapped readers never see it partly
+     * written.
+     *
+     * @throws std::runtime_error on failure.
+     */
+    void write(const std::filesystem::path& path) const;
+
+    /**
+     * @brief Reads a .pgtex file.
+     *
+     * @param base_level finest level to read, finer levels are skipped. Clamped to the coarsest
+     * level.
+     * @return std::optional<cooked_texture_t> nullopt if the file doesn't exist, isn't a .pgtex
+     * file or was written by a different format version.
+     */
+    static std::optional<cooked_texture_t> read(const std::filesystem::path& path,
+                                                uint32_t base_level = 0);
+};
+
+/**
+ * @brief Builds mip chains and compresses them with libsquish, work is split across
+ * thread_pool_t::get_global().
+ */
+class texture_cooker_t
+{
+public:
+    /**
+     * @brief Get the length of a full mip chain for a width x height image.
+     */
+    static uint32_t get_full_level_count(uint32_t width, uint32_t height);
+
+    /**
+     * @brief Get the byte size of a BC1/BC3 compressed image.
+     */
+    static size_t get_compressed_size(glm::uvec2 size, GLenum internal_format);
+
+    /**
+     * @brief Halves the image, averaging 2x2 pixel blocks (edge pixels are clamped for odd
+     * sizes).
+     */
+    static std::vector<uint8_t> downsample(const std::vector<uint8_t>& rgba, uint32_t width,
+                                           uint32_t height);
+
+    /**
+     * @brief Compresses an RGBA8 image to BC3 if alpha is true, otherwise BC1.
+     */
+    static std::vector<uint8_t> compress(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                         bool alpha);
+
+    /**
+     * @brief Cooks already decoded RGBA8 images, all faces must be width x height.
+     */
+    static cooked_texture_t cook_rgba(std::vector<std::vector<uint8_t>> faces_rgba,
+                                      uint32_t width, uint32_t height, bool has_alpha);
+
+    /**
+     * @brief Decodes the images of the faces in parallel, to a single uncompressed RGBA8 level
+     * each. internal_format is GL_RGB8 unless an image has alpha. Rows are ordered bottom to top,
+     * like texture2D_t does when loading.
+     *
+     * @throws image_loading_error if an image can't be loaded or the faces differ in size.
+     */
+    static cooked_texture_t decode(const std::vector<std::filesystem::path>& face_sources);
+
+    /**
+     * @brief Decodes the image of each face and cooks them, see decode.
+     *
+     * @throws image_loading_error
+     */
+    static cooked_texture_t cook(const std::vector<std::filesystem::path>& face_sources);
+
+    /**
+     * @brief Get the path of the cached cooked texture for a source image, or for a cubemap
+     * whose first face it is if face_count > 1. Cubemaps get a file of their own, so a face can
+     * still be cooked as a 2D texture.
+     */
+    static std::filesystem::path get_cache_path(const std::filesystem::path& source,
+                                                size_t face_count = 1);
+
+    /**
+     * @brief Whether the cached cooked texture exists and is newer than all sources, or is in a
+     * mounted archive.
+     */
+    static bool is_cache_up_to_date(const std::vector<std::filesystem::path>& face_sources);
+
+    /**
+     * @brief Reads the cached cooked texture if it's newer than all sources, otherwise cooks the
+     * sources and writes the cache next to the first one.
+     *
+     * @param base_level finest level to return, see cooked_texture_t::read
+     * @throws image_loading_error
+     */
+    static cooked_texture_t load_or_cook(const std::vector<std::filesystem::path>& face_sources,
+                                         uint32_t base_level = 0);
+};
+
+} // namespace pgre
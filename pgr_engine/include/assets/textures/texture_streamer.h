@@ -0,0 +1,182 @@
+#pragma once
+#include "texture_cooker.h"
+#include <utility/thread_pool.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Describes a texture once all its levels are uploaded.
+ */
+struct texture_stream_result_t
+{
+    uint32_t gl_id;
+    /**
+     * @brief Size of mip level 0, even if it wasn't loaded.
+     */
+    uint32_t width, height;
+    GLenum internal_format;
+    /**
+     * @brief Mip level stored in level 0 of the texture object.
+     */
+    uint32_t base_level;
+    uint32_t level_count;
+    bool has_alpha;
+};
+
+/**
+ * @brief A texture load queued in texture_streamer_t. Cancel it if the texture it's loaded for
+ * is destroyed before becoming resident.
+ */
+struct texture_stream_request_t
+{
+    GLenum target;
+    std::vector<std::filesystem::path> face_sources;
+    bool compressed;
+    /**
+     * @brief Finest mip level to load, only used for compressed textures.
+     */
+    uint32_t base_level;
+    /**
+     * @brief Called on the GL thread once the texture is resident. The callee takes ownership of
+     * the texture object and should set its sampling parameters.
+     */
+    std::function<void(const texture_stream_result_t&)> on_resident;
+    std::atomic<bool> cancelled = false;
+
+    texture_stream_request_t(GLenum target, std::vector<std::filesystem::path> face_sources,
+                             bool compressed, uint32_t base_level,
+                             std::function<void(const texture_stream_result_t&)> on_resident)
+      : target(target),
+        face_sources(std::move(face_sources)),
+        compressed(compressed),
+        base_level(base_level),
+        on_resident(std::move(on_resident)) {}
+
+    void cancel() { cancelled = true; }
+};
+
+/**
+ * @brief Loads textures in the background. Images are decoded (or cooked) on worker threads, and
+ * uploaded through a persistently mapped pixel unpack buffer ring by pump(), limited by a per
+ * frame byte budget. Until then, textures should bind get_placeholder_gl_id().
+ */
+class texture_streamer_t
+{
+    struct upload_t
+    {
+        std::shared_ptr<texture_stream_request_t> request;
+        std::future<cooked_texture_t> decoded;
+        std::optional<cooked_texture_t> data{};
+        uint32_t gl_id{0};
+        size_t next_face{0};
+        uint32_t next_level{0};
+    };
+
+    struct staging_region_t
+    {
+        size_t end;
+        GLsync fence;
+    };
+
+    inline static bool _enabled = true;
+
+    thread_pool_t _decode_pool{2};
+    std::deque<upload_t> _uploads{};
+    size_t _frame_budget = 8 * 1024 * 1024;
+
+    uint32_t _placeholder_gl_id{0};
+
+    uint32_t _staging_buffer{0};
+    uint8_t* _staging_ptr{nullptr};
+    size_t _staging_size = 32 * 1024 * 1024;
+    size_t _staging_head{0}, _staging_tail{0};
+    std::deque<staging_region_t> _staging_in_flight{};
+    bool _staging_used_this_frame = false;
+
+    texture_streamer_t() = default;
+
+    void init_gl_resources();
+    void retire_staging_regions();
+    std::optional<size_t> allocate_staging(size_t size);
+    /**
+     * @brief Get the number of faces of the next level uploaded together, all remaining ones if
+     * they fit in the staging buffer at once, otherwise one.
+     */
+    [[nodiscard]] size_t get_next_face_count(const upload_t& upload) const;
+    /**
+     * @brief Uploads the next face_count faces of the current level of upload, as the layers of
+     * a single call if they're staged.
+     *
+     * @return false if there's no staging space left this frame.
+     */
+    bool upload_next_faces(upload_t& upload, size_t face_count);
+    static cooked_texture_t decode(const texture_stream_request_t& request);
+
+public:
+    ~texture_streamer_t() = default;
+    texture_streamer_t(const texture_streamer_t&) = delete;
+    texture_streamer_t& operator=(const texture_streamer_t&) = delete;
+
+    static texture_streamer_t& get();
+
+    /**
+     * @brief If disabled, textures load synchronously on construction.
+     */
+    static void set_enabled(bool enabled) { _enabled = enabled; }
+    [[nodiscard]] static bool is_enabled() { return _enabled; }
+
+    /**
+     * @brief Set the maximum number of bytes uploaded per pump() call. A single mip level larger
+     * than the budget is still uploaded, as the first upload of a frame.
+     */
+    void set_frame_budget(size_t bytes) { _frame_budget = bytes; }
+
+    /**
+     * @brief Get the pool textures are decoded and cooked on. Work that decodes or cooks should
+     * run there rather than on thread_pool_t::get_global(), which the cooker splits its work
+     * across.
+     */
+    thread_pool_t& get_decode_pool() { return _decode_pool; }
+
+    /**
+     * @brief Get a 1x1 white texture, for use while the real one is loading.
+     */
+    uint32_t get_placeholder_gl_id();
+
+    /**
+     * @brief Queues a texture load.
+     *
+     * @param target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+     * @param face_sources one image per face, in GL face order for cubemaps
+     * @param compressed load a cooked BC1/BC3 texture with mips, see texture_cooker_t
+     * @param on_resident called on the GL thread once uploaded, unless cancelled before
+     * @param base_level finest mip level to load if compressed, see mip_streamer_t
+     * @return std::shared_ptr<texture_stream_request_t> the request, for cancellation.
+     */
+    std::shared_ptr<texture_stream_request_t>
+      request(GLenum target, std::vector<std::filesystem::path> face_sources, bool compressed,
+              std::function<void(const texture_stream_result_t&)> on_resident,
+              uint32_t base_level = 0);
+
+    /**
+     * @brief Uploads decoded textures within the frame budget. Call once per frame on the GL
+     * thread.
+     */
+    void pump();
+
+    /**
+     * @brief Drops all pending loads and frees GL resources, must be called while the context
+     * still exists.
+     */
+    void shutdown();
+};
+
+} // namespace pgre
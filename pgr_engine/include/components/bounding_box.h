@@ -4,6 +4,9 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <limits>
+
 #include <cereal/types/array.hpp>
 
 #include <math/aabb.h>
@@ -35,6 +38,30 @@ public:
     explicit bounding_box_t(const std::pair<glm::vec3, glm::vec3>& min_max)
       : bounding_box_t{min_max.first, min_max.second} {}
 
+    /**
+     * @brief Estimates the size of the box on screen, as the projected diameter of its bounding
+     * sphere.
+     *
+     * @param model_matrix
+     * @param view_matrix
+     * @param proj_matrix perspective projection matrix
+     * @param viewport_height viewport height in pixels
+     * @return float the size in pixels, infinity if the camera is inside the bounding sphere.
+     */
+    [[nodiscard]] float get_projected_size(const glm::mat4& model_matrix,
+                                           const glm::mat4& view_matrix,
+                                           const glm::mat4& proj_matrix,
+                                           float viewport_height) const {
+        const auto center = view_matrix * model_matrix * glm::vec4((_min + _max) * 0.5f, 1.0f);
+        const auto scale = std::max({glm::length(glm::vec3(model_matrix[0])),
+                                     glm::length(glm::vec3(model_matrix[1])),
+                                     glm::length(glm::vec3(model_matrix[2]))});
+        const auto radius = glm::length(_max - _min) * 0.5f * scale;
+        const auto distance = -center.z;
+        if (distance <= radius) return std::numeric_limits<float>::infinity();
+        return radius / distance * proj_matrix[1][1] * viewport_height;
+    }
+
     /**
      * @brief Tests if the ray (ray segment) intersects an AABB constructed around this bb transformed by the model_matrix.
      *
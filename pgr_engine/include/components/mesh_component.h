@@ -1,33 +1,46 @@
 #pragma once
 
-#include <assets/materials/phong_material.h>
+#include <assets/asset_archive.h>
+#include <assets/materials/all_materials.h>
 #include <primitives/vertex_array.h>
 
 namespace pgre::component {
 struct mesh_t
 {
+    asset_ref_t<primitives::vertex_array_t> v_array{};
+    material_ref_t material{};
 
-    std::shared_ptr<primitives::vertex_array_t> v_array
-      = std::make_shared<primitives::vertex_array_t>();
-    std::shared_ptr<material_t> material = std::make_shared<phong_material_t>();
+    mesh_t(asset_ref_t<primitives::vertex_array_t> vertex_array = {}, material_ref_t material = {})
+      : v_array(std::move(vertex_array)), material(std::move(material)) {}
 
-    mesh_t(std::shared_ptr<primitives::vertex_array_t> vertex_array = nullptr,
-           std::shared_ptr<material_t> material = nullptr)
-      : v_array(vertex_array), material(material){
-    }
-
-    void realize_material_instance(){
-        if (auto p_material = std::dynamic_pointer_cast<pgre::phong_material_t>(material)) {
-            material = std::make_shared<phong_material_t>(*p_material);
+    void realize_material_instance() {
+        if (auto* p_material = material ? std::get_if<phong_material_t>(&*material) : nullptr) {
+            // copied out first, creating the new material may reallocate the table
+            phong_material_t instance{*p_material};
+            material = make_material<phong_material_t>(std::move(instance));
         } else {
             spdlog::warn("Trying to realize non-phong material instance. (Not supported)");
         }
     }
 
+    /**
+     * @brief Writes indices into the asset lists of the archive's asset_archive_context_t.
+     */
+    template<typename Archive>
+    void save(Archive& archive) const {
+        const auto& assets = cereal::get_user_data<asset_archive_context_t>(archive);
+        archive(assets.vertex_arrays.get_index(v_array), assets.materials.get_index(material));
+    }
+
     template<typename Archive>
-    void serialize(Archive& archive) {
-        archive(v_array, material);
+    void load(Archive& archive) {
+        uint32_t v_array_ix{};
+        uint32_t material_ix{};
+        archive(v_array_ix, material_ix);
+        const auto& assets = cereal::get_user_data<asset_archive_context_t>(archive);
+        v_array = assets.vertex_arrays.get_ref(v_array_ix);
+        material = assets.materials.get_ref(material_ix);
     }
 };
 
-} // namespace pgre::component
\ No newline at end of file
+} // namespace pgre::component
@@ -7,7 +7,11 @@
 
 namespace pgre::math {
 
-inline std::pair<glm::vec3, glm::vec3> calc_aabb(const float* data, uint64_t vertex_count) {
+/**
+ * @param stride number of floats per vertex, the position being the first three
+ */
+inline std::pair<glm::vec3, glm::vec3> calc_aabb(const float* data, uint64_t vertex_count,
+                                                 uint64_t stride = 3) {
     constexpr auto fmin = std::numeric_limits<float>::lowest();
     constexpr auto fmax = std::numeric_limits<float>::max();
     glm::vec3 min{fmax};
@@ -15,8 +19,8 @@ inline std::pair<glm::vec3, glm::vec3> calc_aabb(const float* data, uint64_t ver
 
     for (uint64_t v_ix = 0; v_ix < vertex_count; v_ix++) {
         for (uint8_t i = 0; i < 3; i++) {
-            if (*(data + v_ix * 3 + i) > max[i]) max[i] = *(data + v_ix * 3 + i);
-            if (*(data + v_ix * 3 + i) < min[i]) min[i] = *(data + v_ix * 3 + i);
+            if (*(data + v_ix * stride + i) > max[i]) max[i] = *(data + v_ix * stride + i);
+            if (*(data + v_ix * stride + i) < min[i]) min[i] = *(data + v_ix * stride + i);
         }
     }
 
@@ -1,5 +1,5 @@
 #pragma once
-#include "assets/materials/flat_color_material.h"
+#include "assets/materials/all_materials.h"
 #include "glm/mat4x4.hpp"
 #include "primitives/vertex_array.h"
 #include <glm/vec3.hpp>
@@ -13,14 +13,12 @@ namespace pgre::math::curves {
 struct coons_curve_3D_t {
     constexpr static glm::mat4 basis_coefficients = {-1, 3, -3, 1, 3, -6, 0, 4, -3, 3, 3, 1, 1, 0, 0, 0};
     std::vector<glm::vec3> control_points;
-    std::shared_ptr<primitives::vertex_array_t> vao
-      = std::make_shared<primitives::vertex_array_t>();
+    asset_ref_t<primitives::vertex_array_t> vao
+      = asset_table_t<primitives::vertex_array_t>::get().create();
     std::shared_ptr<primitives::vertex_buffer_t> vbo
       = std::make_shared<primitives::vertex_buffer_t>();
     std::shared_ptr<primitives::index_buffer_t> ebo
       = std::make_shared<primitives::index_buffer_t>();
-    inline static const auto point_material
-          = std::make_shared<flat_color_material_t>(glm::vec3{0.8, 0.2, 0.5});
 
     void fill_buffers(){
         if (!control_points.empty()){
@@ -33,7 +31,7 @@ struct coons_curve_3D_t {
             vao->add_vertex_buffer(
               vbo, std::make_shared<primitives::buffer_layout_t>(
                      std::initializer_list<primitives::buffer_element_t>{{GL_FLOAT, 3, "position"}},
-                     point_material));
+                     flat_color_material_t::get_shader_s()));
             vao->set_index_buffer(ebo);
         }
     };
@@ -42,14 +40,16 @@ public:
     /**
      * @brief Gets a VAO filled with the curves control points. 
      * 
-     * @return std::shared_ptr<primitives::vertex_array_t> 
+     * @return const asset_ref_t<primitives::vertex_array_t>&
      */
-    std::shared_ptr<primitives::vertex_array_t> get_cp_vao(){
+    const asset_ref_t<primitives::vertex_array_t>& get_cp_vao(){
         fill_buffers();
         return vao;
     }
 
-    std::shared_ptr<material_t> get_material(){
+    static const material_ref_t& get_material(){
+        static const auto point_material
+          = make_material<flat_color_material_t>(glm::vec3{0.8, 0.2, 0.5});
         return point_material;
     }
 
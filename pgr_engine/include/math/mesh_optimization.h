@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace pgre::math {
+
+/**
+ * @brief Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache.
+ */
+struct vertex_cache_stats_t
+{
+    /**
+     * @brief Average cache miss ratio, transformed vertices per triangle. 0.5 at best, 3 at
+     * worst.
+     */
+    float acmr = 0.0f;
+    /**
+     * @brief Average transform to vertex ratio, transformed vertices per referenced vertex. 1 at
+     * best.
+     */
+    float atvr = 0.0f;
+};
+
+/**
+ * @brief Post-transform cache size the optimizations target, a conservative estimate of current
+ * GPUs.
+ */
+constexpr uint32_t default_vertex_cache_size = 16;
+
+/**
+ * @brief Merges vertices whose attributes all differ by at most their epsilon, vertices are
+ * compared with the first matching vertex before them. Unreferenced vertices are dropped.
+ *
+ * @param vertices interleaved vertex data, position at the start of each vertex, shrunk in place
+ * @param stride number of floats per vertex
+ * @param indices triangle list, remapped in place
+ * @param epsilons maximum difference of each of the stride floats of a vertex, 0 for exact
+ * matches
+ * @return size_t the new vertex count
+ */
+size_t weld_vertices(std::vector<float>& vertices, size_t stride, std::span<uint32_t> indices,
+                     std::span<const float> epsilons);
+
+vertex_cache_stats_t analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertex_count,
+                                          uint32_t cache_size = default_vertex_cache_size);
+
+/**
+ * @brief Reorders triangles for post-transform cache efficiency, using Tipsify (Sander et al.,
+ * Fast Triangle Reordering for Vertex Locality and Reduced Overdraw, 2007).
+ *
+ * @param indices triangle list, reordered in place
+ * @return std::vector<uint32_t> indices of triangles starting a new cluster, where the ordering
+ * had to jump to an unrelated part of the mesh. Starts with 0, pass to optimize_overdraw.
+ */
+std::vector<uint32_t> optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count,
+                                            uint32_t cache_size = default_vertex_cache_size);
+
+/**
+ * @brief Reorders clusters of triangles so that ones facing away from the mesh's center, which
+ * are likely to occlude the rest, come first. Clusters are split further wherever that costs
+ * little cache efficiency.
+ *
+ * @param indices triangle list ordered by optimize_vertex_cache, reordered in place
+ * @param positions vertex positions, x, y and z at the start of each vertex
+ * @param stride number of floats per vertex
+ * @param clusters cluster starts returned by optimize_vertex_cache
+ * @param threshold how much worse than the cache optimized order the ACMR may get, 1.05 allows
+ * 5%
+ */
+void optimize_overdraw(std::span<uint32_t> indices, std::span<const float> positions,
+                       size_t stride, const std::vector<uint32_t>& clusters,
+                       float threshold = 1.05f, uint32_t cache_size = default_vertex_cache_size);
+
+/**
+ * @brief Reorders vertices in the order they're first referenced, so vertex fetches stay
+ * local. Unreferenced vertices are dropped.
+ *
+ * @param vertices interleaved vertex data, reordered in place and shrunk
+ * @param stride number of floats per vertex
+ * @param indices triangle list, remapped in place
+ * @return size_t the new vertex count
+ */
+size_t optimize_vertex_fetch(std::vector<float>& vertices, size_t stride,
+                             std::span<uint32_t> indices);
+
+} // namespace pgre::math
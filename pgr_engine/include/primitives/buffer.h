@@ -67,6 +67,23 @@ struct buffer_t
                            usage);
     }
 
+    /**
+     * @brief Creates immutable storage holding data, the buffer can't be resized or set again
+     * afterwards. data may point into a memory mapped file, it's only read during the call.
+     *
+     * @param size size of data
+     * @param data pointer to data
+     * @param flags glNamedBufferStorage flags, 0 for a buffer only written by this call
+     */
+    void set_storage(GLsizeiptr size, const GLvoid* data, GLbitfield flags = 0) {
+        // a name from glGenBuffers has no buffer object until it's first bound
+        glBindVertexArray(0);
+        this->bind();
+        glNamedBufferStorage(_gl_id, size, data, flags);
+        _current_data_offset = size;
+        _current_allocated_size = size;
+    }
+
     /**
      * @brief Ask OpenGL to alloc space for size bytes for subsequent push_back() calls
      *
@@ -122,6 +139,14 @@ struct buffer_t
      */
     inline void bind() const { glBindBuffer(binding_target, _gl_id); }
 
+    /**
+     * @brief Binds the buffer to an indexed binding point of the target assigned in constructor.
+     * Only valid for indexed targets (uniform buffers etc.)
+     *
+     * @param index binding point index.
+     */
+    inline void bind_base(GLuint index) const { glBindBufferBase(binding_target, index, _gl_id); }
+
     /**
      * @brief Get the size, in bytes, of data currently in the buffer.
      */
@@ -136,6 +161,7 @@ struct buffer_t
 
 using vertex_buffer_t = buffer_t<GL_ARRAY_BUFFER, uint8_t>;
 using index_buffer_t = buffer_t<GL_ELEMENT_ARRAY_BUFFER, GLuint>;
+using uniform_buffer_t = buffer_t<GL_UNIFORM_BUFFER, uint8_t>;
 
 template<class Archive>
 void save(Archive& archive, vertex_buffer_t const& vb) {
@@ -154,7 +180,8 @@ void load(Archive& archive, vertex_buffer_t& vb) {
 
 template<class Archive>
 void save(Archive& archive, index_buffer_t const& ib) {
-    std::vector<GLuint> buffer_data(ib.get_count());
+    // rounded up, 16-bit indices may not fill the last GLuint
+    std::vector<GLuint> buffer_data((ib.get_size() + sizeof(GLuint) - 1) / sizeof(GLuint));
 
     ib.bind();
     glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, ib.get_size(),
@@ -5,7 +5,6 @@
 
 #include <primitives/shader_program.h>
 #include "buffer.h"
-#include "assets/materials/material.h"
 #include "utility/aligned.h"
 
 #include <cereal/types/string.hpp>
@@ -56,7 +55,6 @@ struct ALIGN(64) buffer_element_t
 class buffer_layout_t
 {
     std::vector<buffer_element_t> _elements;
-    std::shared_ptr<material_t> _material;
 
     /**
      * @brief specifies the byte offset between consecutive generic vertex
@@ -70,13 +68,20 @@ public:
      * @brief Construct a new buffer_layout_t and calculates stride and offset (interleaving
      * assumed).
      *
-     * @param shader shader program to get attribute locations from
      * @param elements initializer list of buffer_element_t
+     * @param shader shader program to get attribute locations from, only used during
+     * construction
      */
-    buffer_layout_t(std::initializer_list<buffer_element_t> elements,
-                    std::shared_ptr<material_t> material);
-    buffer_layout_t(const std::vector<buffer_element_t>& elements,
-                    std::shared_ptr<material_t> material);
+    buffer_layout_t(std::initializer_list<buffer_element_t> elements, shader_program_t& shader);
+    buffer_layout_t(const std::vector<buffer_element_t>& elements, shader_program_t& shader);
+    /**
+     * @brief Construct a new buffer_layout_t with the elements' start offsets as given, for
+     * vertex data laid out elsewhere, e.g. glTF accessors.
+     *
+     * @param stride byte offset between consecutive vertices
+     */
+    buffer_layout_t(const std::vector<buffer_element_t>& elements, GLsizei stride,
+                    shader_program_t& shader);
 
     [[nodiscard]] inline uintptr_t get_stride() const { return _stride; }
     /**
@@ -88,18 +93,14 @@ public:
     [[nodiscard]] decltype(_elements.cbegin()) begin() const { return _elements.cbegin(); }
     [[nodiscard]] decltype(_elements.cend()) end() const { return _elements.cend(); }
 
+    /**
+     * @brief Attribute locations are stored with the elements, so the layout can be loaded
+     * without the shader.
+     */
     template<class Archive>
-    void save(Archive& archive) const {
-        archive(_elements, _material);
+    void serialize(Archive& archive) {
+        archive(_elements, _stride);
     }
 };
 
-template<class Archive>
-void load(Archive& archive, buffer_layout_t& layout) {
-    std::vector<buffer_element_t> loaded_elements;
-    std::shared_ptr<material_t> material;
-    archive(loaded_elements, material);
-    layout = buffer_layout_t(loaded_elements, material);
-}
-
 } // namespace pgre::primitives
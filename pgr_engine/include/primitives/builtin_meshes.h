@@ -1,10 +1,14 @@
 #pragma once
 #include "vertex_array.h"
+#include <assets/asset_table.h>
+#include <primitives/shader_program.h>
 
 namespace pgre::builtin_meshes{
 
-std::shared_ptr<primitives::vertex_array_t>
-  get_cube_vao(const std::shared_ptr<material_t>& material, bool normals = false,
-               bool tex_coords = false);
+/**
+ * @param shader shader program to get attribute locations from
+ */
+asset_ref_t<primitives::vertex_array_t>
+  get_cube_vao(shader_program_t& shader, bool normals = false, bool tex_coords = false);
 
 }  // namespace pgre::builtin_meshes
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include <assets/asset_table.h>
+#include <primitives/buffer_layout.h>
+#include <primitives/shader_program.h>
+#include <primitives/vertex_array.h>
+
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace pgre::primitives {
+
+/**
+ * @brief Vertex attributes in a buffer of their own, e.g. a glTF buffer view.
+ */
+struct vertex_stream_view_t
+{
+    std::span<const uint8_t> data{};
+    /**
+     * @brief Elements with their start offsets within a vertex set.
+     */
+    std::vector<buffer_element_t> elements{};
+    /**
+     * @brief Byte offset between consecutive vertices.
+     */
+    GLsizei stride = 0;
+};
+
+/**
+ * @brief Mesh data owned elsewhere, e.g. by a mesh_data_t or a memory mapped cache file.
+ */
+struct mesh_view_t
+{
+    /**
+     * @brief Interleaved vertex attributes, described by elements.
+     */
+    std::span<const uint8_t> vertices{};
+    std::span<const uint8_t> indices{};
+    /**
+     * @brief GL_UNSIGNED_INT, GL_UNSIGNED_SHORT or GL_UNSIGNED_BYTE.
+     */
+    GLenum index_type = GL_UNSIGNED_INT;
+    std::vector<buffer_element_t> elements{};
+    std::pair<glm::vec3, glm::vec3> aabb{};
+    /**
+     * @brief Maps stored positions to model space, set if positions are quantized.
+     */
+    std::optional<glm::mat4> position_transform{};
+    /**
+     * @brief Index of the mesh's material in the imported file.
+     */
+    uint32_t material_ix{0};
+    /**
+     * @brief Attributes in further vertex buffers, uploaded as they are. vertices may be empty if
+     * all attributes are in streams.
+     */
+    std::vector<vertex_stream_view_t> streams{};
+
+    /**
+     * @brief Creates a vertex array with immutable buffers holding the mesh data, which is read
+     * straight from where it's viewed. Call on the GL thread.
+     *
+     * @param shader shader program to get attribute locations from
+     */
+    [[nodiscard]] asset_ref_t<vertex_array_t> upload(shader_program_t& shader) const;
+};
+
+/**
+ * @brief CPU-side mesh, built without touching OpenGL, so it can be prepared on any thread and
+ * uploaded later on the GL thread.
+ */
+struct mesh_data_t
+{
+    /**
+     * @brief Interleaved vertex attributes, described by elements.
+     */
+    std::vector<uint8_t> vertices{};
+    std::vector<uint8_t> indices{};
+    /**
+     * @brief GL_UNSIGNED_INT or GL_UNSIGNED_SHORT.
+     */
+    GLenum index_type = GL_UNSIGNED_INT;
+    std::vector<buffer_element_t> elements{};
+    std::pair<glm::vec3, glm::vec3> aabb{};
+    /**
+     * @brief Maps stored positions to model space, set if positions are quantized.
+     */
+    std::optional<glm::mat4> position_transform{};
+    /**
+     * @brief Index of the mesh's material in the imported file.
+     */
+    uint32_t material_ix{0};
+
+    /**
+     * @brief Get a view of the mesh, valid while the mesh isn't modified.
+     */
+    [[nodiscard]] mesh_view_t get_view() const {
+        return {vertices, indices, index_type, elements, aabb, position_transform, material_ix};
+    }
+
+    /**
+     * @brief Creates a vertex array with buffers holding the mesh data. Call on the GL thread.
+     *
+     * @param shader shader program to get attribute locations from
+     */
+    [[nodiscard]] asset_ref_t<vertex_array_t> upload(shader_program_t& shader) const {
+        return get_view().upload(shader);
+    }
+};
+
+} // namespace pgre::primitives
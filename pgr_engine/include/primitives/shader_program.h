@@ -4,6 +4,8 @@
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <string_view>
 
@@ -27,10 +29,22 @@ public:
     explicit shader_attrib_inactive_error(const std::string& what);
 };
 
+/**
+ * @brief Set of preprocessor symbols a shader program variant is compiled with.
+ */
+using shader_defines_t = std::set<std::string>;
+
 class shader_program_t
 {
     inline static int _bound_program_id =0 ;
-    inline static std::unordered_map<std::string, int> uniform_locs{};
+    std::unordered_map<std::string, int> _uniform_locs{};
+
+    /**
+     * @brief Shader sources as loaded from file, kept around to compile variants from.
+     */
+    std::map<uint32_t, std::string> _sources{};
+    shader_defines_t _defines{};
+    std::map<shader_defines_t, std::unique_ptr<shader_program_t>> _variants{};
 
     /**
      * @brief Get the location of a uniform, uses caching.
@@ -41,19 +55,21 @@ class shader_program_t
      * @return false otherwise
      */
     inline bool get_uniform_loc(const std::string& glsl_name, int& loc) {
-        if (auto it = uniform_locs.find(glsl_name); it != uniform_locs.end()) {
+        if (auto it = _uniform_locs.find(glsl_name); it != _uniform_locs.end()) {
             loc=it->second;
-            return true;
+            return loc != -1;
         }
         loc = glGetUniformLocation(program_id, glsl_name.c_str());
         if (loc == -1) {
+            // cached as well, variants legitimately lack some uniforms, so only warn once
             spdlog::warn("Uniform '{}' not found in shader program.", glsl_name);
-            return false;
         }
-        uniform_locs[glsl_name] = loc;
-        return true;
+        _uniform_locs[glsl_name] = loc;
+        return loc != -1;
     }
 
+    shader_program_t(const std::map<uint32_t, std::string>& sources, shader_defines_t defines);
+
 public:
     int program_id{0};
 
@@ -61,6 +77,37 @@ public:
     explicit shader_program_t(const std::filesystem::path& shader_file_path);
     explicit shader_program_t(std::stringstream& shader_data);
     explicit shader_program_t(std::stringstream&& shader_data);
+    ~shader_program_t();
+
+    shader_program_t(const shader_program_t&) = delete;
+    shader_program_t& operator=(const shader_program_t&) = delete;
+
+    /**
+     * @brief Get a variant of this program compiled with the specified preprocessor symbols
+     * defined. Variants are compiled on first request and cached, an empty set returns the
+     * program itself.
+     *
+     * The symbols are injected in place of a `shader::defines` line in each shader stage, or
+     * right after the `#version` directive if the stage has no such line.
+     *
+     * @param defines symbols to #define
+     * @return shader_program_t& the variant, owned by this program.
+     */
+    shader_program_t& get_variant(const shader_defines_t& defines);
+
+    /**
+     * @brief Calls func for this program and each variant compiled so far.
+     */
+    template<typename FuncTy>
+    requires std::is_invocable_v<FuncTy, shader_program_t&>
+    void for_each_variant(FuncTy&& func) {
+        func(*this);
+        for (auto& [defines, variant] : _variants) {
+            func(*variant);
+        }
+    }
+
+    [[nodiscard]] const shader_defines_t& get_defines() const { return _defines; }
 
     /**
      * @brief Sets a uniform for this shader program. Thin wrapper for the oGl uniform function
@@ -94,6 +141,15 @@ public:
     bool set_uniform(const std::string& glsl_name, int x);
     bool set_uniform(const std::string& glsl_name, bool x);
 
+    /**
+     * @brief Assigns a uniform block to an indexed uniform buffer binding point.
+     *
+     * @param block_name uniform block name as declared in the shader source
+     * @param binding the binding point
+     * @return false if unknown block name (may have been optimized out)
+     */
+    bool set_uniform_block_binding(const std::string& block_name, GLuint binding);
+
 
     inline void bind() const {
         debug_assert(
@@ -120,6 +176,6 @@ public:
     [[nodiscard]] unsigned int get_attrib_location(const std::string& glsl_name) const;
 
 private:
-    bool compile_shader_program(std::map<uint32_t, std::stringstream>& source_map) const;
+    bool compile_shader_program(const std::map<uint32_t, std::string>& source_map) const;
 };
 } // namespace pgre
\ No newline at end of file
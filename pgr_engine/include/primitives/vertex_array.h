@@ -1,5 +1,7 @@
 #pragma once
+#include <optional>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -8,7 +10,11 @@
 #include "buffer.h"
 #include "primitives/buffer_layout.h"
 
+#include <glm/mat4x4.hpp>
+
+#include <cereal/types/optional.hpp>
 #include <cereal/types/vector.hpp>
+#include <cerealization/glm_serializers.h>
 #include <cerealization/std_serializers.h>
 
 namespace pgre::primitives {
@@ -21,6 +27,15 @@ class vertex_array_t
     unsigned int _gl_id{};
     std::vector<std::pair<std::shared_ptr<vertex_buffer_t>, std::shared_ptr<buffer_layout_t>>> _vertex_buffers {};
     std::shared_ptr<index_buffer_t> _index_buffer;
+    /**
+     * @brief GL_UNSIGNED_INT, GL_UNSIGNED_SHORT or GL_UNSIGNED_BYTE.
+     */
+    GLenum _index_type = GL_UNSIGNED_INT;
+    GLsizei _index_count = 0;
+    /**
+     * @brief Maps stored positions to model space, set if positions are quantized.
+     */
+    std::optional<glm::mat4> _position_transform{};
 public:
     /**
      * @brief Creates a VAO. The layout and buffer associations should be specified using
@@ -28,6 +43,13 @@ public:
      */
     explicit vertex_array_t();
     ~vertex_array_t();
+    vertex_array_t(const vertex_array_t&) = delete;
+    vertex_array_t& operator=(const vertex_array_t&) = delete;
+    /**
+     * @brief Takes over the VAO, other is left without one.
+     */
+    vertex_array_t(vertex_array_t&& other) noexcept;
+    vertex_array_t& operator=(vertex_array_t&& other) noexcept;
 
     /**
      * @brief Associates a buffer layout with the vertex array and the buffer, stores the
@@ -43,8 +65,24 @@ public:
      * buffer pointer cpu-side in the vertex_array_t object.
      * 
      * @param buffer 
+     * @param index_type type of the indices in the buffer, GL_UNSIGNED_INT, GL_UNSIGNED_SHORT or
+     * GL_UNSIGNED_BYTE
+     */
+    vertex_array_t& set_index_buffer(const std::shared_ptr<index_buffer_t>& buffer,
+                                     GLenum index_type = GL_UNSIGNED_INT);
+
+    /**
+     * @brief Set the transform from stored positions to model space, to be applied in front of
+     * the model matrix when drawing. Used by meshes with positions quantized relative to their
+     * bounding box.
      */
-    vertex_array_t& set_index_buffer(const std::shared_ptr<index_buffer_t>& buffer);
+    void set_position_transform(const glm::mat4& transform) { _position_transform = transform; }
+    [[nodiscard]] const std::optional<glm::mat4>& get_position_transform() const {
+        return _position_transform;
+    }
+
+    [[nodiscard]] GLenum get_index_type() const { return _index_type; }
+    [[nodiscard]] GLsizei get_index_count() const { return _index_count; }
 
     /**
      * @brief Binds the VAO
@@ -63,18 +101,23 @@ public:
 
     template <class Archive>
     void save(Archive& archive) const {
-        archive(_vertex_buffers, _index_buffer);
+        archive(_vertex_buffers, _index_buffer, _index_type, _index_count, _position_transform);
     }
 
     template<class Archive>
     void load(Archive& archive){
         std::vector<std::pair<std::shared_ptr<vertex_buffer_t>, std::shared_ptr<buffer_layout_t>>> loaded_vertex_buffers {};
         std::shared_ptr<index_buffer_t> loaded_index_buffer;
-        archive(loaded_vertex_buffers, loaded_index_buffer);
+        GLenum loaded_index_type{};
+        GLsizei loaded_index_count{};
+        archive(loaded_vertex_buffers, loaded_index_buffer, loaded_index_type, loaded_index_count,
+                _position_transform);
         for (auto& [buf, layout]: loaded_vertex_buffers){
             this->add_vertex_buffer(buf, layout);
         }
-        this->set_index_buffer(loaded_index_buffer);
+        this->set_index_buffer(loaded_index_buffer, loaded_index_type);
+        // the loaded buffer may be padded to whole GLuints
+        _index_count = loaded_index_count;
     }
 };
 
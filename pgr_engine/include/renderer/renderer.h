@@ -1,8 +1,10 @@
 #pragma once
 
 #include "./camera.h"
-#include <assets/materials/material.h>
+#include <assets/asset_table.h>
+#include <assets/materials/all_materials.h>
 #include <primitives/vertex_array.h>
+#include <limits>
 #include <memory>
 #include <utility>
 
@@ -15,8 +17,10 @@ public:
     virtual void init() = 0;
     virtual void recompile_shaders() = 0;
     virtual void begin_scene(scene::scene_t& scene) = 0;
-    virtual void submit(const glm::mat4& transform, std::shared_ptr<primitives::vertex_array_t> vao,
-                        std::shared_ptr<material_t> material, GLenum primitive = GL_TRIANGLES)
+    virtual void submit(const glm::mat4& transform,
+                        asset_handle_t<primitives::vertex_array_t> vao,
+                        material_handle_t material, GLenum primitive = GL_TRIANGLES,
+                        float screen_size = std::numeric_limits<float>::infinity())
       = 0;
     virtual void end_scene() = 0;
     virtual void on_resize(const glm::ivec2& new_win_dims) = 0;
@@ -33,12 +37,17 @@ public:
     
     inline static void begin_scene(scene::scene_t& scene) { _instance->begin_scene(scene); }
 
-    inline static void submit(const glm::mat4& transform,
-                              std::shared_ptr<primitives::vertex_array_t> vao,
-                              std::shared_ptr<material_t> material,
-                              GLenum primitive = GL_TRIANGLES) {
-        _instance->submit(transform, std::move(vao), std::move(material), primitive);
-    }
+    /**
+     * @brief Defined alongside the renderer implementation, so it can be called without virtual
+     * dispatch.
+     *
+     * @param vao, material handles of assets that must stay alive until end_scene()
+     * @param screen_size projected size of the object in pixels, used to pick the texture detail
+     * to stream in (see mip_streamer_t). Infinity if unknown.
+     */
+    static void submit(const glm::mat4& transform, asset_handle_t<primitives::vertex_array_t> vao,
+                       material_handle_t material, GLenum primitive = GL_TRIANGLES,
+                       float screen_size = std::numeric_limits<float>::infinity());
 
     inline static void end_scene() { _instance->end_scene(); }
 
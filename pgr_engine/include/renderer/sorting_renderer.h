@@ -1,9 +1,10 @@
 #pragma once
 
-#include "assets/materials/flat_color_material.h"
+#include <optional>
 #include <thread>
+#include <tuple>
 
-#include <assets/materials/material.h>
+#include <assets/materials/all_materials.h>
 #include <renderer/renderer.h>
 
 namespace pgre {
@@ -11,16 +12,35 @@ namespace pgre {
     /**
      * @brief Deferred renderer with depth sorting.
      */
-    class sorting_renderer_t : public renderer_i {
+    class sorting_renderer_t final : public renderer_i {
+        template<typename MaterialTy>
         struct render_command_t {
-            const glm::mat4& transform;
-            std::shared_ptr<primitives::vertex_array_t> vao;
-            std::shared_ptr<material_t> material;
+            using material_type = MaterialTy;
+
+            const glm::mat4* transform;
+            asset_handle_t<primitives::vertex_array_t> vao;
+            /**
+             * @brief Handle of a material_variant_t holding a MaterialTy.
+             */
+            material_handle_t material;
             GLenum primitive;
+            float screen_size;
+            /**
+             * @brief Set on opaque commands whose material supports instancing, see
+             * phong_material_t::get_instancing_key.
+             */
+            std::optional<uint64_t> instancing_key{};
         };
 
+        template<typename... MaterialTys>
+        using render_command_lists_t = std::tuple<std::vector<render_command_t<MaterialTys>>...>;
+
         std::thread _render_thread;
-        std::map<uint32_t, std::vector<render_command_t>> _render_commands{};
+        /**
+         * @brief One command list per concrete material type, so the per-draw material calls
+         * are resolved at compile time.
+         */
+        render_command_lists_t<PGRE_MATERIAL_TYPES> _render_commands{};
         
 
         scene::scene_t* _curr_scene;
@@ -28,6 +48,8 @@ namespace pgre {
         glm::mat4 _curr_v_matrix;
         glm::mat4 _curr_p_matrix;
 
+        template<typename MaterialTy>
+        void render(std::vector<render_command_t<MaterialTy>>& render_commands);
         void render();
     public:
         /**
@@ -38,8 +60,9 @@ namespace pgre {
         void recompile_shaders();
         
         void begin_scene(scene::scene_t& scene) override;
-        void submit(const glm::mat4& transform, std::shared_ptr<primitives::vertex_array_t> vao,
-                    std::shared_ptr<material_t> material, GLenum primitive = GL_TRIANGLES) override;
+        void submit(const glm::mat4& transform, asset_handle_t<primitives::vertex_array_t> vao,
+                    material_handle_t material, GLenum primitive = GL_TRIANGLES,
+                    float screen_size = std::numeric_limits<float>::infinity()) override;
         void end_scene() override;
 
         void on_resize(const glm::ivec2& new_win_dims) override {
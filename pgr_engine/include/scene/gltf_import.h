@@ -0,0 +1,29 @@
+#pragma once
+#include <scene/imported_scene.h>
+
+#include <filesystem>
+
+namespace pgre::scene {
+
+/**
+ * @brief Whether the file is glTF 2.0 (.gltf or .glb), which is read by import_gltf rather than
+ * assimp.
+ */
+bool is_gltf(const std::filesystem::path& path);
+
+/**
+ * @brief Reads a glTF 2.0 file without assimp. Buffers are mapped (or decoded, for data URIs)
+ * once, and accessors are described to OpenGL as they are, so vertex and index data is uploaded
+ * straight from the buffers, grouped by buffer view. Only texture coordinates are converted, as
+ * textures are loaded bottom row first. The import options processing meshes don't apply.
+ *
+ * Supports triangle primitives, KHR_lights_punctual lights and base color textures, either
+ * external or embedded, which are left encoded in their buffer view. Primitives using other
+ * modes or sparse accessors are skipped.
+ *
+ * @return imported_scene_t the scene, without source and options keys
+ * @throws std::runtime_error if the file can't be read or isn't valid glTF.
+ */
+imported_scene_t import_gltf(const std::filesystem::path& path);
+
+} // namespace pgre::scene
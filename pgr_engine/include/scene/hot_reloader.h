@@ -0,0 +1,103 @@
+#pragma once
+#include <scene/scene_import.h>
+#include <utility/file_watcher.h>
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace pgre::scene {
+
+/**
+ * @brief Reloads assets in place when their files change on disk: textures and cubemaps in
+ * asset_registry_t, and the meshes of scene files imported since hot reloading was enabled.
+ * Meshes are imported again on a worker thread, then swapped into the vertex arrays the
+ * entities already reference, so nothing has to be deserialized or imported into the scene
+ * again. Caches and atlases written by imports don't trigger reloads.
+ *
+ * Use from the GL thread.
+ */
+class hot_reloader_t
+{
+    struct tracked_import_t
+    {
+        std::filesystem::path scene_file;
+        import_options_t options;
+        std::vector<asset_handle_t<primitives::vertex_array_t>> vertex_arrays;
+    };
+
+    struct pending_reload_t
+    {
+        tracked_import_t import;
+        std::shared_ptr<import_job_t> reimport;
+    };
+
+    std::unique_ptr<file_watcher_t> _watcher{nullptr};
+    std::vector<tracked_import_t> _imports{};
+    std::vector<pending_reload_t> _reloads{};
+    /**
+     * @brief Bounding boxes of reloaded meshes by vertex array handle value, for scenes to
+     * update their entities with.
+     */
+    std::unordered_map<uint32_t, std::pair<glm::vec3, glm::vec3>> _reloaded_bounds{};
+    uint32_t _revision{0};
+
+    hot_reloader_t() = default;
+
+    /**
+     * @brief Whether the file is written by imports themselves, a cache or an atlas.
+     */
+    [[nodiscard]] bool is_import_output(const std::filesystem::path& file) const;
+    void start_reload(const tracked_import_t& import);
+    /**
+     * @brief Swaps in the meshes of the reloads whose files are read.
+     */
+    void finish_reloads();
+    void swap_meshes(const tracked_import_t& import,
+                     const std::vector<import_job_t::reimported_mesh_t>& meshes);
+
+public:
+    hot_reloader_t(const hot_reloader_t&) = delete;
+    hot_reloader_t& operator=(const hot_reloader_t&) = delete;
+
+    static hot_reloader_t& get();
+
+    /**
+     * @brief Starts watching a directory and its subdirectories, which enables hot reloading.
+     *
+     * @return false if file watching isn't supported or the directory can't be watched.
+     */
+    bool watch(const std::filesystem::path& directory);
+    [[nodiscard]] bool is_enabled() const { return _watcher != nullptr; }
+
+    /**
+     * @brief Remembers the vertex arrays created by an import, by mesh index, to reload them
+     * when the file changes. Does nothing unless enabled.
+     */
+    void track_import(const std::filesystem::path& scene_file, const import_options_t& options,
+                      const std::vector<asset_ref_t<primitives::vertex_array_t>>& vertex_arrays);
+
+    /**
+     * @brief Reloads the assets of the files changed since the last call, and swaps in meshes
+     * reimported since. Call once per frame.
+     */
+    void update();
+
+    /**
+     * @brief Incremented whenever meshes are reloaded.
+     */
+    [[nodiscard]] uint32_t get_revision() const { return _revision; }
+    /**
+     * @brief Get the bounding box of a reloaded mesh, nullopt if the vertex array wasn't
+     * reloaded.
+     */
+    [[nodiscard]] std::optional<std::pair<glm::vec3, glm::vec3>>
+      find_reloaded_bounds(asset_handle_t<primitives::vertex_array_t> vertex_array) const;
+};
+
+} // namespace pgre::scene
@@ -0,0 +1,213 @@
+#pragma once
+#include <primitives/mesh_data.h>
+#include <utility/vfs.h>
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace pgre::scene {
+
+/**
+ * @brief Node of an imported scene hierarchy.
+ */
+struct imported_node_t
+{
+    constexpr static uint32_t no_parent = UINT32_MAX;
+
+    std::string name{};
+    glm::mat4 transform{1.0f};
+    /**
+     * @brief Index of the parent in imported_scene_t::nodes, parents come before their
+     * children, no_parent for the root.
+     */
+    uint32_t parent_ix = no_parent;
+    /**
+     * @brief Indices in imported_scene_t::meshes.
+     */
+    std::vector<uint32_t> mesh_indices{};
+};
+
+/**
+ * @brief Material parameters read from the file, turned into a phong_material_t on the GL thread.
+ */
+struct imported_material_t
+{
+    glm::vec3 diffuse{1.0f};
+    glm::vec3 ambient{1.0f};
+    glm::vec3 specular{1.0f};
+    float shininess{1.0f};
+    float transparency{0.0f};
+    /**
+     * @brief Empty if the material has no diffuse texture.
+     */
+    std::filesystem::path color_texture_path{};
+    /**
+     * @brief Set if the color texture was packed into an atlas.
+     */
+    std::optional<size_t> atlas_ix{};
+    /**
+     * @brief Set instead of color_texture_path if the color texture is embedded in the file,
+     * index in imported_scene_t::embedded_textures.
+     */
+    std::optional<uint32_t> embedded_texture_ix{};
+};
+
+/**
+ * @brief Texture embedded in the imported file, decoded by the import.
+ */
+struct embedded_texture_t
+{
+    /**
+     * @brief The encoded image (PNG, JPEG...) if height is 0, otherwise width x height BGRA8
+     * texels.
+     */
+    std::span<const uint8_t> data{};
+    uint32_t width{};
+    uint32_t height{};
+
+    [[nodiscard]] bool is_encoded() const { return height == 0; }
+};
+
+struct imported_light_t
+{
+    enum class type_t : uint32_t
+    {
+        sun,
+        point,
+        spot
+    };
+
+    type_t type{type_t::point};
+    /**
+     * @brief Name of the node the light is attached to.
+     */
+    std::string node_name{};
+    glm::vec3 ambient{0.0f};
+    glm::vec3 diffuse{0.0f};
+    glm::vec3 specular{0.0f};
+    glm::vec3 direction{0.0f};
+    /**
+     * @brief Constant, linear and quadratic attenuation.
+     */
+    glm::vec3 attenuation{1.0f, 0.0f, 0.0f};
+    float outer_cone_angle{0.0f};
+    float inner_cone_angle{0.0f};
+};
+
+/**
+ * @brief Everything an import creates assets and entities from, in the engine's own terms. Cached
+ * in the .pgmesh format next to the source file, so later imports map the cache instead of
+ * parsing the source again, and upload mesh data straight from the mapped file.
+ */
+class imported_scene_t
+{
+    std::vector<primitives::mesh_data_t> _mesh_data{};
+    std::vector<vfs_file_t> _files{};
+    std::vector<std::vector<uint8_t>> _buffers{};
+
+public:
+    constexpr static std::array<char, 4> magic{'P', 'G', 'M', 'S'};
+    constexpr static uint32_t format_version = 5;
+
+    /**
+     * @brief Key of the source file contents, see asset_registry_t::get_file_key.
+     */
+    std::string source_key{};
+    /**
+     * @brief Key of the import options the scene was imported with.
+     */
+    std::string options_key{};
+
+    /**
+     * @brief Nodes in depth first order, the root first.
+     */
+    std::vector<imported_node_t> nodes{};
+    std::vector<imported_material_t> materials{};
+    /**
+     * @brief Texture atlases written by the import, see imported_material_t::atlas_ix.
+     */
+    std::vector<std::filesystem::path> atlas_paths{};
+    /**
+     * @brief Views of embedded textures, in data owned by the imported scene, the mapped cache
+     * file or, while it's alive, the scene read by assimp.
+     */
+    std::vector<embedded_texture_t> embedded_textures{};
+    std::vector<imported_light_t> lights{};
+    /**
+     * @brief Views of mesh data owned by the imported scene, either converted by the import or
+     * in the mapped cache file.
+     */
+    std::vector<primitives::mesh_view_t> meshes{};
+    /**
+     * @brief Index of the mesh whose vertex array each mesh uses, the mesh's own index unless
+     * it duplicates an earlier mesh's geometry, in which case its own data is released.
+     */
+    std::vector<uint32_t> geometry_sources{};
+
+    /**
+     * @brief Takes over converted meshes and sets meshes to view them, each mesh being its own
+     * geometry source.
+     */
+    void set_mesh_data(std::vector<primitives::mesh_data_t>&& mesh_data);
+    /**
+     * @brief Keeps a file mesh views point into alive as long as the imported scene.
+     */
+    std::span<const std::byte> add_file(vfs_file_t&& file);
+    /**
+     * @brief Keeps data mesh views point into alive as long as the imported scene, the data
+     * doesn't move.
+     */
+    std::span<const uint8_t> add_buffer(std::vector<uint8_t>&& data);
+    /**
+     * @brief Frees vertex and index data of a mesh once it's uploaded, the rest of the view is
+     * kept. Mapped data and added buffers are only freed with the imported scene.
+     */
+    void release_mesh_data(size_t mesh_ix);
+
+    /**
+     * @brief Get the path of the cache file for a source file.
+     */
+    static std::filesystem::path get_cache_path(const std::filesystem::path& source);
+
+    /**
+     * @brief Writes the scene in the .pgmesh format, through a temporary file, so a cache mapped
+     * by another import is never truncated. Paths are stored relative to the source's directory.
+     * Vertex streams aren't stored, meshes must keep their vertices interleaved.
+     *
+     * @param source source file the scene was imported from
+     * @throws std::runtime_error on failure.
+     */
+    void write(const std::filesystem::path& path, const std::filesystem::path& source) const;
+    /**
+     * @brief Writes the scene like write(), except that get_mesh produces the meshes one at a
+     * time, in order, so they never all have to be in memory. meshes and geometry_sources are
+     * ignored, no mesh shares geometry.
+     *
+     * @throws std::runtime_error on failure, or what get_mesh throws.
+     */
+    void write(const std::filesystem::path& path, const std::filesystem::path& source,
+               size_t mesh_count,
+               const std::function<primitives::mesh_data_t(size_t)>& get_mesh) const;
+
+    /**
+     * @brief Maps a .pgmesh file, mesh data is left in the mapping.
+     *
+     * @param source source file the scene was imported from, the cache is only used if its
+     * contents didn't change since. Its content hash is only computed if its size or write time
+     * changed.
+     * @param options_key key of the import options, must match the cached one
+     * @return std::optional<imported_scene_t> nullopt if the file doesn't exist, is out of date
+     * or isn't a .pgmesh file of this format version.
+     */
+    static std::optional<imported_scene_t> read(const std::filesystem::path& path,
+                                                const std::filesystem::path& source,
+                                                std::string_view options_key);
+};
+
+} // namespace pgre::scene
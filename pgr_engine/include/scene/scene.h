@@ -1,11 +1,12 @@
 #pragma once
 
-#include "assets/materials/phong_material.h"
+#include "assets/materials/all_materials.h"
 #include "components/hierarchy_component.h"
 #include "components/component_predecl.h"
 #include "layers/basic_layer.h"
 #include "primitives/vertex_array.h"
 #include "renderer/camera.h"
+#include "scene/scene_import.h"
 #include <components/light_components.h>
 #include <assimp/scene.h>
 #include <filesystem>
@@ -34,6 +35,23 @@ class scene_t {
 
     scene_lights_t _lights;
 
+    std::vector<std::shared_ptr<import_job_t>> _imports{};
+    float _import_frame_budget_ms = 4.0f;
+    /**
+     * @brief hot_reloader_t::get_revision() the bounding boxes are up to date with.
+     */
+    uint32_t _hot_reload_revision{0};
+
+    /**
+     * @brief Continues running imports for at most the import frame budget, dropping finished
+     * ones.
+     */
+    void process_imports();
+    /**
+     * @brief Updates the bounding boxes of entities whose meshes were hot reloaded.
+     */
+    void update_reloaded_bounds();
+
 public:
     scene_t();
 
@@ -54,10 +72,32 @@ public:
      * @brief Loads a single node or a node hierarchy from an asiimp supported scene format.
      *
      * @param scene_file path to scene file.
+     * @param options import options.
      * @return std::optional<entity_t> the root entity of the loaded hierarchy or std::nullopt if
      * nothing to load.
      */
-    std::optional<entity_t> import_from_file (const std::filesystem::path& scene_file);
+    std::optional<entity_t> import_from_file (const std::filesystem::path& scene_file, const import_options_t& options = {});
+    /**
+     * @brief Starts importing a scene file without blocking. The file is read and converted on
+     * worker threads, update() then creates the assets and entities within the import frame
+     * budget.
+     *
+     * @param scene_file path to scene file.
+     * @param options import options.
+     * @return std::shared_ptr<import_job_t> the import, for progress and the root entity.
+     */
+    std::shared_ptr<import_job_t> import_from_file_async(const std::filesystem::path& scene_file,
+                                                         const import_options_t& options = {});
+    /**
+     * @brief Set the time update() spends at most on continuing imports each frame.
+     */
+    void set_import_frame_budget(float milliseconds) { _import_frame_budget_ms = milliseconds; }
+    /**
+     * @brief Get the imports that are still running.
+     */
+    [[nodiscard]] const std::vector<std::shared_ptr<import_job_t>>& get_imports() const {
+        return _imports;
+    }
     /**
      * @brief Make an entity_t helper class instance for the provided in entity handle.
      */
@@ -126,6 +166,8 @@ public:
 
     /**
      * @brief Saves all entities and components in the scene to a file.
+     * Also writes a manifest of the files its assets are loaded from next to it, see
+     * get_manifest_path.
      * 
      * @param filename path to the target file (will be created/overwritten);
      */
@@ -133,12 +175,19 @@ public:
 
     /**
      * @brief Loads all entities and components into a new scene.
+     * Files listed in the manifest are prefetched as one batch before the assets are created.
      * 
      * @param filename path to the source file (must exist, duh);
      * @return std::shared_ptr<scene_t> ptr to scene loaded from file.
      */
     static std::shared_ptr<scene_t> deserialize(const std::filesystem::path& filename);
 
+    /**
+     * @brief Get the path of the manifest of a serialized scene, listing the files its assets
+     * are loaded from, one per line.
+     */
+    static std::filesystem::path get_manifest_path(const std::filesystem::path& filename);
+
     template<typename ComponentTy,
              std::predicate<std::add_lvalue_reference_t<ComponentTy>> PredicateTy>
     bool any_component(PredicateTy&& unary_predicate) {
@@ -160,15 +209,10 @@ public:
     bool test_bb_collision(const glm::vec3& box_position_world, float box_size);
 
     friend struct entity_t;
+    friend class import_job_t;
 
 private: //methods
     void on_camera_component_remove(entt::registry& registry, entt::entity newly_not_a_camera_holder);
-
-    void
-      hierarchy_import_rec(entity_t& parent, aiNode* node,
-                           std::vector<std::shared_ptr<phong_material_t>>& materials,
-                           std::vector<std::pair<std::shared_ptr<primitives::vertex_array_t>, std::pair<glm::vec3, glm::vec3>>>& vertex_arrays,
-                           const aiScene* ai_scene);
 };
 
 }  // namespace pgre::scene
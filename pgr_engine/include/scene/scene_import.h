@@ -0,0 +1,204 @@
+#pragma once
+#include <assets/asset_table.h>
+#include <assets/materials/all_materials.h>
+#include <primitives/vertex_array.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+namespace pgre::scene {
+
+class scene_t;
+struct entity_t;
+
+/**
+ * @brief Options for scene_t::import_from_file.
+ */
+struct import_options_t {
+    /**
+     * @brief Load textures BC1/BC3 compressed with full mip chains, cooked once and cached next to
+     * the source images.
+     */
+    bool compress_textures = false;
+    /**
+     * @brief Pack small diffuse textures into shared atlases, written next to the scene file.
+     * Only done for materials whose meshes' UVs all lie in [0, 1], as wrapping can't be atlased.
+     */
+    bool build_texture_atlases = false;
+    /**
+     * @brief Textures larger than this in either dimension are left out of atlases.
+     */
+    uint32_t atlas_max_texture_size = 256;
+    uint32_t atlas_size = 2048;
+    /**
+     * @brief Edge pixels are repeated this many times around each texture to avoid bleeding.
+     */
+    uint32_t atlas_padding = 4;
+    /**
+     * @brief Reorder triangles for post-transform vertex cache efficiency and less overdraw, and
+     * vertices for fetch locality.
+     */
+    bool optimize_meshes = true;
+    /**
+     * @brief Pack vertices to half their size, with quantized positions, normals and UVs, and use
+     * 16-bit indices for meshes with fewer than 65535 vertices.
+     */
+    bool compact_vertices = false;
+    /**
+     * @brief Merge vertices whose positions, normals and UVs differ by at most the epsilons.
+     */
+    bool weld_vertices = true;
+    float weld_position_epsilon = 1e-6f;
+    float weld_normal_epsilon = 1e-3f;
+    float weld_uv_epsilon = 1e-6f;
+    /**
+     * @brief Meshes with identical geometry share one vertex array.
+     */
+    bool deduplicate_meshes = true;
+    /**
+     * @brief Meshes with more triangles are split into clusters of at most this many, each with
+     * its own vertex array and bounding box, 0 keeps meshes whole. Up to 21845 triangles keep
+     * clusters below 65536 vertices, so compact vertices get 16-bit indices.
+     */
+    uint32_t cluster_triangle_count = 0;
+    /**
+     * @brief Convert clusters straight into the .pgmesh cache, a few at a time, and upload them
+     * from the mapped cache, so memory use doesn't grow with mesh size beyond assimp's copy of
+     * the file. Meshes aren't deduplicated.
+     */
+    bool stream_meshes = false;
+};
+
+/**
+ * @brief An import of a scene file. The file is read, and its meshes converted, on worker
+ * threads, then the scene creates the assets and entities on the GL thread a few at a time, see
+ * scene_t::import_from_file_async.
+ */
+class import_job_t
+{
+public:
+    enum class stage_t
+    {
+        reading,
+        creating_assets,
+        creating_entities,
+        done,
+        failed
+    };
+
+private:
+    /**
+     * @brief Output of prepare(), defined in scene_import.cpp.
+     */
+    struct prepared_t;
+
+    /**
+     * @brief Null when cooking, only the cache is written then.
+     */
+    scene_t* _scene;
+    std::filesystem::path _scene_file;
+    import_options_t _options;
+
+    stage_t _stage = stage_t::reading;
+    std::future<std::unique_ptr<prepared_t>> _preparing{};
+    std::unique_ptr<prepared_t> _prepared{};
+
+    std::atomic<uint32_t> _mesh_count{0};
+    std::atomic<uint32_t> _converted_mesh_count{0};
+    std::atomic<uint32_t> _node_count{0};
+
+    std::vector<std::shared_ptr<texture2D_t>> _atlases{};
+    std::vector<std::shared_ptr<texture2D_t>> _embedded_textures{};
+    std::vector<material_ref_t> _materials{};
+    std::vector<asset_ref_t<primitives::vertex_array_t>> _vertex_arrays{};
+    /**
+     * @brief Entities created for the imported nodes so far, by node index.
+     */
+    std::vector<entt::entity> _node_entities{};
+    entt::entity _root{entt::null};
+
+    friend class scene_t;
+
+    import_job_t(std::filesystem::path scene_file, import_options_t options);
+
+    /**
+     * @brief Maps the file's mesh cache if it's up to date, otherwise reads the file, converts
+     * meshes and writes the cache. Doesn't touch OpenGL.
+     */
+    std::unique_ptr<prepared_t> prepare();
+    /**
+     * @brief Continues the import until it's done or deadline passes. Call on the GL thread.
+     *
+     * @return true once done or failed.
+     */
+    bool process(std::chrono::steady_clock::time_point deadline);
+    void start_creating_assets();
+    void create_next_asset();
+    void create_next_entity();
+
+public:
+    import_job_t(scene_t& scene, std::filesystem::path scene_file, import_options_t options);
+    ~import_job_t();
+    import_job_t(const import_job_t&) = delete;
+    import_job_t& operator=(const import_job_t&) = delete;
+
+    /**
+     * @brief Reads the file and writes its mesh cache, unless it's up to date, so imports with
+     * the same options only map the cache. Doesn't touch OpenGL, see pgre_cook.
+     *
+     * @return true if the cache was written, false if it was up to date or the file isn't
+     * cached (glTF).
+     * @throws std::runtime_error if the file can't be imported or the cache can't be written.
+     */
+    static bool cook(const std::filesystem::path& scene_file, const import_options_t& options);
+
+    /**
+     * @brief Mesh uploaded by reimport_meshes().
+     */
+    struct reimported_mesh_t
+    {
+        asset_ref_t<primitives::vertex_array_t> vertex_array;
+        std::pair<glm::vec3, glm::vec3> aabb;
+    };
+
+    /**
+     * @brief Starts importing the file again on a worker thread, for hot_reloader_t, see
+     * reimport_meshes().
+     */
+    static std::shared_ptr<import_job_t> start_reimport(const std::filesystem::path& scene_file,
+                                                        const import_options_t& options);
+    /**
+     * @brief Uploads the meshes of a reimport once its file is read, without creating materials
+     * or entities, nor registering the vertex arrays. Meshes sharing geometry share a vertex
+     * array like in a regular import. Call on the GL thread until it returns the meshes.
+     *
+     * @return std::optional<std::vector<reimported_mesh_t>> the meshes by mesh index, nullopt
+     * while the file is still read.
+     * @throws std::runtime_error if the file can't be imported.
+     */
+    static std::optional<std::vector<reimported_mesh_t>> reimport_meshes(import_job_t& reimport);
+
+    [[nodiscard]] stage_t get_stage() const { return _stage; }
+    [[nodiscard]] bool is_done() const {
+        return _stage == stage_t::done || _stage == stage_t::failed;
+    }
+    /**
+     * @brief Rough fraction of the work done, for display.
+     */
+    [[nodiscard]] float get_progress() const;
+    [[nodiscard]] const std::filesystem::path& get_scene_file() const { return _scene_file; }
+    /**
+     * @brief Get the root entity of the imported hierarchy, available from the
+     * creating_entities stage on. Invalid once the scene is destroyed.
+     */
+    [[nodiscard]] std::optional<entity_t> get_root() const;
+};
+
+} // namespace pgre::scene
@@ -0,0 +1,25 @@
+#pragma once
+#include <utility/vfs.h>
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+namespace pgre::scene {
+
+/**
+ * @brief Read-only assimp IO system opening files through vfs_t, so scenes and the files they
+ * reference are read in place from mounted archives or mapped files.
+ */
+class vfs_io_system_t : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char* file) const override;
+    [[nodiscard]] char getOsSeparator() const override { return '/'; }
+    /**
+     * @return Assimp::IOStream* null if the file doesn't exist or mode isn't a read mode.
+     */
+    Assimp::IOStream* Open(const char* file, const char* mode) override;
+    void Close(Assimp::IOStream* stream) override;
+};
+
+} // namespace pgre::scene
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Reads whole files as one batch. On Linux all reads are submitted at once through
+ * io_uring, elsewhere, or where io_uring isn't available, the files are read in parallel on
+ * thread_pool_t::get_global().
+ */
+class batch_reader_t
+{
+public:
+    /**
+     * @brief Called with the index of the file in the batch and its contents, nullopt if it
+     * couldn't be read.
+     */
+    using on_read_t
+      = std::function<void(size_t file_ix, std::optional<std::vector<std::byte>>&& contents)>;
+
+    /**
+     * @brief Reads the files, calling on_read for each one as soon as its read completes, from
+     * the thread reaping io_uring completions or a pool worker, so on_read should hand decoding
+     * to other workers. Blocks until all files are read and on_read returned for each of them.
+     * Must not be called from a worker of the global pool.
+     *
+     * @throws std::runtime_error if io_uring fails after it was set up.
+     */
+    static void read(const std::vector<std::filesystem::path>& paths, const on_read_t& on_read);
+
+    [[nodiscard]] static bool is_io_uring_available();
+};
+
+} // namespace pgre
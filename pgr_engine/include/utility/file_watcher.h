@@ -0,0 +1,45 @@
+#pragma once
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Watches directories, recursively, for files written or moved into them, with inotify
+ * on Linux. Elsewhere nothing can be watched.
+ */
+class file_watcher_t
+{
+    int _fd = -1;
+    /**
+     * @brief Watched directories by watch descriptor.
+     */
+    std::unordered_map<int, std::filesystem::path> _directories{};
+
+    void add_watch(const std::filesystem::path& directory);
+
+public:
+    file_watcher_t();
+    ~file_watcher_t();
+
+    file_watcher_t(const file_watcher_t&) = delete;
+    file_watcher_t& operator=(const file_watcher_t&) = delete;
+
+    [[nodiscard]] static bool is_supported();
+
+    /**
+     * @brief Watches directory and its subdirectories, including ones created later.
+     *
+     * @throws std::runtime_error if file watching isn't supported, or directory can't be watched.
+     */
+    void watch(const std::filesystem::path& directory);
+
+    /**
+     * @brief Get the absolute paths of the files changed since the last call, each only once.
+     * Doesn't block.
+     */
+    std::vector<std::filesystem::path> poll();
+};
+
+} // namespace pgre
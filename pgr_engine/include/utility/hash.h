@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pgre {
+
+constexpr uint64_t fnv1a_offset_basis = 0xcbf29ce484222325ULL;
+constexpr uint64_t fnv1a_prime = 0x100000001b3ULL;
+
+/**
+ * @brief 64-bit FNV-1a hash of size bytes at data.
+ *
+ * @param seed previous hash, to hash data in several parts
+ */
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = fnv1a_offset_basis) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed ^= bytes[i];
+        seed *= fnv1a_prime;
+    }
+    return seed;
+}
+
+/**
+ * @brief Mixes value into seed, for hashing several already hashed values together.
+ */
+constexpr uint64_t hash_combine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6U) + (seed >> 2U));
+}
+
+} // namespace pgre
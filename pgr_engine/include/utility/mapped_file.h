@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace pgre {
+
+/**
+ * @brief Read-only memory mapping of a whole file. Pages are loaded by the OS as they're first
+ * accessed, so mapping even a large file is cheap.
+ */
+class mapped_file_t
+{
+    const std::byte* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _file_handle = nullptr;
+    void* _mapping_handle = nullptr;
+#endif
+
+    mapped_file_t() = default;
+    void unmap();
+
+public:
+    /**
+     * @brief Maps the file at path.
+     *
+     * @return std::optional<mapped_file_t> nullopt if the file can't be opened or mapped.
+     */
+    static std::optional<mapped_file_t> map(const std::filesystem::path& path);
+
+    ~mapped_file_t();
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+    /**
+     * @brief Takes over the mapping, the mapped memory doesn't move.
+     */
+    mapped_file_t(mapped_file_t&& other) noexcept;
+    mapped_file_t& operator=(mapped_file_t&& other) noexcept;
+
+    [[nodiscard]] std::span<const std::byte> get_data() const { return {_data, _size}; }
+    [[nodiscard]] size_t get_size() const { return _size; }
+};
+
+} // namespace pgre
@@ -0,0 +1,235 @@
+#pragma once
+#include <utility/thread_pool.h>
+
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace pgre {
+
+template<typename T = void>
+class task_t;
+
+namespace detail {
+    struct task_promise_base_t
+    {
+        /**
+         * @brief The coroutine awaiting the task, resumed once it's done.
+         */
+        std::coroutine_handle<> continuation{std::noop_coroutine()};
+        std::exception_ptr exception{};
+
+        struct final_awaiter_t
+        {
+            [[nodiscard]] bool await_ready() const noexcept { return false; }
+            template<typename PromiseTy>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseTy> handle) noexcept {
+                return handle.promise().continuation;
+            }
+            void await_resume() const noexcept {}
+        };
+
+        [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+        [[nodiscard]] final_awaiter_t final_suspend() const noexcept { return {}; }
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct task_promise_t : task_promise_base_t
+    {
+        std::optional<T> value{};
+
+        task_t<T> get_return_object() noexcept;
+        template<typename ValueTy>
+        requires std::is_convertible_v<ValueTy&&, T>
+        void return_value(ValueTy&& result) {
+            value.emplace(std::forward<ValueTy>(result));
+        }
+        T take_result() {
+            if (exception) std::rethrow_exception(exception);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct task_promise_t<void> : task_promise_base_t
+    {
+        task_t<void> get_return_object() noexcept;
+        void return_void() const noexcept {}
+        void take_result() const {
+            if (exception) std::rethrow_exception(exception);
+        }
+    };
+
+    /**
+     * @brief Coroutine that starts right away and frees itself once done, see spawn().
+     */
+    struct detached_task_t
+    {
+        struct promise_type
+        {
+            detached_task_t get_return_object() const noexcept { return {}; }
+            [[nodiscard]] std::suspend_never initial_suspend() const noexcept { return {}; }
+            [[nodiscard]] std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine producing a T. It runs once awaited, and resumes the awaiting
+ * coroutine when done, on whatever thread it finished on. Exceptions are rethrown to the
+ * awaiting coroutine. Start top level tasks with spawn().
+ */
+template<typename T>
+class [[nodiscard]] task_t
+{
+public:
+    using promise_type = detail::task_promise_t<T>;
+
+private:
+    std::coroutine_handle<promise_type> _handle{};
+
+    explicit task_t(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+    friend promise_type;
+
+public:
+    task_t() = default;
+    ~task_t() {
+        if (_handle) _handle.destroy();
+    }
+    task_t(const task_t&) = delete;
+    task_t& operator=(const task_t&) = delete;
+    task_t(task_t&& other) noexcept : _handle(std::exchange(other._handle, {})) {}
+    task_t& operator=(task_t&& other) noexcept {
+        if (this == &other) return *this;
+        if (_handle) _handle.destroy();
+        _handle = std::exchange(other._handle, {});
+        return *this;
+    }
+
+    /**
+     * @brief Starts the task, the awaiting coroutine is resumed with its result. A task can be
+     * awaited only once.
+     */
+    auto operator co_await() const noexcept {
+        struct awaiter_t
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            [[nodiscard]] bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().take_result(); }
+        };
+        return awaiter_t{_handle};
+    }
+};
+
+namespace detail {
+    template<typename T>
+    task_t<T> task_promise_t<T>::get_return_object() noexcept {
+        return task_t<T>{std::coroutine_handle<task_promise_t<T>>::from_promise(*this)};
+    }
+
+    inline task_t<void> task_promise_t<void>::get_return_object() noexcept {
+        return task_t<void>{std::coroutine_handle<task_promise_t<void>>::from_promise(*this)};
+    }
+} // namespace detail
+
+/**
+ * @brief Coroutines waiting to continue on the GL thread, resumed by app_t's main loop once per
+ * frame.
+ */
+class gl_thread_queue_t
+{
+    std::mutex _mutex{};
+    std::vector<std::coroutine_handle<>> _pending{};
+    std::thread::id _gl_thread_id{};
+
+    gl_thread_queue_t() = default;
+
+public:
+    gl_thread_queue_t(const gl_thread_queue_t&) = delete;
+    gl_thread_queue_t& operator=(const gl_thread_queue_t&) = delete;
+
+    static gl_thread_queue_t& get();
+
+    /**
+     * @brief Makes the calling thread the GL thread, done by app_t once the context is created.
+     */
+    void set_gl_thread();
+    [[nodiscard]] bool is_gl_thread() const;
+    void post(std::coroutine_handle<> handle);
+    /**
+     * @brief Resumes the coroutines posted so far, in order. Those posted meanwhile wait for the
+     * next call. Call on the GL thread.
+     */
+    void run_pending();
+};
+
+/**
+ * @brief Awaiting it continues the coroutine on a worker of pool. Don't block on futures of work
+ * submitted to the same pool from there, continue on another pool instead.
+ * thread_pool_t::parallel_for is fine, the calling worker runs its chunks.
+ */
+inline auto on_worker(thread_pool_t& pool = thread_pool_t::get_global()) {
+    struct awaiter_t
+    {
+        thread_pool_t& pool;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) const {
+            // the coroutine owns its state, the future isn't needed
+            static_cast<void>(pool.submit([handle]() { handle.resume(); }));
+        }
+        void await_resume() const noexcept {}
+    };
+    return awaiter_t{pool};
+}
+
+/**
+ * @brief Awaiting it continues the coroutine on the GL thread, right away if it's already
+ * there, otherwise at the start of the next frame. Without an app_t it never continues.
+ */
+inline auto on_gl_thread() {
+    struct awaiter_t
+    {
+        [[nodiscard]] bool await_ready() const { return gl_thread_queue_t::get().is_gl_thread(); }
+        void await_suspend(std::coroutine_handle<> handle) const {
+            gl_thread_queue_t::get().post(handle);
+        }
+        void await_resume() const noexcept {}
+    };
+    return awaiter_t{};
+}
+
+/**
+ * @brief Starts a task without waiting for it, it runs on the calling thread until it first
+ * switches threads. Its result is dropped, exceptions escaping it are logged.
+ */
+template<typename T>
+void spawn(task_t<T> task) {
+    [](task_t<T> spawned) -> detail::detached_task_t {
+        try {
+            co_await spawned;
+        } catch (const std::exception& e) {
+            spdlog::error("Task failed: {}", e.what());
+        } catch (...) {
+            // detached_task_t terminates on anything escaping
+            spdlog::error("Task failed with an unknown exception");
+        }
+    }(std::move(task));
+}
+
+} // namespace pgre
@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Fixed size pool of worker threads executing submitted tasks in FIFO order.
+ */
+class thread_pool_t
+{
+    std::vector<std::thread> _workers{};
+    std::queue<std::function<void()>> _tasks{};
+    std::mutex _mutex{};
+    std::condition_variable _task_available{};
+    bool _stopping = false;
+
+    void worker_loop();
+
+public:
+    /**
+     * @param thread_count number of worker threads, defaults to the number of hardware threads.
+     */
+    explicit thread_pool_t(size_t thread_count = std::max(1U, std::thread::hardware_concurrency()));
+    /**
+     * @brief Finishes all queued tasks, then joins the worker threads.
+     */
+    ~thread_pool_t();
+
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+    /**
+     * @brief Get the engine-wide pool used for asset processing.
+     */
+    static thread_pool_t& get_global();
+
+    [[nodiscard]] size_t get_thread_count() const { return _workers.size(); }
+
+    /**
+     * @brief Queues func for execution on a worker thread.
+     *
+     * @return std::future holding the result, or the exception thrown by func.
+     */
+    template<typename FuncTy>
+    requires std::is_invocable_v<FuncTy>
+    auto submit(FuncTy&& func) -> std::future<std::invoke_result_t<FuncTy>> {
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<FuncTy>()>>(
+          std::forward<FuncTy>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock{_mutex};
+            _tasks.emplace([task]() { (*task)(); });
+        }
+        _task_available.notify_one();
+        return future;
+    }
+
+    /**
+     * @brief Calls func(ix) for each ix in [begin, end), split into chunks executed on the worker
+     * threads and the calling thread. Blocks until all calls are done, rethrows the first
+     * exception thrown by func. The calling thread keeps claiming chunks until none are left, so
+     * it can be a worker of the same pool.
+     */
+    template<typename FuncTy>
+    requires std::is_invocable_v<FuncTy, size_t>
+    void parallel_for(size_t begin, size_t end, FuncTy&& func) {
+        if (begin >= end) return;
+        const auto max_chunk_count = std::min(end - begin, get_thread_count());
+        const auto chunk_size = (end - begin + max_chunk_count - 1) / max_chunk_count;
+        const auto chunk_count = (end - begin + chunk_size - 1) / chunk_size;
+
+        struct state_t
+        {
+            std::atomic<size_t> next_chunk{0};
+            std::atomic<size_t> done_chunk_count{0};
+            std::mutex error_mutex{};
+            std::exception_ptr error{};
+        };
+        auto state = std::make_shared<state_t>();
+        // helpers starting after all chunks were claimed return without touching func
+        const auto run_chunks = [state, &func, begin, end, chunk_size, chunk_count]() {
+            for (auto chunk = state->next_chunk++; chunk < chunk_count;
+                 chunk = state->next_chunk++) {
+                try {
+                    const auto chunk_begin = begin + chunk * chunk_size;
+                    const auto chunk_end = std::min(chunk_begin + chunk_size, end);
+                    for (auto ix = chunk_begin; ix < chunk_end; ix++) func(ix);
+                } catch (...) {
+                    std::lock_guard lock{state->error_mutex};
+                    if (!state->error) state->error = std::current_exception();
+                }
+                if (++state->done_chunk_count == chunk_count) state->done_chunk_count.notify_all();
+            }
+        };
+        for (size_t helper = 1; helper < chunk_count; helper++) submit(run_chunks);
+        run_chunks();
+
+        // chunks claimed by other threads are already running
+        for (auto done = state->done_chunk_count.load(); done < chunk_count;
+             done = state->done_chunk_count.load()) {
+            state->done_chunk_count.wait(done);
+        }
+        if (state->error) std::rethrow_exception(state->error);
+    }
+};
+} // namespace pgre
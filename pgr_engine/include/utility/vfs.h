@@ -0,0 +1,215 @@
+#pragma once
+#include <utility/mapped_file.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pgre {
+
+/**
+ * @brief Mapped .pak archive, a table of contents followed by the contents of each file,
+ * aligned to entry_alignment. Files are accessed in place in the mapping.
+ */
+class pak_archive_t
+{
+public:
+    struct entry_t
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        /**
+         * @brief Content hash, as asset_registry_t::get_file_key computes it.
+         */
+        uint64_t hash = 0;
+    };
+
+    constexpr static std::array<char, 4> magic{'P', 'G', 'P', 'K'};
+    constexpr static uint32_t format_version = 1;
+    constexpr static uint64_t entry_alignment = 64;
+
+private:
+    mapped_file_t _mapping;
+    /**
+     * @brief Entries by path, relative to the archive's root, with '/' separators.
+     */
+    std::unordered_map<std::string, entry_t> _entries{};
+
+    explicit pak_archive_t(mapped_file_t&& mapping) : _mapping(std::move(mapping)) {}
+
+public:
+    /**
+     * @brief Maps an archive and reads its table of contents.
+     *
+     * @throws std::runtime_error if the file can't be mapped or isn't a .pak file of this
+     * format version.
+     */
+    static pak_archive_t open(const std::filesystem::path& path);
+
+    /**
+     * @brief Writes an archive of files, stored under their paths relative to root.
+     *
+     * @throws std::runtime_error if a file can't be read, isn't under root, or the archive
+     * can't be written.
+     */
+    static void write(const std::filesystem::path& path, const std::filesystem::path& root,
+                      const std::vector<std::filesystem::path>& files);
+
+    [[nodiscard]] const entry_t* find_entry(const std::string& key) const;
+    [[nodiscard]] std::span<const std::byte> get_data(const entry_t& entry) const {
+        return _mapping.get_data().subspan(entry.offset, entry.size);
+    }
+    [[nodiscard]] size_t get_entry_count() const { return _entries.size(); }
+};
+
+/**
+ * @brief Contents of a file opened through vfs_t, either in a mounted archive, a mapping of a
+ * loose file or a loose file read by vfs_t::prefetch.
+ */
+class vfs_file_t
+{
+    std::shared_ptr<const pak_archive_t> _archive{};
+    std::optional<mapped_file_t> _mapping{};
+    std::shared_ptr<const std::vector<std::byte>> _contents{};
+    std::span<const std::byte> _data{};
+
+public:
+    vfs_file_t(std::shared_ptr<const pak_archive_t> archive, std::span<const std::byte> data)
+      : _archive(std::move(archive)), _data(data) {}
+    explicit vfs_file_t(mapped_file_t&& mapping)
+      : _mapping(std::move(mapping)), _data(_mapping->get_data()) {}
+    explicit vfs_file_t(std::shared_ptr<const std::vector<std::byte>> contents)
+      : _contents(std::move(contents)), _data(*_contents) {}
+
+    /**
+     * @brief Get the contents, which don't move with the vfs_file_t and stay valid as long as
+     * it's alive.
+     */
+    [[nodiscard]] std::span<const std::byte> get_data() const { return _data; }
+    [[nodiscard]] size_t get_size() const { return _data.size(); }
+    [[nodiscard]] bool is_archived() const { return _archive != nullptr; }
+};
+
+/**
+ * @brief Virtual file system assets are read through. Files in mounted archives shadow loose
+ * files at the same path, so opening them doesn't touch the file system. Thread safe.
+ */
+class vfs_t
+{
+    struct mount_t
+    {
+        std::shared_ptr<const pak_archive_t> archive;
+        std::filesystem::path root;
+    };
+
+    /**
+     * @brief Contents of a prefetched file, nullptr if it couldn't be read.
+     */
+    using prefetched_t = std::shared_future<std::shared_ptr<const std::vector<std::byte>>>;
+
+    struct prefetched_entry_t
+    {
+        prefetched_t contents;
+        /**
+         * @brief Number of hold_prefetched() calls not released yet.
+         */
+        uint32_t hold_count = 0;
+        /**
+         * @brief Whether drop_prefetched() was called while the entry was held.
+         */
+        bool dropped = false;
+    };
+
+    mutable std::shared_mutex _mutex{};
+    std::vector<mount_t> _mounts{};
+    mutable std::mutex _prefetch_mutex{};
+    /**
+     * @brief Prefetched files by absolute path, until they're opened.
+     */
+    mutable std::unordered_map<std::string, prefetched_entry_t> _prefetched{};
+
+    vfs_t() = default;
+
+    /**
+     * @brief Get the prefetched contents of path, removing the entry if take is set.
+     */
+    [[nodiscard]] std::optional<prefetched_t> find_prefetched(const std::filesystem::path& path,
+                                                              bool take) const;
+
+    /**
+     * @brief Finds the entry of path in the most recently mounted archive containing it.
+     */
+    [[nodiscard]] std::optional<std::pair<std::shared_ptr<const pak_archive_t>,
+                                          pak_archive_t::entry_t>>
+      find(const std::filesystem::path& path) const;
+
+public:
+    static vfs_t& get();
+
+    /**
+     * @brief Mounts an archive, its files are found at their stored paths relative to root.
+     * Archives mounted later take precedence.
+     *
+     * @param root directory relative paths are looked up from, the current directory if empty.
+     * @throws std::runtime_error if the archive can't be opened.
+     */
+    void mount(const std::filesystem::path& pak_path, const std::filesystem::path& root = {});
+    /**
+     * @brief Unmounts all archives, files opened from them stay valid.
+     */
+    void unmount_all();
+
+    /**
+     * @brief Starts reading loose files that are about to be opened as one batch_reader_t batch,
+     * in the background. Opening a prefetched file waits for its read instead of mapping it, the
+     * contents are only kept until the file is opened once, or drop_prefetched() is called while
+     * they aren't held.
+     * Files in mounted archives and files already prefetched are skipped.
+     */
+    void prefetch(const std::vector<std::filesystem::path>& paths);
+    /**
+     * @brief Frees the contents of prefetched files that weren't opened, except held ones.
+     */
+    void drop_prefetched();
+    /**
+     * @brief Keeps the prefetched contents of paths past drop_prefetched(), for files opened
+     * later on another thread. Each call must be paired with release_prefetched().
+     */
+    void hold_prefetched(const std::vector<std::filesystem::path>& paths);
+    /**
+     * @brief Releases a hold_prefetched() call, contents dropped meanwhile that weren't opened are
+     * freed.
+     */
+    void release_prefetched(const std::vector<std::filesystem::path>& paths);
+
+    /**
+     * @brief Opens a file in a mounted archive, or takes the prefetched contents or maps the
+     * loose file.
+     *
+     * @return std::optional<vfs_file_t> nullopt if neither exists.
+     */
+    [[nodiscard]] std::optional<vfs_file_t> open(const std::filesystem::path& path) const;
+    /**
+     * @brief Opens a file like open(), but leaves prefetched contents to the next open() and
+     * only uses them if they're already read. For reading headers.
+     */
+    [[nodiscard]] std::optional<vfs_file_t> peek(const std::filesystem::path& path) const;
+    [[nodiscard]] bool exists(const std::filesystem::path& path) const;
+    /**
+     * @brief Get the entry of a file in a mounted archive, nullopt for loose files.
+     */
+    [[nodiscard]] std::optional<pak_archive_t::entry_t>
+      find_archived(const std::filesystem::path& path) const;
+};
+
+} // namespace pgre
@@ -1,7 +1,11 @@
 
 #include <events/keyboard_events.h>
+#include <assets/textures/mip_streamer.h>
+#include <assets/textures/texture_streamer.h>
 #include <renderer/renderer.h>
+#include <scene/hot_reloader.h>
 #include <utility/call_at_scope_exit.h>
+#include <utility/task.h>
 #include <app.h>
 
 namespace pgre {
@@ -53,6 +57,7 @@ app_t::app_t(uint16_t width, uint16_t height, const std::string& title, bool vsy
 
     detail::load_gl_funcs();
     err::setup_ogl_debug_callback();
+    gl_thread_queue_t::get().set_gl_thread();
 
     if (vsync)
         glfwSwapInterval(1);
@@ -99,7 +104,10 @@ void app_t::register_callbacks() {
                        });
 }
 
-app_t::~app_t() { _window.reset(); }
+app_t::~app_t() {
+    texture_streamer_t::get().shutdown();
+    _window.reset();
+}
 
 void app_t::push_layer(std::shared_ptr<layers::basic_layer_t> layer) {
     layer->on_attach();
@@ -137,6 +145,10 @@ void app_t::main_loop() {
             delta = timer.get_interval();
         }
         timer.reset();
+        gl_thread_queue_t::get().run_pending();
+        scene::hot_reloader_t::get().update();
+        mip_streamer_t::get().update();
+        texture_streamer_t::get().pump();
         for (auto&& layer : _layers) {
             layer->on_update(delta);
         }
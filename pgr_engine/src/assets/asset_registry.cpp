@@ -0,0 +1,235 @@
+#include <assets/asset_registry.h>
+#include <utility/hash.h>
+#include <utility/vfs.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace pgre {
+
+asset_registry_t& asset_registry_t::get() {
+    static asset_registry_t registry{};
+    return registry;
+}
+
+void asset_registry_t::sweep() {
+    if (++_insertions_since_sweep <= (_assets.size() + _handles.size()) / 2) return;
+    std::erase_if(_assets, [](const auto& item) { return item.second.expired(); });
+    std::erase_if(_handles,
+                  [](const auto& item) { return !item.second.is_alive(item.second.handle); });
+    _insertions_since_sweep = 0;
+}
+
+void asset_registry_t::insert(std::type_index type, const std::string& key,
+                              std::weak_ptr<void> asset) {
+    _assets[{type, key}] = std::move(asset);
+    sweep();
+}
+
+void asset_registry_t::insert(std::type_index type, const std::string& key,
+                              handle_entry_t asset) {
+    _handles.insert_or_assign({type, key}, asset);
+    sweep();
+}
+
+std::shared_ptr<void> asset_registry_t::find(std::type_index type, const std::string& key) const {
+    if (auto it = _assets.find({type, key}); it != _assets.end()) return it->second.lock();
+    return nullptr;
+}
+
+uint32_t asset_registry_t::find_handle(std::type_index type, const std::string& key) const {
+    if (auto it = _handles.find({type, key}); it != _handles.end()) return it->second.handle;
+    return 0;
+}
+
+std::string asset_registry_t::get_file_key(const std::filesystem::path& path) {
+    // archives store the same hash
+    if (auto entry = vfs_t::get().find_archived(path))
+        return fmt::format("{:016x}-{}", entry->hash, entry->size);
+
+    std::error_code err{};
+    auto canonical_path = std::filesystem::canonical(path, err);
+    if (err) return path.string();
+    auto write_time = std::filesystem::last_write_time(canonical_path, err);
+    auto size = err ? 0 : std::filesystem::file_size(canonical_path, err);
+    if (err) return canonical_path.string();
+
+    {
+        std::lock_guard lock{_file_hashes_mutex};
+        if (auto it = _file_hashes.find(canonical_path); it != _file_hashes.end()
+            && it->second.write_time == write_time && it->second.size == size) {
+            return fmt::format("{:016x}-{}", it->second.hash, size);
+        }
+    }
+
+    // hashed without holding the lock, a file hashed by two threads at once gets the same hash
+    std::ifstream file{canonical_path, std::ios::binary};
+    if (!file) return canonical_path.string();
+    std::array<char, 64 * 1024> chunk{};
+    uint64_t hash = fnv1a_offset_basis;
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0) {
+        hash = hash_bytes(chunk.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    {
+        std::lock_guard lock{_file_hashes_mutex};
+        _file_hashes.insert_or_assign(canonical_path, file_hash_t{write_time, size, hash});
+    }
+    return fmt::format("{:016x}-{}", hash, size);
+}
+
+std::string asset_registry_t::make_texture2D_key(const std::filesystem::path& path,
+                                                 GLint upscaling_algo, GLint downscaling_algo,
+                                                 bool compressed) {
+    return fmt::format("{}:{}:{}:{}", get_file_key(path), upscaling_algo, downscaling_algo,
+                       compressed);
+}
+
+std::string asset_registry_t::make_cubemap_key(
+  const std::unordered_map<cubemap_texture_t::face_enum_t, std::string>& paths,
+  GLint upscaling_algo, GLint downscaling_algo, bool compressed) {
+    using face = cubemap_texture_t::face_enum_t;
+    constexpr std::array faces{face::front, face::back, face::bottom,
+                               face::top,   face::left, face::right};
+    std::string key{};
+    for (auto face_ix : faces) {
+        auto it = paths.find(face_ix);
+        key += (it != paths.end() ? get_file_key(it->second) : std::string{"-"}) + ":";
+    }
+    return fmt::format("{}{}:{}:{}", key, upscaling_algo, downscaling_algo, compressed);
+}
+
+std::shared_ptr<texture2D_t> asset_registry_t::get_texture2D(const std::filesystem::path& path,
+                                                             GLint upscaling_algo,
+                                                             GLint downscaling_algo,
+                                                             bool compressed) {
+    return get_or_create<texture2D_t>(
+      make_texture2D_key(path, upscaling_algo, downscaling_algo, compressed), [&]() {
+          return std::make_shared<texture2D_t>(path.string(), upscaling_algo, downscaling_algo,
+                                               compressed);
+      });
+}
+
+task_t<std::shared_ptr<texture2D_t>>
+  asset_registry_t::load_texture2D(std::filesystem::path path, GLint upscaling_algo,
+                                   GLint downscaling_algo, bool compressed) {
+    // only hashes the file, which is thread safe
+    co_await on_worker();
+    auto key = make_texture2D_key(path, upscaling_algo, downscaling_algo, compressed);
+    co_await on_gl_thread();
+    if (auto texture = find<texture2D_t>(key)) co_return texture;
+
+    auto texture = co_await texture2D_t::load_async(std::move(path), upscaling_algo,
+                                                    downscaling_algo, compressed);
+    // another load of the same texture may have finished first
+    co_return get_or_create<texture2D_t>(key, [&texture]() { return texture; });
+}
+
+std::shared_ptr<cubemap_texture_t> asset_registry_t::get_cubemap(
+  const std::unordered_map<cubemap_texture_t::face_enum_t, std::string>& paths,
+  GLint upscaling_algo, GLint downscaling_algo, bool compressed) {
+    return get_or_create<cubemap_texture_t>(
+      make_cubemap_key(paths, upscaling_algo, downscaling_algo, compressed), [&]() {
+          return std::make_shared<cubemap_texture_t>(paths, upscaling_algo, downscaling_algo,
+                                                     compressed);
+      });
+}
+
+task_t<std::shared_ptr<cubemap_texture_t>> asset_registry_t::load_cubemap(
+  std::unordered_map<cubemap_texture_t::face_enum_t, std::string> paths, GLint upscaling_algo,
+  GLint downscaling_algo, bool compressed) {
+    co_await on_worker();
+    auto key = make_cubemap_key(paths, upscaling_algo, downscaling_algo, compressed);
+    co_await on_gl_thread();
+    if (auto texture = find<cubemap_texture_t>(key)) co_return texture;
+
+    auto texture = co_await cubemap_texture_t::load_async(std::move(paths), upscaling_algo,
+                                                          downscaling_algo, compressed);
+    co_return get_or_create<cubemap_texture_t>(key, [&texture]() { return texture; });
+}
+
+void asset_registry_t::deduplicate(std::shared_ptr<texture2D_t>& texture) {
+    if (!texture || texture->get_path().empty()) return;
+    auto key = make_texture2D_key(texture->get_path(), texture->get_upscaling_mode(),
+                                  texture->get_downscaling_mode(), texture->is_compressed());
+    if (auto existing = find<texture2D_t>(key)) {
+        texture = std::move(existing);
+    } else {
+        insert(typeid(texture2D_t), key, texture);
+    }
+}
+
+void asset_registry_t::deduplicate(std::shared_ptr<cubemap_texture_t>& texture) {
+    if (!texture || texture->get_paths().empty()) return;
+    auto key = make_cubemap_key(texture->get_paths(), texture->get_upscaling_mode(),
+                                texture->get_downscaling_mode(), texture->is_compressed());
+    if (auto existing = find<cubemap_texture_t>(key)) {
+        texture = std::move(existing);
+    } else {
+        insert(typeid(cubemap_texture_t), key, texture);
+    }
+}
+
+size_t asset_registry_t::reload_file(const std::filesystem::path& path) {
+    std::error_code err{};
+    const auto changed = std::filesystem::weakly_canonical(path, err);
+    if (err) return 0;
+    const auto is_changed = [&changed](const std::filesystem::path& asset_path) {
+        std::error_code asset_err{};
+        return std::filesystem::weakly_canonical(asset_path, asset_err) == changed;
+    };
+
+    // taken out first, they're registered again under their new keys
+    std::vector<std::shared_ptr<texture2D_t>> textures{};
+    std::vector<std::shared_ptr<cubemap_texture_t>> cubemaps{};
+    std::erase_if(_assets, [&](const auto& item) {
+        const auto& [type, key] = item.first;
+        if (type == typeid(texture2D_t)) {
+            auto texture = std::static_pointer_cast<texture2D_t>(item.second.lock());
+            if (!texture || !is_changed(texture->get_path())) return false;
+            textures.push_back(std::move(texture));
+            return true;
+        }
+        if (type == typeid(cubemap_texture_t)) {
+            auto cubemap = std::static_pointer_cast<cubemap_texture_t>(item.second.lock());
+            if (!cubemap || std::ranges::none_of(cubemap->get_paths(), [&](const auto& face) {
+                    return is_changed(face.second);
+                }))
+                return false;
+            cubemaps.push_back(std::move(cubemap));
+            return true;
+        }
+        return false;
+    });
+
+    size_t reloaded = 0;
+    for (auto& texture : textures) {
+        try {
+            if (texture->reload()) reloaded++;
+        } catch (const image_loading_error& e) {
+            spdlog::error("Failed to reload {}: {}", texture->get_path().string(), e.what());
+        }
+        insert(typeid(texture2D_t),
+               make_texture2D_key(texture->get_path(), texture->get_upscaling_mode(),
+                                  texture->get_downscaling_mode(), texture->is_compressed()),
+               texture);
+    }
+    for (auto& cubemap : cubemaps) {
+        try {
+            if (cubemap->reload()) reloaded++;
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to reload cubemap with face {}: {}", changed.string(),
+                          e.what());
+        }
+        insert(typeid(cubemap_texture_t),
+               make_cubemap_key(cubemap->get_paths(), cubemap->get_upscaling_mode(),
+                                cubemap->get_downscaling_mode(), cubemap->is_compressed()),
+               cubemap);
+    }
+    return reloaded;
+}
+
+} // namespace pgre
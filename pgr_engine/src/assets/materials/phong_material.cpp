@@ -1,126 +1,274 @@
 #include <assets/materials/phong_material.h>
+#include <assets/textures/mip_streamer.h>
 #include <scene/scene.h>
 #include <math.h>
+#include <limits>
 #include <components/transform_component.h>
 
 namespace pgre {
 namespace {
-    auto phong_shader_init() {
-        constexpr const unsigned char texture_data[]{0xFF, 0xFF, 0xFF};
-        auto color_texture = std::make_shared<pgre::texture2D_t>(texture_data, 1, 1, false);
-        auto retval = std::make_unique<shader_program_t>("resources/shaders/phong.glsl");
-        retval->bind();
-        color_texture->bind(0);
-        retval->set_uniform("color_tex_sampler", 0);
-        return retval;
+    constexpr auto color_texture_unit = 1;
+
+    void set_light_uniforms(shader_program_t& program, const scene::scene_lights_t& lights) {
+        constexpr auto max_sun_lights = 2;
+        constexpr auto max_spot_lights = 50;
+        constexpr auto max_point_lights = 50;
+
+        program.set_uniform(
+          "num_sun_lights", std::min(static_cast<int>(lights.sun_lights.size()), max_sun_lights));
+        program.set_uniform(
+          "num_point_lights", std::min(static_cast<int>(lights.point_lights.size()), max_point_lights));
+        program.set_uniform(
+          "num_spot_lights", std::min(static_cast<int>(lights.spot_lights.size()), max_spot_lights));
+
+        for (auto i = 0; i < std::min(static_cast<int>(lights.sun_lights.size()), max_sun_lights);
+             i++) {
+            program.set_uniform(fmt::format("sun_lights[{}].ambient", i),
+                                         lights.sun_lights[i]->ambient);
+            program.set_uniform(fmt::format("sun_lights[{}].diffuse", i),
+                                         lights.sun_lights[i]->diffuse);
+            program.set_uniform(fmt::format("sun_lights[{}].specular", i),
+                                         lights.sun_lights[i]->specular);
+            program.set_uniform(fmt::format("sun_lights[{}].direction", i),
+                                         lights.sun_lights[i]->direction);
+        }
+        for (auto i = 0; i < std::min(static_cast<int>(lights.point_lights.size()), max_point_lights);
+             i++) {
+            program.set_uniform(fmt::format("point_lights[{}].ambient", i),
+                                         lights.point_lights[i].first->ambient);
+            program.set_uniform(fmt::format("point_lights[{}].diffuse", i),
+                                         lights.point_lights[i].first->diffuse);
+            program.set_uniform(fmt::format("point_lights[{}].specular", i),
+                                         lights.point_lights[i].first->specular);
+            program.set_uniform(fmt::format("point_lights[{}].attenuation", i),
+                                         lights.point_lights[i].first->attenuation);
+            program.set_uniform(
+              fmt::format("point_lights[{}]", i) + ".position",
+              glm::column(lights.point_lights[i].second->get_transform(), 3).xyz());
+        }
+        for (auto i = 0; i < std::min(static_cast<int>(lights.spot_lights.size()), max_spot_lights);
+             i++) {
+            const auto& light_transform_m = lights.spot_lights[i].second->get_transform();
+            program.set_uniform(fmt::format("spot_lights[{}].ambient", i),
+                                         lights.spot_lights[i].first->ambient);
+            program.set_uniform(fmt::format("spot_lights[{}].diffuse", i),
+                                         lights.spot_lights[i].first->diffuse);
+            program.set_uniform(fmt::format("spot_lights[{}].specular", i),
+                                         lights.spot_lights[i].first->specular);
+            program.set_uniform(fmt::format("spot_lights[{}].cos_half_angle", i),
+                                         lights.spot_lights[i].first->cone_half_angle_cos);
+            program.set_uniform(fmt::format("spot_lights[{}].exponent", i),
+                                         lights.spot_lights[i].first->exponent);
+            program.set_uniform(fmt::format("spot_lights[{}].direction", i),
+                                         glm::normalize(glm::vec3(light_transform_m * glm::vec4(0.0, 0.0, 1.0, 0.0))));
+            program.set_uniform(fmt::format("spot_lights[{}].position", i),
+                                         glm::column(light_transform_m, 3).xyz());
+            program.set_uniform(fmt::format("spot_lights[{}].attenuation", i),
+                                         lights.spot_lights[i].first->attenuation);
+        }
+    }
+
+    void set_compact_normal_scale(shader_program_t& program,
+                                  const primitives::vertex_array_t& vao) {
+        // the position transform scales positions from the unit cube to the bounding box
+        const auto& position_transform = vao.get_position_transform();
+        program.set_uniform("compact_normal_scale",
+                            position_transform ? glm::vec3{(*position_transform)[0][0],
+                                                           (*position_transform)[1][1],
+                                                           (*position_transform)[2][2]}
+                                               : glm::vec3{0.0f});
     }
 } // namespace
 
 void phong_material_t::init() { 
-    _shader_program = phong_shader_init();
+    _shader_program = std::make_unique<shader_program_t>("resources/shaders/phong.glsl");
+    _variants.fill(nullptr);
 }
 
-void phong_material_t::use(scene::scene_t& /*scene*/) {
+shader_program_t& phong_material_t::get_variant(uint8_t flags) {
     debug_assert(_shader_program != nullptr, "phong_material_t::init never called");
+    auto*& variant = _variants[flags];
+    if (variant == nullptr) {
+        shader_defines_t defines{};
+        if ((flags & use_texture_flag) != 0) defines.emplace("USE_TEXTURE");
+        if ((flags & spritesheet_flag) != 0) defines.emplace("SPRITESHEET");
+        if ((flags & fog_flag) != 0) defines.emplace("FOG");
+        if ((flags & reverse_perspective_flag) != 0) defines.emplace("REVERSE_PERSPECTIVE");
+        if ((flags & texture_array_flag) != 0) defines.emplace("TEXTURE_ARRAY");
+        if ((flags & instanced_flag) != 0) defines.emplace("INSTANCED");
+        variant = &_shader_program->get_variant(defines);
+        if ((flags & instanced_flag) != 0) {
+            variant->set_uniform_block_binding("InstanceBlock", instance_block_binding);
+            variant->set_uniform_block_binding("InstanceMaterialBlock",
+                                               instance_material_block_binding);
+        } else {
+            variant->set_uniform_block_binding("MaterialBlock", material_block_binding);
+        }
+        if ((flags & use_texture_flag) != 0) {
+            variant->bind();
+            variant->set_uniform("color_tex_sampler", color_texture_unit);
+        }
+    }
+    return *variant;
+}
 
-    _shader_program->bind();
-
-    _shader_program->set_uniform("material.ambient", _ambient);
-    _shader_program->set_uniform("material.diffuse", _diffuse);
-    _shader_program->set_uniform("material.specular", _specular);
-    _shader_program->set_uniform("material.shininess", _shininess);
-    _shader_program->set_uniform("material.opacity", 1.0f - _transparency);
-    _shader_program->set_uniform("time", glfwGetTime());
-    _shader_program->set_uniform("reverse_perspective", _reverse_perspective);
+uint8_t phong_material_t::get_variant_flags() const {
+    uint8_t flags = 0;
+    if (_color_texture) {
+        flags |= use_texture_flag;
+        if (spritesheet) flags |= spritesheet_flag;
+        if (_texture_layer) flags |= texture_array_flag;
+    }
+    if (_fog_settings._enable) flags |= fog_flag;
+    if (_reverse_perspective) flags |= reverse_perspective_flag;
+    return flags;
+}
 
+phong_material_t::material_block_t phong_material_t::make_material_block() const {
+    material_block_t block{};
+    block.ambient = _ambient;
+    block.diffuse = _diffuse;
+    block.specular = _specular;
+    block.shininess = _shininess;
+    block.opacity = 1.0f - _transparency;
     if (_color_texture) {
-        _shader_program->set_uniform("material.spritesheet", spritesheet);
         if (spritesheet) {
-            _shader_program->set_uniform("material.spritesheet_dims", spritesheet_dims);
-            _shader_program->set_uniform("material.spritesheet_frame_duration", 1.0f/static_cast<float>(spritesheet_fps));
-            _shader_program->set_uniform("material.tex_coord_anim_speed", 0.0f);
+            block.spritesheet_dims = spritesheet_dims;
+            block.spritesheet_frame_duration = 1.0f / static_cast<float>(spritesheet_fps);
         } else {
-            _shader_program->set_uniform("material.tex_coord_anim_speed", _animate_texture_coords ? texcoord_anim_speed : 0.0f);
+            block.tex_coord_anim_speed = _animate_texture_coords ? texcoord_anim_speed : 0.0f;
         }
-        _shader_program->set_uniform("color_tex_sampler", 1);
-        
-        _shader_program->set_uniform("material.use_texture", true);
-        _color_texture->bind(1);
-    } else {
-        _shader_program->set_uniform("material.use_texture", false);
+        if (_texture_layer) block.texture_layer = static_cast<float>(_texture_layer->get_layer());
     }
+    return block;
 }
 
+void phong_material_t::update_uniform_buffer() {
+    // material parameters are public and edited in place, so changes are detected by comparing
+    // against the last uploaded block, which is a lot cheaper than reuploading every time.
+    auto block = make_material_block();
+    if (!_uniform_buffer) {
+        _uniform_buffer = std::make_unique<primitives::uniform_buffer_t>();
+    } else if (block == _uploaded_block) {
+        return;
+    }
+    _uniform_buffer->set_data(sizeof(material_block_t), &block, GL_DYNAMIC_DRAW);
+    _uploaded_block = block;
+}
 
-void phong_material_t::set_matrices(const glm::mat4& M, const glm::mat4& V, const glm::mat4& P, const glm::mat4& PV) {
-    _shader_program->bind();
-    _shader_program->set_uniform("v_normal_matrix",glm::transpose(glm::inverse(V * M)));
-    _shader_program->set_uniform("view_matrix", V);
-    _shader_program->set_uniform("vm_matrix", V * M);
-    _shader_program->set_uniform("pvm_matrix", PV * M);
+void phong_material_t::update_texture_layer() {
+    // streamed textures are copied into the array once resident, until then the placeholder is used
+    if (!_use_texture_arrays || !_color_texture || !_color_texture->is_resident()
+        || _color_texture->get_base_level() != 0) {
+        _texture_layer.reset();
+        return;
+    }
+    if (!_texture_layer || !_texture_layer->is_copy_of(_color_texture)) {
+        _texture_layer = texture_array_pool_t::acquire(_color_texture);
+    }
 }
 
-void phong_material_t::set_scene_uniforms_s(scene::scene_t& scene) {
-    _shader_program->bind();
-    _fog_settings.set_uniforms(*_shader_program);
-
-    constexpr auto max_sun_lights = 2;
-    constexpr auto max_spot_lights = 50;
-    constexpr auto max_point_lights = 50;
-
-    auto& lights = scene.get_lights();
-    _shader_program->set_uniform(
-      "num_sun_lights", std::min(static_cast<int>(lights.sun_lights.size()), max_sun_lights));
-    _shader_program->set_uniform(
-      "num_point_lights", std::min(static_cast<int>(lights.point_lights.size()), max_point_lights));
-    _shader_program->set_uniform(
-      "num_spot_lights", std::min(static_cast<int>(lights.spot_lights.size()), max_spot_lights));
-
-    for (auto i = 0; i < std::min(static_cast<int>(lights.sun_lights.size()), max_sun_lights);
-         i++) {
-        _shader_program->set_uniform(fmt::format("sun_lights[{}].ambient", i),
-                                     lights.sun_lights[i]->ambient);
-        _shader_program->set_uniform(fmt::format("sun_lights[{}].diffuse", i),
-                                     lights.sun_lights[i]->diffuse);
-        _shader_program->set_uniform(fmt::format("sun_lights[{}].specular", i),
-                                     lights.sun_lights[i]->specular);
-        _shader_program->set_uniform(fmt::format("sun_lights[{}].direction", i),
-                                     lights.sun_lights[i]->direction);
+void phong_material_t::request_texture_detail(float screen_size) const {
+    if (!_color_texture) return;
+    if (_use_texture_arrays) {
+        // array layers are copied from the full resolution texture
+        screen_size = std::numeric_limits<float>::infinity();
+    } else if (spritesheet) {
+        // each frame covers only part of the texture
+        screen_size *= static_cast<float>(std::max(spritesheet_dims.x, spritesheet_dims.y));
     }
-    for (auto i = 0; i < std::min(static_cast<int>(lights.point_lights.size()), max_point_lights);
-         i++) {
-        _shader_program->set_uniform(fmt::format("point_lights[{}].ambient", i),
-                                     lights.point_lights[i].first->ambient);
-        _shader_program->set_uniform(fmt::format("point_lights[{}].diffuse", i),
-                                     lights.point_lights[i].first->diffuse);
-        _shader_program->set_uniform(fmt::format("point_lights[{}].specular", i),
-                                     lights.point_lights[i].first->specular);
-        _shader_program->set_uniform(fmt::format("point_lights[{}].attenuation", i),
-                                     lights.point_lights[i].first->attenuation);
-        _shader_program->set_uniform(
-          fmt::format("point_lights[{}]", i) + ".position",
-          glm::column(lights.point_lights[i].second->get_transform(), 3).xyz());
+    mip_streamer_t::get().request(*_color_texture, screen_size);
+}
+
+void phong_material_t::use(scene::scene_t& /*scene*/) {
+    update_texture_layer();
+    auto& program = get_variant(get_variant_flags());
+    program.bind();
+
+    update_uniform_buffer();
+    _uniform_buffer->bind_base(material_block_binding);
+    bind_color_texture();
+}
+
+void phong_material_t::bind_color_texture() const {
+    if (_texture_layer) {
+        _texture_layer->get_array().bind(color_texture_unit);
+    } else if (_color_texture) {
+        _color_texture->bind(color_texture_unit);
     }
-    for (auto i = 0; i < std::min(static_cast<int>(lights.spot_lights.size()), max_spot_lights);
-         i++) {
-        const auto& light_transform_m = lights.spot_lights[i].second->get_transform();
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].ambient", i),
-                                     lights.spot_lights[i].first->ambient);
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].diffuse", i),
-                                     lights.spot_lights[i].first->diffuse);
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].specular", i),
-                                     lights.spot_lights[i].first->specular);
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].cos_half_angle", i),
-                                     lights.spot_lights[i].first->cone_half_angle_cos);
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].exponent", i),
-                                     lights.spot_lights[i].first->exponent);
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].direction", i),
-                                     glm::normalize(glm::vec3(light_transform_m * glm::vec4(0.0, 0.0, 1.0, 0.0))));
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].position", i),
-                                     glm::column(light_transform_m, 3).xyz());
-        _shader_program->set_uniform(fmt::format("spot_lights[{}].attenuation", i),
-                                     lights.spot_lights[i].first->attenuation);
+}
+
+std::optional<uint64_t> phong_material_t::get_instancing_key() {
+    if (!_use_texture_arrays) return std::nullopt;
+    update_texture_layer();
+    if (_color_texture && !_texture_layer) return std::nullopt;
+    const uint64_t texture_gl_id = _texture_layer ? _texture_layer->get_array().get_gl_id() : 0;
+    return texture_gl_id << 8U | get_variant_flags();
+}
+
+void phong_material_t::draw_instanced(const primitives::vertex_array_t& vao, GLenum primitive,
+                                      std::span<const instance_t> instances, const glm::mat4& V,
+                                      const glm::mat4& PV) const {
+    auto& program = get_variant(get_variant_flags() | instanced_flag);
+    program.bind();
+    program.set_uniform("view_matrix", V);
+    set_compact_normal_scale(program, vao);
+    bind_color_texture();
+    if (!_instance_buffer) {
+        _instance_buffer = std::make_unique<primitives::uniform_buffer_t>();
+        _instance_material_buffer = std::make_unique<primitives::uniform_buffer_t>();
     }
+
+    // the buffers always hold whole blocks, a bound buffer smaller than the block is undefined
+    std::array<instance_matrices_t, max_instance_count> matrices{};
+    std::array<material_block_t, max_instance_count> blocks{};
+    vao.bind();
+    for (size_t first = 0; first < instances.size(); first += max_instance_count) {
+        const auto batch = instances.subspan(
+          first, std::min<size_t>(max_instance_count, instances.size() - first));
+        for (size_t i = 0; i < batch.size(); i++) {
+            const auto vm_matrix = V * batch[i].model_matrix;
+            matrices[i] = {PV * batch[i].model_matrix, vm_matrix,
+                           glm::transpose(glm::inverse(vm_matrix))};
+            blocks[i] = batch[i].material->make_material_block();
+        }
+        _instance_buffer->set_data(sizeof(matrices), matrices.data(), GL_STREAM_DRAW);
+        _instance_material_buffer->set_data(sizeof(blocks), blocks.data(), GL_STREAM_DRAW);
+        _instance_buffer->bind_base(instance_block_binding);
+        _instance_material_buffer->bind_base(instance_material_block_binding);
+        glDrawElementsInstanced(primitive, vao.get_index_count(), vao.get_index_type(), nullptr,
+                                static_cast<GLsizei>(batch.size()));
+    }
+}
+
+void phong_material_t::set_vertex_format(const primitives::vertex_array_t& vao) const {
+    auto& program = get_variant(get_variant_flags());
+    debug_assert(program.is_bound(),
+                 "phong_material_t::use must be called before set_vertex_format");
+    set_compact_normal_scale(program, vao);
+}
+
+void phong_material_t::set_matrices(const glm::mat4& M, const glm::mat4& V, const glm::mat4& P, const glm::mat4& PV) {
+    auto& program = get_variant(get_variant_flags());
+    debug_assert(program.is_bound(), "phong_material_t::use must be called before set_matrices");
+    program.set_uniform("v_normal_matrix",glm::transpose(glm::inverse(V * M)));
+    program.set_uniform("view_matrix", V);
+    program.set_uniform("vm_matrix", V * M);
+    program.set_uniform("pvm_matrix", PV * M);
+}
+
+void phong_material_t::set_scene_uniforms_s(scene::scene_t& scene) {
+    debug_assert(_shader_program != nullptr, "phong_material_t::init never called");
+    _fog_settings.update_clear_color();
+
+    const auto& lights = scene.get_lights();
+    const auto time = glfwGetTime();
+    _shader_program->for_each_variant([&lights, time](shader_program_t& program) {
+        program.bind();
+        if (program.get_defines().contains("FOG")) _fog_settings.set_uniforms(program);
+        if (program.get_defines().contains("USE_TEXTURE")) program.set_uniform("time", time);
+        set_light_uniforms(program, lights);
+    });
 }
 
 } // namespace pgre
@@ -1,84 +1,176 @@
 #include "error_handling.h"
 #include <assets/textures/cubemap.h>
+#include <assets/textures/texture_cooker.h>
+#include <assets/textures/texture_streamer.h>
 
 #include <fmt/format.h>
-#include <stb_image.h>
 
 namespace pgre {
 
-cubemap_texture_t::~cubemap_texture_t() { glDeleteTextures(1, &_gl_id); }
-
-void cubemap_texture_t::load_from_file() {
-    static auto set_once_hack = []() {
-        stbi_set_flip_vertically_on_load(1);
-        return true;
-    }();
-
-    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &_gl_id);
-    int width{}, height{};
-    int channels{};
-
-    std::unordered_map<face_enum_t, unsigned char*> tex_data;
-    static const std::map<face_enum_t, uint8_t> face_to_ogl_offset{
-      {face_enum_t::front, 5},
-      {face_enum_t::back, 4},
-      {face_enum_t::right, 0},
-      {face_enum_t::left, 1},
-      {face_enum_t::top, 3},
-      {face_enum_t::bottom, 2},
-      // 3-> back 2-> front //  
+namespace {
+    const std::map<cubemap_texture_t::face_enum_t, uint8_t> face_to_ogl_offset{
+      {cubemap_texture_t::face_enum_t::front, 5},
+      {cubemap_texture_t::face_enum_t::back, 4},
+      {cubemap_texture_t::face_enum_t::right, 0},
+      {cubemap_texture_t::face_enum_t::left, 1},
+      {cubemap_texture_t::face_enum_t::top, 3},
+      {cubemap_texture_t::face_enum_t::bottom, 2},
+      // 3-> back 2-> front //
     };
+} // namespace
 
-    bool first = true;
-    for (auto& [face, path]: _paths){
-        auto old_w = width, old_h = height, old_channels = channels;
+cubemap_texture_t::~cubemap_texture_t() {
+    if (_stream_request) _stream_request->cancel();
+    glDeleteTextures(1, &_gl_id);
+}
 
-        tex_data[face] = stbi_load(path.c_str(), &width, &height, &channels, 0);
+void cubemap_texture_t::apply_sampling_parameters() const {
+    glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, _downscaling_algo);
+    glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, _upscaling_algo);
+    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_R, GL_MIRROR_CLAMP_TO_EDGE);
+}
 
-        if (!tex_data[face])
-            throw image_loading_error(fmt::format("Failed to load image at path {}", path));
-        if (!first && (old_w != width || old_h != height || old_channels != channels)) {
-            throw image_loading_error(
-              fmt::format("Dimensions of diff cubemap faces differ for {}.", path));
-        }
-        bool first = false;
+std::vector<std::filesystem::path>
+  cubemap_texture_t::get_face_sources(const std::unordered_map<face_enum_t, std::string>& paths) {
+    std::vector<std::filesystem::path> face_sources(face_to_ogl_offset.size());
+    for (const auto& [face, path] : paths) {
+        face_sources.at(face_to_ogl_offset.at(face)) = path;
     }
-    
+    return face_sources;
+}
+
+void cubemap_texture_t::request_streaming() {
+    auto face_sources = get_face_sources(_paths);
+
+    int width{}, height{}, channels{};
+    if (!get_image_info(face_sources.front(), &width, &height, &channels))
+        throw image_loading_error(
+          fmt::format("Failed to load image at path {}", face_sources.front().string()));
     _width = width;
     _height = height;
-    debug_assert(channels >= 3, "Trying to load texture with unsupported number of channels");
     _has_alpha = channels == 4;
 
-    glTextureStorage2D(_gl_id, 1, _has_alpha ? GL_RGBA8 : GL_RGB8, width, height);
+    _stream_request = texture_streamer_t::get().request(
+      GL_TEXTURE_CUBE_MAP, std::move(face_sources), _compressed,
+      [this](const texture_stream_result_t& result) {
+          // replaces the current contents on reload
+          glDeleteTextures(1, &_gl_id);
+          _gl_id = result.gl_id;
+          _width = result.width;
+          _height = result.height;
+          _has_alpha = result.has_alpha;
+          apply_sampling_parameters();
+          _stream_request.reset();
+      });
+}
 
-    glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, _downscaling_algo);
-    glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, _upscaling_algo);
-    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureParameteri(_gl_id, GL_TEXTURE_WRAP_R, GL_MIRROR_CLAMP_TO_EDGE);
+void cubemap_texture_t::upload(const cooked_texture_t& cooked) {
+    debug_assert(cooked.faces.size() == face_to_ogl_offset.size(),
+                 "Cubemap must have exactly six faces.");
+    _width = cooked.width;
+    _height = cooked.height;
+    _has_alpha = cooked.has_alpha;
+
+    const auto level_count = cooked.get_level_count();
+    const auto base_size = cooked.get_level_size(cooked.base_level);
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &_gl_id);
+    glTextureStorage2D(_gl_id, static_cast<GLsizei>(level_count), cooked.internal_format,
+                       static_cast<GLsizei>(base_size.x), static_cast<GLsizei>(base_size.y));
+    apply_sampling_parameters();
+
+    std::vector<uint8_t> layers{};
+    for (uint32_t level = 0; level < level_count; level++) {
+        const auto size = cooked.get_level_size(cooked.base_level + level);
+        const auto width = static_cast<GLsizei>(size.x);
+        const auto height = static_cast<GLsizei>(size.y);
+        if (!_compressed) {
+            // decoded faces are large, uploaded one by one rather than copied together
+            for (size_t face = 0; face < cooked.faces.size(); face++) {
+                glTextureSubImage3D(_gl_id, static_cast<GLint>(level), 0, 0,
+                                    static_cast<GLint>(face), width, height, 1, GL_RGBA,
+                                    GL_UNSIGNED_BYTE, cooked.faces[face][level].data());
+            }
+            continue;
+        }
+        // all six faces of a level as the layers of one image
+        layers.clear();
+        for (const auto& levels : cooked.faces) {
+            layers.insert(layers.end(), levels[level].begin(), levels[level].end());
+        }
+        glCompressedTextureSubImage3D(_gl_id, static_cast<GLint>(level), 0, 0, 0, width, height,
+                                      static_cast<GLsizei>(cooked.faces.size()),
+                                      cooked.internal_format, static_cast<GLsizei>(layers.size()),
+                                      layers.data());
+    }
+}
 
-    for (auto& [face,data]: tex_data){
-        glTextureSubImage3D(_gl_id, 0, 0, 0, face_to_ogl_offset.at(face), width, height, 1,
-                            _has_alpha ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
-        
+void cubemap_texture_t::load_from_file() {
+    if (texture_streamer_t::is_enabled()) {
+        request_streaming();
+        return;
     }
+    const auto face_sources = get_face_sources(_paths);
+    upload(_compressed ? texture_cooker_t::load_or_cook(face_sources)
+                       : texture_cooker_t::decode(face_sources));
 }
 
 cubemap_texture_t::cubemap_texture_t(std::unordered_map<face_enum_t, std::string> paths,
-                                     GLint upscaling_algo, GLint downscaling_algo)
-  : _paths(std::move(paths)),
+                                     GLint upscaling_algo, GLint downscaling_algo,
+                                     bool compressed)
+  : _compressed(compressed),
+    _paths(std::move(paths)),
     _upscaling_algo(upscaling_algo),
     _downscaling_algo(downscaling_algo) {
         this->load_from_file();
 }
 
+task_t<std::shared_ptr<cubemap_texture_t>>
+  cubemap_texture_t::load_async(std::unordered_map<face_enum_t, std::string> paths,
+                                GLint upscaling_algo, GLint downscaling_algo, bool compressed) {
+    // decoding and cooking wait for work on the global pool
+    co_await on_worker(texture_streamer_t::get().get_decode_pool());
+    const auto face_sources = get_face_sources(paths);
+    auto faces = compressed ? texture_cooker_t::load_or_cook(face_sources)
+                            : texture_cooker_t::decode(face_sources);
+    co_await on_gl_thread();
+    auto texture = std::make_shared<cubemap_texture_t>();
+    texture->_compressed = compressed;
+    texture->_paths = std::move(paths);
+    texture->_upscaling_algo = upscaling_algo;
+    texture->_downscaling_algo = downscaling_algo;
+    texture->upload(faces);
+    co_return texture;
+}
+
+bool cubemap_texture_t::reload() {
+    if (_paths.empty() || _stream_request) return false;
+    if (texture_streamer_t::is_enabled()) {
+        request_streaming();
+        return true;
+    }
+    const auto old_gl_id = _gl_id;
+    try {
+        load_from_file();
+    } catch (const std::exception&) {
+        // cooking throws std::runtime_error, not only image_loading_error
+        if (_gl_id != old_gl_id) glDeleteTextures(1, &_gl_id);
+        _gl_id = old_gl_id;
+        throw;
+    }
+    glDeleteTextures(1, &old_gl_id);
+    return true;
+}
+
 void cubemap_texture_t::set_upscaling_mode(GLint upscaling_algo) {
-    glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, upscaling_algo);
+    _upscaling_algo = upscaling_algo;
+    if (is_resident()) apply_sampling_parameters();
 }
 
 void cubemap_texture_t::set_downscaling_mode(GLint downscaling_algo) {
-    glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, downscaling_algo);
+    _downscaling_algo = downscaling_algo;
+    if (is_resident()) apply_sampling_parameters();
 }
 
 } // namespace pgre
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <assets/textures/mip_streamer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace pgre {
+
+mip_streamer_t& mip_streamer_t::get() {
+    static mip_streamer_t streamer{};
+    return streamer;
+}
+
+uint32_t mip_streamer_t::get_coarsest_base_level(uint32_t width, uint32_t height) {
+    const auto level_count = texture_cooker_t::get_full_level_count(width, height);
+    uint32_t level = 0;
+    while (level + 1 < level_count && (std::max(width, height) >> level) > min_resident_size) {
+        level++;
+    }
+    return level;
+}
+
+size_t mip_streamer_t::get_byte_size(const texture2D_t& texture, uint32_t base_level) {
+    const auto width = texture.get_width();
+    const auto height = texture.get_height();
+    const auto level_count = texture_cooker_t::get_full_level_count(width, height);
+    size_t size = 0;
+    for (auto level = base_level; level < level_count; level++) {
+        size += texture_cooker_t::get_compressed_size(
+          {std::max(1U, width >> level), std::max(1U, height >> level)},
+          texture.get_internal_format());
+    }
+    return size;
+}
+
+uint32_t mip_streamer_t::get_wanted_base_level(const texture2D_t& texture, float screen_size) {
+    if (!std::isfinite(screen_size)) return 0;
+    // one texel per pixel, assuming the texture is mapped across the whole object once
+    const auto texel_count
+      = static_cast<float>(std::max(texture.get_width(), texture.get_height()));
+    const auto level = std::floor(std::log2(texel_count / std::max(screen_size, 1.0f)));
+    return std::min(static_cast<uint32_t>(std::max(level, 0.0f)),
+                    get_coarsest_base_level(texture.get_width(), texture.get_height()));
+}
+
+void mip_streamer_t::request(texture2D_t& texture, float screen_size) {
+    if (!texture.is_mip_streamable()) return;
+    if (!_enabled) {
+        if (texture.is_resident() && texture.get_target_base_level() != 0)
+            texture.request_base_level(0);
+        return;
+    }
+    const auto level = get_wanted_base_level(texture, screen_size);
+    auto [it, inserted] = _textures.try_emplace(&texture, entry_t{level, _frame});
+    if (inserted) return;
+
+    auto& entry = it->second;
+    entry.wanted_base_level
+      = entry.last_used_frame == _frame ? std::min(entry.wanted_base_level, level) : level;
+    entry.last_used_frame = _frame;
+}
+
+void mip_streamer_t::remove(texture2D_t& texture) { _textures.erase(&texture); }
+
+bool mip_streamer_t::evict(size_t extra_bytes,
+                           const std::vector<std::pair<texture2D_t*, entry_t*>>& lru) {
+    for (const auto& [texture, entry] : lru) {
+        if (_resident_bytes + extra_bytes <= _budget) return true;
+        if (!texture->is_resident()) continue;
+
+        const auto target = texture->get_target_base_level();
+        const auto evict_to
+          = entry->last_used_frame == _frame
+              ? entry->wanted_base_level
+              : get_coarsest_base_level(texture->get_width(), texture->get_height());
+        if (target >= evict_to || !texture->request_base_level(evict_to)) continue;
+        _resident_bytes -= get_byte_size(*texture, target) - get_byte_size(*texture, evict_to);
+    }
+    return _resident_bytes + extra_bytes <= _budget;
+}
+
+void mip_streamer_t::update() {
+    if (!_enabled) {
+        // restore full detail, textures are dropped once their reload is queued
+        std::erase_if(_textures,
+                      [](const auto& item) { return item.first->request_base_level(0); });
+        _resident_bytes = 0;
+        return;
+    }
+
+    _resident_bytes = 0;
+    std::vector<std::pair<texture2D_t*, entry_t*>> lru{};
+    std::vector<texture2D_t*> loads{};
+    lru.reserve(_textures.size());
+    for (auto& [texture, entry] : _textures) {
+        _resident_bytes += get_byte_size(*texture, texture->get_target_base_level());
+        lru.emplace_back(texture, &entry);
+        if (entry.last_used_frame == _frame && texture->is_resident()
+            && entry.wanted_base_level < texture->get_target_base_level())
+            loads.push_back(texture);
+    }
+    std::ranges::sort(lru, std::less<>{},
+                      [](const auto& item) { return item.second->last_used_frame; });
+    // the budget may have been lowered
+    evict(0, lru);
+
+    // textures furthest from the detail they need first
+    std::ranges::sort(loads, std::greater<>{}, [this](texture2D_t* texture) {
+        return texture->get_target_base_level() - _textures.at(texture).wanted_base_level;
+    });
+    for (auto* texture : loads) {
+        const auto target = texture->get_target_base_level();
+        const auto target_size = get_byte_size(*texture, target);
+        // load the finest wanted level that fits the budget
+        for (auto level = _textures.at(texture).wanted_base_level; level < target; level++) {
+            const auto extra_bytes = get_byte_size(*texture, level) - target_size;
+            if (!evict(extra_bytes, lru)) continue;
+            if (texture->request_base_level(level)) _resident_bytes += extra_bytes;
+            break;
+        }
+    }
+    _frame++;
+}
+
+} // namespace pgre
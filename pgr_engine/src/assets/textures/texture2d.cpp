@@ -1,5 +1,8 @@
 #include "error_handling.h"
+#include <assets/textures/mip_streamer.h>
 #include <assets/textures/texture2d.h>
+#include <assets/textures/texture_streamer.h>
+#include <utility/vfs.h>
 
 #include <fmt/format.h>
 #define STB_IMAGE_IMPLEMENTATION
@@ -7,18 +10,147 @@
 
 namespace pgre {
 
-texture2D_t::~texture2D_t() { glDeleteTextures(1, &_gl_id); }
+bool get_image_info(const std::filesystem::path& path, int* width, int* height, int* channels) {
+    // prefetched contents are left to the decode
+    auto file = vfs_t::get().peek(path);
+    if (!file) return false;
+    return stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(file->get_data().data()),
+                                 static_cast<int>(file->get_size()), width, height, channels)
+           != 0;
+}
 
-void texture2D_t::load_from_file() {
-    static auto set_once_hack = []() {
-        stbi_set_flip_vertically_on_load(1);
+stbi_uc* load_image(const std::filesystem::path& path, int* width, int* height, int* channels,
+                    int desired_channels) {
+    auto file = vfs_t::get().open(path);
+    if (!file) return nullptr;
+    // images are decoded on worker threads, the global flag would race
+    stbi_set_flip_vertically_on_load_thread(1);
+    return stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file->get_data().data()),
+                                 static_cast<int>(file->get_size()), width, height, channels,
+                                 desired_channels);
+}
+
+texture2D_t::~texture2D_t() {
+    if (_stream_request) _stream_request->cancel();
+    if (is_mip_streamable()) mip_streamer_t::get().remove(*this);
+    glDeleteTextures(1, &_gl_id);
+}
+
+uint32_t texture2D_t::get_placeholder_gl_id() {
+    return texture_streamer_t::get().get_placeholder_gl_id();
+}
+
+void texture2D_t::apply_sampling_parameters() const {
+    glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER,
+                        _level_count > 1 ? get_mipmap_min_filter(_downscaling_algo)
+                                         : _downscaling_algo);
+    glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, _upscaling_algo);
+}
+
+void texture2D_t::request_streaming() {
+    int width{}, height{}, channels{};
+    if (!get_image_info(_path, &width, &height, &channels))
+        throw image_loading_error(fmt::format("Failed to load image at path {}", _path.string()));
+    _width = width;
+    _height = height;
+    _has_alpha = channels == 4;
+
+    // start with the coarse levels only, mip_streamer_t loads finer ones once they're needed
+    if (_compressed && mip_streamer_t::is_enabled())
+        _target_base_level = mip_streamer_t::get_coarsest_base_level(_width, _height);
+    _stream_request = texture_streamer_t::get().request(
+      GL_TEXTURE_2D, {_path}, _compressed,
+      [this](const texture_stream_result_t& result) { on_streamed(result); }, _target_base_level);
+}
+
+void texture2D_t::on_streamed(const texture_stream_result_t& result) {
+    // replaces the previous storage if the base level changed
+    glDeleteTextures(1, &_gl_id);
+    _gl_id = result.gl_id;
+    _width = result.width;
+    _height = result.height;
+    _has_alpha = result.has_alpha;
+    _internal_format = result.internal_format;
+    _base_level = result.base_level;
+    _target_base_level = result.base_level;
+    _level_count = result.level_count;
+    apply_sampling_parameters();
+    _stream_request.reset();
+    _revision++;
+}
+
+bool texture2D_t::request_base_level(uint32_t base_level) {
+    debug_assert(is_mip_streamable(), "Texture has no cooked mips to reload levels from.");
+    if (_stream_request) return false;
+    if (base_level == _base_level) return true;
+
+    _target_base_level = base_level;
+    if (!texture_streamer_t::is_enabled()) {
+        auto old_gl_id = _gl_id;
+        upload(texture_cooker_t::load_or_cook({_path}, base_level));
+        glDeleteTextures(1, &old_gl_id);
         return true;
-    }();
+    }
+    _stream_request = texture_streamer_t::get().request(
+      GL_TEXTURE_2D, {_path}, true,
+      [this](const texture_stream_result_t& result) { on_streamed(result); }, base_level);
+    return true;
+}
+
+bool texture2D_t::reload() {
+    if (_path.empty() || _stream_request) return false;
+    if (texture_streamer_t::is_enabled()) {
+        // on_streamed replaces the current storage
+        request_streaming();
+        return true;
+    }
+    const auto old_gl_id = _gl_id;
+    load_from_file();
+    glDeleteTextures(1, &old_gl_id);
+    _revision++;
+    return true;
+}
+
+void texture2D_t::upload(const cooked_texture_t& cooked) {
+    debug_assert(cooked.faces.size() == 1, "2D texture must have exactly one face.");
+    _width = cooked.width;
+    _height = cooked.height;
+    _has_alpha = cooked.has_alpha;
+    _internal_format = cooked.internal_format;
+    _base_level = cooked.base_level;
+    _target_base_level = cooked.base_level;
+    _level_count = cooked.get_level_count();
+
+    const auto base_size = cooked.get_level_size(_base_level);
+    glCreateTextures(GL_TEXTURE_2D, 1, &_gl_id);
+    glTextureStorage2D(_gl_id, static_cast<GLsizei>(_level_count), _internal_format,
+                       static_cast<GLsizei>(base_size.x), static_cast<GLsizei>(base_size.y));
+    apply_sampling_parameters();
+
+    for (uint32_t level = 0; level < _level_count; level++) {
+        auto size = cooked.get_level_size(_base_level + level);
+        const auto& data = cooked.faces.front()[level];
+        glCompressedTextureSubImage2D(_gl_id, static_cast<GLint>(level), 0, 0,
+                                      static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y),
+                                      _internal_format, static_cast<GLsizei>(data.size()),
+                                      data.data());
+    }
+}
+
+void texture2D_t::load_from_file() {
+    if (texture_streamer_t::is_enabled()) {
+        request_streaming();
+        return;
+    }
+    if (_compressed) {
+        upload(texture_cooker_t::load_or_cook({_path}));
+        return;
+    }
 
     int width{}, height{};
     int channels{};
 
-    unsigned char* data = stbi_load(_path.string().c_str(), &width, &height, &channels, 0);
+    unsigned char* data = load_image(_path, &width, &height, &channels, 0);
     if (!data) throw image_loading_error(fmt::format("Failed to load image at path {}", _path.string()));
     _width = width;
     _height = height;
@@ -26,10 +158,10 @@ void texture2D_t::load_from_file() {
     debug_assert(channels >= 3, "Trying to load texture with unsupported number of channels");
 
     _has_alpha = channels == 4;
+    _internal_format = _has_alpha ? GL_RGBA8 : GL_RGB8;
 
     glCreateTextures(GL_TEXTURE_2D, 1, &_gl_id);
-    glTextureStorage2D(_gl_id, 1, channels == 4 ? GL_RGBA8 : GL_RGB8, width,
-                       height); // TODO: mimmaps?
+    glTextureStorage2D(_gl_id, 1, _internal_format, width, height); // TODO: mimmaps?
 
     glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, _downscaling_algo);
     glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, _upscaling_algo);
@@ -41,27 +173,70 @@ void texture2D_t::load_from_file() {
     stbi_image_free(data);
 }
 
-texture2D_t::texture2D_t(const std::string& path, GLint upscaling_algo, GLint downscaling_algo)
-  : _path(std::filesystem::canonical(path)), _upscaling_algo(upscaling_algo), _downscaling_algo(downscaling_algo) {
+texture2D_t::texture2D_t(const std::string& path, GLint upscaling_algo, GLint downscaling_algo,
+                         bool compressed)
+  : _compressed(compressed), _path(std::filesystem::weakly_canonical(path)), _upscaling_algo(upscaling_algo), _downscaling_algo(downscaling_algo) {
     this->load_from_file();
 }
 
+task_t<std::shared_ptr<texture2D_t>> texture2D_t::load_async(std::filesystem::path path,
+                                                              GLint upscaling_algo,
+                                                              GLint downscaling_algo,
+                                                              bool compressed) {
+    // cooking waits for work on the global pool
+    co_await on_worker(texture_streamer_t::get().get_decode_pool());
+    path = std::filesystem::weakly_canonical(path);
+    std::shared_ptr<texture2D_t> texture{nullptr};
+    if (compressed) {
+        auto cooked = texture_cooker_t::load_or_cook({path});
+        co_await on_gl_thread();
+        texture = std::make_shared<texture2D_t>(cooked, upscaling_algo, downscaling_algo);
+    } else {
+        int width{}, height{}, channels{};
+        if (!get_image_info(path, &width, &height, &channels))
+            throw image_loading_error(
+              fmt::format("Failed to load image at path {}", path.string()));
+        // the data constructor takes RGB or RGBA
+        const bool alpha = channels == 2 || channels == 4;
+        std::unique_ptr<stbi_uc, void (*)(void*)> pixels{
+          load_image(path, &width, &height, &channels, alpha ? 4 : 3), &stbi_image_free};
+        if (!pixels)
+            throw image_loading_error(
+              fmt::format("Failed to load image at path {}", path.string()));
+        co_await on_gl_thread();
+        texture = std::make_shared<texture2D_t>(pixels.get(), width, height, alpha,
+                                                upscaling_algo, downscaling_algo);
+    }
+    texture->_path = std::move(path);
+    co_return texture;
+}
+
+texture2D_t::texture2D_t(const cooked_texture_t& cooked, GLint upscaling_algo,
+                         GLint downscaling_algo)
+  : _compressed(true), _upscaling_algo(upscaling_algo), _downscaling_algo(downscaling_algo) {
+    upload(cooked);
+}
+
 texture2D_t::texture2D_t(const unsigned char* data, int width, int height, bool alpha,
                          GLint upscaling_algo, GLint downscaling_algo)
   : _width(width),
     _height(height),
     _has_alpha(alpha),
+    _internal_format(alpha ? GL_RGBA8 : GL_RGB8),
     _upscaling_algo(upscaling_algo),
     _downscaling_algo(downscaling_algo) {
     glCreateTextures(GL_TEXTURE_2D, 1, &_gl_id);
-    glTextureStorage2D(_gl_id, 1, alpha ? GL_RGBA8 : GL_RGB8, width, height); // TODO: mimmaps?
+    glTextureStorage2D(_gl_id, 1, _internal_format, width, height); // TODO: mimmaps?
 
     glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, downscaling_algo);
     glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, upscaling_algo);
 
+    // rows of RGB data are tightly packed, not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTextureSubImage2D(_gl_id, /*mipmap level*/ 0,
                         /*x-offset*/ 0, /*y-offset*/ 0, width, height,
                         /*format*/ alpha ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
 texture2D_t::texture2D_t(const aiTexel* data, int width, int height, GLint upscaling_algo,
@@ -82,11 +257,13 @@ texture2D_t::texture2D_t(const aiTexel* data, int width, int height, GLint upsca
 }
 
 void texture2D_t::set_upscaling_mode(GLint upscaling_algo) {
-    glTextureParameteri(_gl_id, GL_TEXTURE_MAG_FILTER, upscaling_algo);
+    _upscaling_algo = upscaling_algo;
+    if (is_resident()) apply_sampling_parameters();
 }
 
 void texture2D_t::set_downscaling_mode(GLint downscaling_algo) {
-    glTextureParameteri(_gl_id, GL_TEXTURE_MIN_FILTER, downscaling_algo);
+    _downscaling_algo = downscaling_algo;
+    if (is_resident()) apply_sampling_parameters();
 }
 
 } // namespace pgre
@@ -0,0 +1,161 @@
+#include "error_handling.h"
+#include <assets/textures/texture2d_array.h>
+#include <assets/textures/texture_cooker.h>
+
+#include <algorithm>
+#include <array>
+
+#include <spdlog/spdlog.h>
+
+namespace pgre {
+
+texture2D_array_t::texture2D_array_t(uint32_t width, uint32_t height, GLenum internal_format,
+                                     uint32_t initial_layer_count, GLint upscaling_algo,
+                                     GLint downscaling_algo)
+  : _width(width),
+    _height(height),
+    _level_count(texture_cooker_t::get_full_level_count(width, height)),
+    _internal_format(internal_format),
+    _upscaling_algo(upscaling_algo),
+    _downscaling_algo(downscaling_algo) {
+    allocate_storage(std::clamp(initial_layer_count, 1U, get_max_layer_count()));
+}
+
+texture2D_array_t::~texture2D_array_t() { glDeleteTextures(1, &_gl_id); }
+
+uint32_t texture2D_array_t::get_max_layer_count() {
+    static const auto max_layer_count = []() {
+        GLint max_layers{};
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+        return static_cast<uint32_t>(max_layers);
+    }();
+    return max_layer_count;
+}
+
+void texture2D_array_t::allocate_storage(uint32_t layer_count) {
+    uint32_t new_gl_id{};
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &new_gl_id);
+    glTextureStorage3D(new_gl_id, static_cast<GLsizei>(_level_count), _internal_format,
+                       static_cast<GLsizei>(_width), static_cast<GLsizei>(_height),
+                       static_cast<GLsizei>(layer_count));
+
+    glTextureParameteri(new_gl_id, GL_TEXTURE_MIN_FILTER, _downscaling_algo);
+    glTextureParameteri(new_gl_id, GL_TEXTURE_MAG_FILTER, _upscaling_algo);
+
+    if (_gl_id != 0) {
+        for (uint32_t level = 0; level < _level_count; level++) {
+            const auto size = get_level_size(level);
+            glCopyImageSubData(_gl_id, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, 0,
+                               new_gl_id, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, 0,
+                               size.x, size.y, static_cast<GLsizei>(_layer_count));
+        }
+        glDeleteTextures(1, &_gl_id);
+    }
+    // pushed in reverse so the lowest free layer is used first
+    for (auto layer = layer_count; layer > _layer_count; layer--) {
+        _free_layers.push_back(layer - 1);
+    }
+    _gl_id = new_gl_id;
+    _layer_count = layer_count;
+}
+
+std::optional<uint32_t> texture2D_array_t::add_layer(const texture2D_t& texture) {
+    debug_assert(texture.get_width() == _width && texture.get_height() == _height
+                   && texture.get_internal_format() == _internal_format,
+                 "Texture doesn't match texture array layer format.");
+    if (_free_layers.empty()) {
+        if (_layer_count >= get_max_layer_count()) return std::nullopt;
+        allocate_storage(std::min(_layer_count * 2, get_max_layer_count()));
+    }
+    auto layer = _free_layers.back();
+    _free_layers.pop_back();
+
+    // cooked textures bring their whole mip chain, the others have to be generated
+    const auto copied_level_count = std::min(texture.get_level_count(), _level_count);
+    for (uint32_t level = 0; level < copied_level_count; level++) {
+        const auto size = get_level_size(level);
+        glCopyImageSubData(texture.get_gl_id(), GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, 0,
+                           _gl_id, GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0,
+                           static_cast<GLint>(layer), size.x, size.y, 1);
+    }
+    if (copied_level_count < _level_count) {
+        debug_assert(!texture.is_compressed(), "Compressed texture without a full mip chain.");
+        generate_layer_levels(layer, copied_level_count);
+    }
+    return layer;
+}
+
+void texture2D_array_t::generate_layer_levels(uint32_t layer, uint32_t first_level) {
+    // glGenerateTextureMipmap would regenerate the levels of all layers, including cooked ones
+    std::array<uint32_t, 2> framebuffers{};
+    glCreateFramebuffers(2, framebuffers.data());
+    const auto [read_fb, draw_fb] = framebuffers;
+    for (auto level = std::max(first_level, 1U); level < _level_count; level++) {
+        const auto src_size = get_level_size(level - 1);
+        const auto dst_size = get_level_size(level);
+        glNamedFramebufferTextureLayer(read_fb, GL_COLOR_ATTACHMENT0, _gl_id,
+                                       static_cast<GLint>(level - 1), static_cast<GLint>(layer));
+        glNamedFramebufferTextureLayer(draw_fb, GL_COLOR_ATTACHMENT0, _gl_id,
+                                       static_cast<GLint>(level), static_cast<GLint>(layer));
+        glNamedFramebufferReadBuffer(read_fb, GL_COLOR_ATTACHMENT0);
+        glNamedFramebufferDrawBuffer(draw_fb, GL_COLOR_ATTACHMENT0);
+        glBlitNamedFramebuffer(read_fb, draw_fb, 0, 0, src_size.x, src_size.y, 0, 0, dst_size.x,
+                               dst_size.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glDeleteFramebuffers(2, framebuffers.data());
+}
+
+glm::ivec2 texture2D_array_t::get_level_size(uint32_t level) const {
+    return {std::max(1U, _width >> level), std::max(1U, _height >> level)};
+}
+
+void texture2D_array_t::free_layer(uint32_t layer) {
+    debug_assert(layer < _layer_count
+                   && std::find(_free_layers.begin(), _free_layers.end(), layer)
+                        == _free_layers.end(),
+                 "Freeing texture array layer that isn't in use.");
+    _free_layers.push_back(layer);
+}
+
+std::shared_ptr<texture_array_layer_t>
+  texture_array_pool_t::acquire(const std::shared_ptr<texture2D_t>& texture) {
+    debug_assert(texture->is_resident() && texture->get_base_level() == 0,
+                 "Texture must be fully resident to be copied into an array.");
+    if (auto it = _layers.find(texture.get()); it != _layers.end()) {
+        if (auto layer = it->second.lock(); layer && layer->is_copy_of(texture)) return layer;
+        _layers.erase(it);
+    }
+
+    auto& arrays = _arrays[{texture->get_width(), texture->get_height(),
+                            texture->get_internal_format(), texture->get_upscaling_mode(),
+                            texture->get_downscaling_mode()}];
+    // arrays referenced only by the pool have no layers in use
+    std::erase_if(arrays, [](const auto& array) { return array.use_count() == 1; });
+
+    for (auto& array : arrays) {
+        if (auto layer_ix = array->add_layer(*texture)) {
+            auto layer = std::make_shared<texture_array_layer_t>(array, *layer_ix, texture);
+            _layers[texture.get()] = layer;
+            return layer;
+        }
+    }
+
+    auto& array = arrays.emplace_back(std::make_shared<texture2D_array_t>(
+      texture->get_width(), texture->get_height(), texture->get_internal_format(),
+      initial_layer_count, texture->get_upscaling_mode(), texture->get_downscaling_mode()));
+    spdlog::debug("Created {}x{} texture array, {} arrays of this format in pool.",
+                  texture->get_width(), texture->get_height(), arrays.size());
+
+    auto layer_ix = array->add_layer(*texture);
+    debug_assert(layer_ix.has_value(), "Newly created texture array has no free layers.");
+    auto layer = std::make_shared<texture_array_layer_t>(array, *layer_ix, texture);
+    _layers[texture.get()] = layer;
+    return layer;
+}
+
+void texture_array_pool_t::clear() {
+    _arrays.clear();
+    _layers.clear();
+}
+
+} // namespace pgre
@@ -0,0 +1,217 @@
+#include "error_handling.h"
+#include <assets/asset_registry.h>
+#include <assets/textures/texture_atlas.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#include <fmt/format.h>
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace pgre {
+
+skyline_packer_t::skyline_packer_t(uint32_t width, uint32_t height)
+  : _width(width), _height(height), _skyline{{0, 0, width}} {}
+
+std::optional<uint32_t> skyline_packer_t::fit(size_t segment_ix, uint32_t width,
+                                              uint32_t height) const {
+    if (_skyline[segment_ix].x + width > _width) return std::nullopt;
+
+    uint32_t y = _skyline[segment_ix].y;
+    uint32_t width_left = width;
+    for (auto ix = segment_ix; width_left > 0; ix++) {
+        y = std::max(y, _skyline[ix].y);
+        if (y + height > _height) return std::nullopt;
+        if (_skyline[ix].width >= width_left) break;
+        width_left -= _skyline[ix].width;
+    }
+    return y;
+}
+
+void skyline_packer_t::add_segment(size_t segment_ix, uint32_t x, uint32_t y, uint32_t width,
+                                   uint32_t height) {
+    _skyline.insert(_skyline.begin() + static_cast<ptrdiff_t>(segment_ix),
+                    segment_t{x, y + height, width});
+
+    // shrink or remove the segments now covered by the new one
+    const auto new_segment_end = x + width;
+    for (auto ix = segment_ix + 1; ix < _skyline.size();) {
+        auto& segment = _skyline[ix];
+        if (segment.x >= new_segment_end) break;
+        auto overlap = new_segment_end - segment.x;
+        if (segment.width <= overlap) {
+            _skyline.erase(_skyline.begin() + static_cast<ptrdiff_t>(ix));
+            continue;
+        }
+        segment.x += overlap;
+        segment.width -= overlap;
+        break;
+    }
+
+    // merge neighbouring segments of equal height
+    for (size_t ix = 0; ix + 1 < _skyline.size();) {
+        if (_skyline[ix].y == _skyline[ix + 1].y) {
+            _skyline[ix].width += _skyline[ix + 1].width;
+            _skyline.erase(_skyline.begin() + static_cast<ptrdiff_t>(ix) + 1);
+        } else {
+            ix++;
+        }
+    }
+}
+
+std::optional<glm::uvec2> skyline_packer_t::insert(uint32_t width, uint32_t height) {
+    std::optional<size_t> best_ix{};
+    uint32_t best_top = std::numeric_limits<uint32_t>::max();
+    uint32_t best_y{};
+    for (size_t ix = 0; ix < _skyline.size(); ix++) {
+        if (auto y = fit(ix, width, height); y && *y + height < best_top) {
+            best_ix = ix;
+            best_top = *y + height;
+            best_y = *y;
+        }
+    }
+    if (!best_ix) return std::nullopt;
+
+    glm::uvec2 position{_skyline[*best_ix].x, best_y};
+    add_segment(*best_ix, position.x, position.y, width, height);
+    return position;
+}
+
+texture_atlas_builder_t::texture_atlas_builder_t(uint32_t atlas_size, uint32_t padding)
+  : _atlas_size(atlas_size), _padding(padding) {}
+
+std::shared_ptr<const texture_atlas_builder_t::image_t>
+  texture_atlas_builder_t::load_image(const std::filesystem::path& path) {
+    static std::mutex cache_mutex{};
+    static std::map<std::filesystem::path, decoded_entry_t> cache{};
+    static size_t cache_size = 0;
+    static uint64_t use_counter = 0;
+
+    // files in mounted archives have no write time and aren't cached
+    std::error_code error{};
+    const auto write_time = std::filesystem::last_write_time(path, error);
+    if (!error) {
+        std::lock_guard lock{cache_mutex};
+        if (auto it = cache.find(path); it != cache.end() && it->second.write_time == write_time) {
+            it->second.last_use = ++use_counter;
+            return it->second.image;
+        }
+    }
+
+    int width{}, height{}, channels{};
+    unsigned char* data = ::pgre::load_image(path, &width, &height, &channels, 4);
+    if (!data)
+        throw image_loading_error(fmt::format("Failed to load image at path {}", path.string()));
+
+    auto image = std::make_shared<const image_t>(
+      image_t{std::vector<unsigned char>(data, data + static_cast<size_t>(width) * height * 4),
+              static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+    stbi_image_free(data);
+    if (error) return image;
+
+    std::lock_guard lock{cache_mutex};
+    if (auto it = cache.find(path); it != cache.end()) {
+        cache_size -= it->second.image->rgba_data.size();
+        cache.erase(it);
+    }
+    cache.emplace(path, decoded_entry_t{write_time, image, ++use_counter});
+    cache_size += image->rgba_data.size();
+    // evict the least recently used images, the ones still being packed stay alive anyway
+    while (cache_size > decoded_cache_budget && cache.size() > 1) {
+        auto lru = std::ranges::min_element(
+          cache, {}, [](const auto& entry) { return entry.second.last_use; });
+        cache_size -= lru->second.image->rgba_data.size();
+        cache.erase(lru);
+    }
+    return image;
+}
+
+std::optional<glm::uvec2>
+  texture_atlas_builder_t::get_image_size(const std::filesystem::path& path) {
+    int width{}, height{}, channels{};
+    if (!get_image_info(path, &width, &height, &channels)) return std::nullopt;
+    return glm::uvec2{width, height};
+}
+
+void texture_atlas_builder_t::blit_padded(atlas_t& atlas, const image_t& image,
+                                          glm::uvec2 padded_pos) const {
+    const auto padded_width = image.width + 2 * _padding;
+    const auto padded_height = image.height + 2 * _padding;
+    for (uint32_t dy = 0; dy < padded_height; dy++) {
+        auto src_y = std::clamp<int64_t>(static_cast<int64_t>(dy) - _padding, 0, image.height - 1);
+        for (uint32_t dx = 0; dx < padded_width; dx++) {
+            auto src_x
+              = std::clamp<int64_t>(static_cast<int64_t>(dx) - _padding, 0, image.width - 1);
+            const auto* src = image.rgba_data.data() + (src_y * image.width + src_x) * 4;
+            auto* dst = atlas.image.rgba_data.data()
+                        + ((padded_pos.y + dy) * static_cast<size_t>(_atlas_size) + padded_pos.x
+                           + dx)
+                            * 4;
+            std::copy_n(src, 4, dst);
+        }
+    }
+}
+
+std::optional<texture_atlas_builder_t::entry_t>
+  texture_atlas_builder_t::add(const image_t& image) {
+    const auto padded_width = image.width + 2 * _padding;
+    const auto padded_height = image.height + 2 * _padding;
+    if (padded_width > _atlas_size || padded_height > _atlas_size) return std::nullopt;
+
+    std::optional<glm::uvec2> position{};
+    size_t atlas_ix = 0;
+    for (; atlas_ix < _atlases.size(); atlas_ix++) {
+        position = _atlases[atlas_ix].packer.insert(padded_width, padded_height);
+        if (position) break;
+    }
+    if (!position) {
+        _atlases.push_back(
+          {skyline_packer_t{_atlas_size, _atlas_size},
+           image_t{std::vector<unsigned char>(static_cast<size_t>(_atlas_size) * _atlas_size * 4),
+                   _atlas_size, _atlas_size}});
+        atlas_ix = _atlases.size() - 1;
+        position = _atlases.back().packer.insert(padded_width, padded_height);
+        debug_assert(position.has_value(), "Image doesn't fit into empty atlas.");
+    }
+
+    blit_padded(_atlases[atlas_ix], image, *position);
+
+    const auto atlas_size_f = static_cast<float>(_atlas_size);
+    return entry_t{atlas_ix,
+                   {static_cast<float>(image.width) / atlas_size_f,
+                    static_cast<float>(image.height) / atlas_size_f,
+                    static_cast<float>(position->x + _padding) / atlas_size_f,
+                    static_cast<float>(position->y + _padding) / atlas_size_f}};
+}
+
+void texture_atlas_builder_t::write_atlas(size_t atlas_ix,
+                                          const std::filesystem::path& path) const {
+    const auto& image = _atlases.at(atlas_ix).image;
+    // rows are stored bottom to top, texture2D_t flips them back when loading. They're written
+    // from the last one with a negative stride, as the stbi_flip_vertically_on_write flag is
+    // global and atlases are written from import workers.
+    const auto stride = static_cast<int>(image.width * 4);
+    const auto* last_row
+      = image.rgba_data.data() + static_cast<size_t>(image.height - 1) * image.width * 4;
+    if (stbi_write_png(path.string().c_str(), static_cast<int>(image.width),
+                       static_cast<int>(image.height), 4, last_row, -stride)
+        == 0) {
+        throw std::runtime_error(fmt::format("Failed to write texture atlas to {}", path.string()));
+    }
+}
+
+std::shared_ptr<texture2D_t>
+  texture_atlas_builder_t::save_atlas(size_t atlas_ix, const std::filesystem::path& path,
+                                      GLint upscaling_algo, GLint downscaling_algo,
+                                      bool compressed) const {
+    write_atlas(atlas_ix, path);
+    // an identical atlas written by an earlier import is reused
+    return asset_registry_t::get().get_texture2D(path, upscaling_algo, downscaling_algo,
+                                                 compressed);
+}
+
+} // namespace pgre
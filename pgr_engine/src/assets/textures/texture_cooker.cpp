@@ -0,0 +1,299 @@
+#include "error_handling.h"
+#include <assets/textures/texture_cooker.h>
+#include <utility/thread_pool.h>
+#include <utility/vfs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <squish.h>
+#include <stb_image.h>
+
+namespace pgre {
+
+namespace {
+    struct pgtex_header_t
+    {
+        std::array<char, 4> magic;
+        uint32_t version;
+        uint32_t width, height;
+        uint32_t internal_format;
+        uint32_t has_alpha;
+        uint32_t face_count, level_count;
+    };
+
+    constexpr auto block_rows_per_task = 16U;
+} // namespace
+
+void cooked_texture_t::write(const std::filesystem::path& path) const {
+    debug_assert(base_level == 0, "Writing cooked texture without its finest levels.");
+    // readers map the cache, it's replaced only once complete, and other threads or processes
+    // cooking the same texture write their own temp files
+    auto temp_path = path;
+    temp_path += fmt::format(".{:08x}{:08x}.tmp", std::random_device{}(), std::random_device{}());
+    {
+        std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+        if (!file)
+            throw std::runtime_error(
+              fmt::format("Failed to open {} for writing", temp_path.string()));
+
+        pgtex_header_t header{magic,
+                              format_version,
+                              width,
+                              height,
+                              internal_format,
+                              has_alpha ? 1U : 0U,
+                              static_cast<uint32_t>(faces.size()),
+                              get_level_count()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& levels : faces) {
+            for (const auto& level : levels) {
+                auto size = static_cast<uint64_t>(level.size());
+                file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+                file.write(reinterpret_cast<const char*>(level.data()),
+                           static_cast<std::streamsize>(size));
+            }
+        }
+        file.close();
+        if (!file) {
+            std::error_code err{};
+            std::filesystem::remove(temp_path, err);
+            throw std::runtime_error(fmt::format("Failed to write {}", temp_path.string()));
+        }
+    }
+
+    std::error_code err{};
+    std::filesystem::rename(temp_path, path, err);
+    if (err) {
+        std::filesystem::remove(temp_path, err);
+        throw std::runtime_error(fmt::format("Failed to replace {}", path.string()));
+    }
+}
+
+std::optional<cooked_texture_t> cooked_texture_t::read(const std::filesystem::path& path,
+                                                       uint32_t base_level) {
+    auto file = vfs_t::get().open(path);
+    if (!file) return std::nullopt;
+    const auto file_data = file->get_data();
+    size_t offset = 0;
+    bool truncated = false;
+    const auto read = [&](void* value, size_t size) {
+        truncated |= size > file_data.size() - offset;
+        if (truncated) return;
+        std::memcpy(value, file_data.data() + offset, size);
+        offset += size;
+    };
+
+    pgtex_header_t header{};
+    read(&header, sizeof(header));
+    if (truncated || header.magic != magic || header.version != format_version
+        || header.level_count == 0)
+        return std::nullopt;
+
+    base_level = std::min(base_level, header.level_count - 1);
+    cooked_texture_t cooked{header.width, header.height, header.internal_format,
+                            header.has_alpha != 0, base_level};
+    cooked.faces.resize(header.face_count);
+    for (auto& levels : cooked.faces) {
+        levels.resize(header.level_count - base_level);
+        for (uint32_t level = 0; level < header.level_count; level++) {
+            uint64_t size{};
+            read(&size, sizeof(size));
+            if (truncated || size > file_data.size() - offset) {
+                truncated = true;
+                break;
+            }
+            if (level < base_level) {
+                offset += size;
+                continue;
+            }
+            auto& data = levels[level - base_level];
+            data.resize(size);
+            read(data.data(), size);
+        }
+    }
+    if (truncated) {
+        spdlog::warn("Cooked texture {} is truncated.", path.string());
+        return std::nullopt;
+    }
+    return cooked;
+}
+
+uint32_t texture_cooker_t::get_full_level_count(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::floor(std::log2(std::max({width, height, 1U})))) + 1;
+}
+
+size_t texture_cooker_t::get_compressed_size(glm::uvec2 size, GLenum internal_format) {
+    const size_t block_size = internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8;
+    return static_cast<size_t>((size.x + 3) / 4) * ((size.y + 3) / 4) * block_size;
+}
+
+std::vector<uint8_t> texture_cooker_t::downsample(const std::vector<uint8_t>& rgba, uint32_t width,
+                                                  uint32_t height) {
+    const auto new_width = std::max(1U, width / 2);
+    const auto new_height = std::max(1U, height / 2);
+    std::vector<uint8_t> result(static_cast<size_t>(new_width) * new_height * 4);
+
+    thread_pool_t::get_global().parallel_for(0, new_height, [&](size_t y) {
+        const auto y0 = std::min<size_t>(y * 2, height - 1);
+        const auto y1 = std::min<size_t>(y * 2 + 1, height - 1);
+        for (size_t x = 0; x < new_width; x++) {
+            const auto x0 = std::min<size_t>(x * 2, width - 1);
+            const auto x1 = std::min<size_t>(x * 2 + 1, width - 1);
+            for (size_t channel = 0; channel < 4; channel++) {
+                auto sum = rgba[(y0 * width + x0) * 4 + channel] + rgba[(y0 * width + x1) * 4 + channel]
+                           + rgba[(y1 * width + x0) * 4 + channel]
+                           + rgba[(y1 * width + x1) * 4 + channel];
+                result[(y * new_width + x) * 4 + channel] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<uint8_t> texture_cooker_t::compress(const uint8_t* rgba, uint32_t width,
+                                                uint32_t height, bool alpha) {
+    const int flags = (alpha ? squish::kDxt5 : squish::kDxt1) | squish::kColourClusterFit;
+    const auto block_size = alpha ? 16U : 8U;
+    const auto blocks_per_row = (width + 3) / 4;
+    const auto block_rows = (height + 3) / 4;
+    std::vector<uint8_t> result(static_cast<size_t>(blocks_per_row) * block_rows * block_size);
+
+    // each task compresses a horizontal strip of whole blocks
+    const auto task_count = (block_rows + block_rows_per_task - 1) / block_rows_per_task;
+    thread_pool_t::get_global().parallel_for(0, task_count, [&](size_t task_ix) {
+        const auto first_row = static_cast<uint32_t>(task_ix) * block_rows_per_task * 4;
+        const auto row_count = std::min(block_rows_per_task * 4, height - first_row);
+        squish::CompressImage(rgba + static_cast<size_t>(first_row) * width * 4,
+                              static_cast<int>(width), static_cast<int>(row_count),
+                              result.data()
+                                + static_cast<size_t>(first_row / 4) * blocks_per_row * block_size,
+                              flags);
+    });
+    return result;
+}
+
+cooked_texture_t texture_cooker_t::cook_rgba(std::vector<std::vector<uint8_t>> faces_rgba,
+                                             uint32_t width, uint32_t height, bool has_alpha) {
+    cooked_texture_t cooked{width, height,
+                            has_alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                      : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                            has_alpha};
+    const auto level_count = get_full_level_count(width, height);
+
+    cooked.faces.resize(faces_rgba.size());
+    for (size_t face_ix = 0; face_ix < faces_rgba.size(); face_ix++) {
+        auto& levels = cooked.faces[face_ix];
+        levels.reserve(level_count);
+
+        auto level_rgba = std::move(faces_rgba[face_ix]);
+        for (uint32_t level = 0; level < level_count; level++) {
+            auto size = cooked.get_level_size(level);
+            levels.push_back(compress(level_rgba.data(), size.x, size.y, has_alpha));
+            if (level + 1 < level_count) level_rgba = downsample(level_rgba, size.x, size.y);
+        }
+    }
+    return cooked;
+}
+
+cooked_texture_t
+  texture_cooker_t::decode(const std::vector<std::filesystem::path>& face_sources) {
+    debug_assert(!face_sources.empty(), "Decoding texture without sources.");
+
+    struct decoded_t
+    {
+        std::vector<uint8_t> rgba;
+        int width, height, channels;
+    };
+    std::vector<std::future<decoded_t>> decoding{};
+    for (const auto& source : face_sources) {
+        decoding.push_back(thread_pool_t::get_global().submit([source]() {
+            decoded_t decoded{};
+            auto* data = load_image(source, &decoded.width, &decoded.height, &decoded.channels,
+                                    4);
+            if (!data)
+                throw image_loading_error(
+                  fmt::format("Failed to load image at path {}", source.string()));
+            decoded.rgba.assign(data, data + static_cast<size_t>(decoded.width) * decoded.height * 4);
+            stbi_image_free(data);
+            return decoded;
+        }));
+    }
+
+    cooked_texture_t result{};
+    for (size_t face_ix = 0; face_ix < decoding.size(); face_ix++) {
+        auto decoded = decoding[face_ix].get();
+        if (face_ix == 0) {
+            result.width = static_cast<uint32_t>(decoded.width);
+            result.height = static_cast<uint32_t>(decoded.height);
+        } else if (result.width != static_cast<uint32_t>(decoded.width)
+                   || result.height != static_cast<uint32_t>(decoded.height)) {
+            throw image_loading_error(fmt::format("Dimensions of faces differ for {}.",
+                                                  face_sources[face_ix].string()));
+        }
+        result.has_alpha |= decoded.channels == 4;
+        result.faces.push_back({std::move(decoded.rgba)});
+    }
+    result.internal_format = result.has_alpha ? GL_RGBA8 : GL_RGB8;
+    return result;
+}
+
+cooked_texture_t texture_cooker_t::cook(const std::vector<std::filesystem::path>& face_sources) {
+    auto decoded = decode(face_sources);
+    std::vector<std::vector<uint8_t>> faces_rgba{};
+    faces_rgba.reserve(decoded.faces.size());
+    for (auto& levels : decoded.faces) {
+        faces_rgba.push_back(std::move(levels.front()));
+    }
+    return cook_rgba(std::move(faces_rgba), decoded.width, decoded.height, decoded.has_alpha);
+}
+
+std::filesystem::path texture_cooker_t::get_cache_path(const std::filesystem::path& source,
+                                                       size_t face_count) {
+    auto cache_path = source;
+    cache_path += face_count > 1 ? ".cube.pgtex" : ".pgtex";
+    return cache_path;
+}
+
+bool texture_cooker_t::is_cache_up_to_date(
+  const std::vector<std::filesystem::path>& face_sources) {
+    const auto cache_path = get_cache_path(face_sources.front(), face_sources.size());
+    // archives are packed after cooking, their sources may not even be packed
+    if (vfs_t::get().find_archived(cache_path)) return true;
+    std::error_code err{};
+    auto cache_time = std::filesystem::last_write_time(cache_path, err);
+    return !err && std::ranges::all_of(face_sources, [&](const auto& source) {
+        std::error_code source_err{};
+        auto source_time = std::filesystem::last_write_time(source, source_err);
+        return !source_err && source_time <= cache_time;
+    });
+}
+
+cooked_texture_t
+  texture_cooker_t::load_or_cook(const std::vector<std::filesystem::path>& face_sources,
+                                 uint32_t base_level) {
+    auto cache_path = get_cache_path(face_sources.front(), face_sources.size());
+    if (is_cache_up_to_date(face_sources)) {
+        auto cooked = cooked_texture_t::read(cache_path, base_level);
+        if (cooked && cooked->faces.size() == face_sources.size()) return std::move(*cooked);
+    }
+
+    auto cooked = cook(face_sources);
+    try {
+        cooked.write(cache_path);
+    } catch (const std::runtime_error& e) {
+        spdlog::warn("Failed to cache cooked texture: {}", e.what());
+    }
+    cooked.base_level = std::min(base_level, cooked.get_level_count() - 1);
+    for (auto& levels : cooked.faces) {
+        levels.erase(levels.begin(), levels.begin() + cooked.base_level);
+    }
+    return cooked;
+}
+
+} // namespace pgre
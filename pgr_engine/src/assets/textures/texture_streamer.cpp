@@ -0,0 +1,276 @@
+#include "error_handling.h"
+#include <assets/textures/texture_streamer.h>
+#include <utility/call_at_scope_exit.h>
+#include <utility/vfs.h>
+
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace pgre {
+
+namespace {
+    constexpr size_t staging_alignment = 16;
+
+    bool is_compressed_format(GLenum internal_format) {
+        return internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+               || internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+
+    size_t get_faces_size(const std::vector<std::vector<std::vector<uint8_t>>>& faces,
+                          uint32_t level, size_t first_face, size_t face_count) {
+        size_t size = 0;
+        for (size_t face = first_face; face < first_face + face_count; face++) {
+            size += faces[face][level].size();
+        }
+        return size;
+    }
+} // namespace
+
+texture_streamer_t& texture_streamer_t::get() {
+    static texture_streamer_t streamer{};
+    return streamer;
+}
+
+void texture_streamer_t::init_gl_resources() {
+    if (_staging_buffer != 0) return;
+
+    glCreateBuffers(1, &_staging_buffer);
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(_staging_buffer, static_cast<GLsizeiptr>(_staging_size), nullptr, flags);
+    _staging_ptr = static_cast<uint8_t*>(glMapNamedBufferRange(
+      _staging_buffer, 0, static_cast<GLsizeiptr>(_staging_size), flags));
+    debug_assert(_staging_ptr != nullptr, "Failed to map texture staging buffer.");
+}
+
+uint32_t texture_streamer_t::get_placeholder_gl_id() {
+    if (_placeholder_gl_id == 0) {
+        constexpr std::array<uint8_t, 4> white{0xFF, 0xFF, 0xFF, 0xFF};
+        glCreateTextures(GL_TEXTURE_2D, 1, &_placeholder_gl_id);
+        glTextureStorage2D(_placeholder_gl_id, 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(_placeholder_gl_id, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            white.data());
+    }
+    return _placeholder_gl_id;
+}
+
+cooked_texture_t texture_streamer_t::decode(const texture_stream_request_t& request) {
+    if (request.compressed)
+        return texture_cooker_t::load_or_cook(request.face_sources, request.base_level);
+    // uncompressed textures are stored as a single level, like the synchronous path does
+    return texture_cooker_t::decode(request.face_sources);
+}
+
+std::shared_ptr<texture_stream_request_t>
+  texture_streamer_t::request(GLenum target, std::vector<std::filesystem::path> face_sources,
+                              bool compressed,
+                              std::function<void(const texture_stream_result_t&)> on_resident,
+                              uint32_t base_level) {
+    // the files decode() reads, prefetched ones are kept for it past vfs_t::drop_prefetched
+    auto read_paths = face_sources;
+    if (compressed)
+        read_paths.push_back(
+          texture_cooker_t::get_cache_path(face_sources.front(), face_sources.size()));
+    vfs_t::get().hold_prefetched(read_paths);
+
+    auto request = std::make_shared<texture_stream_request_t>(
+      target, std::move(face_sources), compressed, base_level, std::move(on_resident));
+    auto decoded = _decode_pool.submit([request, read_paths = std::move(read_paths)]() {
+        auto release = call_at_scope_exit_t(
+          [&read_paths]() { vfs_t::get().release_prefetched(read_paths); });
+        return decode(*request);
+    });
+    _uploads.push_back({request, std::move(decoded)});
+    return request;
+}
+
+void texture_streamer_t::retire_staging_regions() {
+    while (!_staging_in_flight.empty()) {
+        auto& region = _staging_in_flight.front();
+        if (glClientWaitSync(region.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+        glDeleteSync(region.fence);
+        _staging_tail = region.end;
+        _staging_in_flight.pop_front();
+    }
+    if (_staging_in_flight.empty()) _staging_head = _staging_tail = 0;
+}
+
+std::optional<size_t> texture_streamer_t::allocate_staging(size_t size) {
+    size = (size + staging_alignment - 1) / staging_alignment * staging_alignment;
+    if (_staging_head >= _staging_tail) {
+        // in use: [tail, head)
+        if (_staging_head + size <= _staging_size) {
+            auto offset = _staging_head;
+            _staging_head += size;
+            return offset;
+        }
+        // wrap around, head must stay behind tail
+        if (size < _staging_tail) {
+            _staging_head = size;
+            return 0;
+        }
+        return std::nullopt;
+    }
+    // in use: [tail, end) and [0, head)
+    if (_staging_head + size < _staging_tail) {
+        auto offset = _staging_head;
+        _staging_head += size;
+        return offset;
+    }
+    return std::nullopt;
+}
+
+size_t texture_streamer_t::get_next_face_count(const upload_t& upload) const {
+    const auto& faces = upload.data->faces;
+    const auto face_count = faces.size() - upload.next_face;
+    return get_faces_size(faces, upload.next_level, upload.next_face, face_count)
+               <= _staging_size
+             ? face_count
+             : 1;
+}
+
+bool texture_streamer_t::upload_next_faces(upload_t& upload, size_t face_count) {
+    const auto& data = *upload.data;
+    const auto size = data.get_level_size(data.base_level + upload.next_level);
+    const auto byte_count
+      = get_faces_size(data.faces, upload.next_level, upload.next_face, face_count);
+
+    const void* pixels = data.faces[upload.next_face][upload.next_level].data();
+    bool staged = false;
+    if (byte_count <= _staging_size) {
+        auto offset = allocate_staging(byte_count);
+        if (!offset) return false;
+        // faces are staged back to back, as consecutive layers of the cubemap
+        auto face_offset = *offset;
+        for (size_t face = upload.next_face; face < upload.next_face + face_count; face++) {
+            const auto& face_data = data.faces[face][upload.next_level];
+            std::memcpy(_staging_ptr + face_offset, face_data.data(), face_data.size());
+            face_offset += face_data.size();
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging_buffer);
+        pixels = reinterpret_cast<const void*>(*offset); // NOLINT(performance-no-int-to-ptr)
+        staged = true;
+        _staging_used_this_frame = true;
+    } // else a single face too large to stage, upload straight from client memory
+
+    const bool compressed = is_compressed_format(data.internal_format);
+    const auto level = static_cast<GLint>(upload.next_level);
+    const auto width = static_cast<GLsizei>(size.x);
+    const auto height = static_cast<GLsizei>(size.y);
+    if (upload.request->target == GL_TEXTURE_CUBE_MAP) {
+        const auto first_face = static_cast<GLint>(upload.next_face);
+        const auto depth = static_cast<GLsizei>(face_count);
+        if (compressed) {
+            glCompressedTextureSubImage3D(upload.gl_id, level, 0, 0, first_face, width, height,
+                                          depth, data.internal_format,
+                                          static_cast<GLsizei>(byte_count), pixels);
+        } else {
+            glTextureSubImage3D(upload.gl_id, level, 0, 0, first_face, width, height, depth,
+                                GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        }
+    } else {
+        if (compressed) {
+            glCompressedTextureSubImage2D(upload.gl_id, level, 0, 0, width, height,
+                                          data.internal_format, static_cast<GLsizei>(byte_count),
+                                          pixels);
+        } else {
+            glTextureSubImage2D(upload.gl_id, level, 0, 0, width, height, GL_RGBA,
+                                GL_UNSIGNED_BYTE, pixels);
+        }
+    }
+    if (staged) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    upload.next_face += face_count;
+    if (upload.next_face == data.faces.size()) {
+        upload.next_face = 0;
+        upload.next_level++;
+    }
+    return true;
+}
+
+void texture_streamer_t::pump() {
+    init_gl_resources();
+    retire_staging_regions();
+
+    size_t uploaded_bytes = 0;
+    bool staging_full = false;
+    for (auto it = _uploads.begin(); it != _uploads.end() && !staging_full;) {
+        auto& upload = *it;
+        if (upload.request->cancelled) {
+            if (upload.gl_id != 0) glDeleteTextures(1, &upload.gl_id);
+            it = _uploads.erase(it);
+            continue;
+        }
+        if (!upload.data) {
+            if (upload.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            // a failed decode drops only its own request, the exception is rethrown here on the
+            // GL thread
+            try {
+                upload.data = upload.decoded.get();
+            } catch (const std::exception& e) {
+                spdlog::error("Texture streaming failed: {}", e.what());
+                it = _uploads.erase(it);
+                continue;
+            } catch (...) {
+                spdlog::error("Texture streaming failed: unknown error");
+                it = _uploads.erase(it);
+                continue;
+            }
+            const auto size = upload.data->get_level_size(upload.data->base_level);
+            glCreateTextures(upload.request->target, 1, &upload.gl_id);
+            glTextureStorage2D(upload.gl_id, static_cast<GLsizei>(upload.data->get_level_count()),
+                               upload.data->internal_format, static_cast<GLsizei>(size.x),
+                               static_cast<GLsizei>(size.y));
+        }
+
+        const auto level_count = upload.data->get_level_count();
+        while (upload.next_level < level_count) {
+            const auto face_count = get_next_face_count(upload);
+            const auto byte_count = get_faces_size(upload.data->faces, upload.next_level,
+                                                   upload.next_face, face_count);
+            if (uploaded_bytes > 0 && uploaded_bytes + byte_count > _frame_budget) break;
+            if (!upload_next_faces(upload, face_count)) {
+                staging_full = true;
+                break;
+            }
+            uploaded_bytes += byte_count;
+        }
+        if (upload.next_level < level_count) break; // out of budget
+
+        const auto& data = *upload.data;
+        upload.request->on_resident({upload.gl_id, data.width, data.height, data.internal_format,
+                                     data.base_level, data.get_level_count(), data.has_alpha});
+        it = _uploads.erase(it);
+    }
+
+    if (_staging_used_this_frame) {
+        _staging_in_flight.push_back({_staging_head, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+        _staging_used_this_frame = false;
+    }
+}
+
+void texture_streamer_t::shutdown() {
+    for (auto& upload : _uploads) {
+        if (upload.gl_id != 0) glDeleteTextures(1, &upload.gl_id);
+    }
+    _uploads.clear();
+    for (auto& region : _staging_in_flight) glDeleteSync(region.fence);
+    _staging_in_flight.clear();
+    _staging_head = _staging_tail = 0;
+
+    if (_staging_buffer != 0) {
+        glUnmapNamedBuffer(_staging_buffer);
+        glDeleteBuffers(1, &_staging_buffer);
+        _staging_buffer = 0;
+        _staging_ptr = nullptr;
+    }
+    if (_placeholder_gl_id != 0) {
+        glDeleteTextures(1, &_placeholder_gl_id);
+        _placeholder_gl_id = 0;
+    }
+}
+
+} // namespace pgre
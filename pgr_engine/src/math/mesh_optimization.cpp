@@ -0,0 +1,374 @@
+#include <math/mesh_optimization.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include <utility/hash.h>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+namespace pgre::math {
+
+namespace {
+    /**
+     * @brief FIFO post-transform cache, entries expire once cache_size newer vertices were
+     * transformed.
+     */
+    class fifo_cache_t
+    {
+        std::vector<uint32_t> _timestamps;
+        uint32_t _cache_size;
+        uint32_t _time;
+
+    public:
+        fifo_cache_t(size_t vertex_count, uint32_t cache_size)
+          : _timestamps(vertex_count, 0), _cache_size(cache_size), _time(cache_size + 1) {}
+
+        /**
+         * @brief Returns true on a miss, the vertex is transformed and cached.
+         */
+        bool access(uint32_t vertex) {
+            if (_time - _timestamps[vertex] <= _cache_size) return false;
+            _timestamps[vertex] = _time++;
+            return true;
+        }
+
+        void flush() { _time += _cache_size + 1; }
+    };
+
+    /**
+     * @brief Triangles using each vertex, in compressed row storage.
+     */
+    struct vertex_adjacency_t
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        vertex_adjacency_t(std::span<const uint32_t> indices, size_t vertex_count)
+          : offsets(vertex_count + 1, 0), triangles(indices.size()) {
+            for (auto index : indices) offsets[index + 1]++;
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        [[nodiscard]] std::span<const uint32_t> get(uint32_t vertex) const {
+            return {triangles.data() + offsets[vertex], offsets[vertex + 1] - offsets[vertex]};
+        }
+    };
+
+    /**
+     * @brief Vertices by the cell of a uniform grid their position lies in.
+     */
+    class vertex_grid_t
+    {
+        std::unordered_map<uint64_t, std::vector<uint32_t>> _cells{};
+        float _cell_size;
+
+    public:
+        /**
+         * @param cell_size at least the position epsilon, so that matching vertices lie in
+         * neighbouring cells. 0 for exact matches, each distinct position is its own cell.
+         */
+        explicit vertex_grid_t(float cell_size) : _cell_size(cell_size) {}
+
+        [[nodiscard]] std::array<int64_t, 3> get_cell(const float* position) const {
+            std::array<int64_t, 3> cell{};
+            for (size_t i = 0; i < 3; i++) {
+                if (_cell_size > 0.0f) {
+                    cell[i] = static_cast<int64_t>(std::floor(position[i] / _cell_size));
+                } else {
+                    // -0 and 0 share a cell
+                    float coordinate = position[i] == 0.0f ? 0.0f : position[i];
+                    uint32_t bits{};
+                    std::memcpy(&bits, &coordinate, sizeof(bits));
+                    cell[i] = bits;
+                }
+            }
+            return cell;
+        }
+
+        void insert(const std::array<int64_t, 3>& cell, uint32_t vertex) {
+            _cells[hash_bytes(cell.data(), sizeof(cell))].push_back(vertex);
+        }
+
+        /**
+         * @brief Calls fn with the vertices in the cell and its neighbours until it returns true.
+         */
+        template<typename FnTy>
+        bool find(const std::array<int64_t, 3>& cell, FnTy&& fn) const {
+            const int64_t reach = _cell_size > 0.0f ? 1 : 0;
+            for (int64_t x = -reach; x <= reach; x++) {
+                for (int64_t y = -reach; y <= reach; y++) {
+                    for (int64_t z = -reach; z <= reach; z++) {
+                        std::array<int64_t, 3> neighbour{cell[0] + x, cell[1] + y, cell[2] + z};
+                        auto it = _cells.find(hash_bytes(neighbour.data(), sizeof(neighbour)));
+                        if (it == _cells.end()) continue;
+                        for (auto vertex : it->second) {
+                            if (fn(vertex)) return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+    };
+} // namespace
+
+size_t weld_vertices(std::vector<float>& vertices, size_t stride, std::span<uint32_t> indices,
+                     std::span<const float> epsilons) {
+    const size_t vertex_count = vertices.size() / stride;
+    const auto get_vertex = [&](uint32_t vertex) { return vertices.data() + vertex * stride; };
+    const auto matches = [&](const float* lhs, const float* rhs) {
+        for (size_t i = 0; i < stride; i++) {
+            if (std::abs(lhs[i] - rhs[i]) > epsilons[i]) return false;
+        }
+        return true;
+    };
+
+    constexpr auto unmapped = UINT32_MAX;
+    std::vector<uint32_t> remap(vertex_count, unmapped);
+    std::vector<bool> referenced(vertex_count, false);
+    for (auto index : indices) referenced[index] = true;
+
+    vertex_grid_t grid{std::max({epsilons[0], epsilons[1], epsilons[2]})};
+    std::vector<float> result{};
+    result.reserve(vertices.size());
+    uint32_t next_vertex = 0;
+    for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        if (!referenced[vertex]) continue;
+        const float* attributes = get_vertex(vertex);
+        const auto cell = grid.get_cell(attributes);
+        uint32_t match = unmapped;
+        grid.find(cell, [&](uint32_t other) {
+            if (!matches(attributes, get_vertex(other))) return false;
+            match = other;
+            return true;
+        });
+        if (match != unmapped) {
+            remap[vertex] = remap[match];
+            continue;
+        }
+        grid.insert(cell, vertex);
+        remap[vertex] = next_vertex++;
+        result.insert(result.end(), attributes, attributes + stride);
+    }
+
+    for (auto& index : indices) index = remap[index];
+    vertices = std::move(result);
+    return next_vertex;
+}
+
+vertex_cache_stats_t analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertex_count,
+                                          uint32_t cache_size) {
+    if (indices.empty()) return {};
+    fifo_cache_t cache{vertex_count, cache_size};
+    std::vector<bool> referenced(vertex_count, false);
+    size_t misses = 0;
+    size_t referenced_count = 0;
+    for (auto index : indices) {
+        if (cache.access(index)) misses++;
+        if (!referenced[index]) {
+            referenced[index] = true;
+            referenced_count++;
+        }
+    }
+    return {static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+            static_cast<float>(misses) / static_cast<float>(referenced_count)};
+}
+
+std::vector<uint32_t> optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count,
+                                            uint32_t cache_size) {
+    std::vector<uint32_t> clusters{};
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) return clusters;
+
+    const vertex_adjacency_t adjacency{indices, vertex_count};
+    std::vector<uint32_t> live_triangles(vertex_count);
+    for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        live_triangles[vertex] = static_cast<uint32_t>(adjacency.get(vertex).size());
+    }
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    uint32_t time = cache_size + 1;
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end_stack{};
+    std::vector<uint32_t> candidates{};
+    uint32_t input_cursor = 0;
+
+    std::vector<uint32_t> result{};
+    result.reserve(indices.size());
+    const auto next_live_vertex = [&]() -> int64_t {
+        // recently used vertices first, they may still be cached
+        while (!dead_end_stack.empty()) {
+            auto vertex = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if (live_triangles[vertex] > 0) return vertex;
+        }
+        for (; input_cursor < vertex_count; input_cursor++) {
+            if (live_triangles[input_cursor] > 0) return input_cursor;
+        }
+        return -1;
+    };
+
+    int64_t fanning_vertex = next_live_vertex();
+    clusters.push_back(0);
+    while (fanning_vertex >= 0) {
+        candidates.clear();
+        for (auto triangle : adjacency.get(static_cast<uint32_t>(fanning_vertex))) {
+            if (emitted[triangle]) continue;
+            for (size_t corner = 0; corner < 3; corner++) {
+                auto vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                dead_end_stack.push_back(vertex);
+                candidates.push_back(vertex);
+                live_triangles[vertex]--;
+                if (time - timestamps[vertex] > cache_size) timestamps[vertex] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // the candidate staying in the cache the longest while its fan is emitted
+        int64_t best_vertex = -1;
+        int64_t best_priority = -1;
+        for (auto vertex : candidates) {
+            if (live_triangles[vertex] == 0) continue;
+            int64_t priority = 0;
+            if (time - timestamps[vertex] + 2 * live_triangles[vertex] <= cache_size) {
+                priority = time - timestamps[vertex];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best_vertex = vertex;
+            }
+        }
+        if (best_vertex == -1) {
+            best_vertex = next_live_vertex();
+            if (best_vertex >= 0) clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+        fanning_vertex = best_vertex;
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+    return clusters;
+}
+
+void optimize_overdraw(std::span<uint32_t> indices, std::span<const float> positions,
+                       size_t stride, const std::vector<uint32_t>& clusters, float threshold,
+                       uint32_t cache_size) {
+    const auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+    if (triangle_count == 0 || clusters.empty()) return;
+    const size_t vertex_count = positions.size() / stride;
+
+    // split clusters wherever the ACMR since the last split is close to the whole cluster's.
+    // One cache simulation is reused for all clusters, flushing it is O(1).
+    std::vector<uint32_t> soft_clusters{};
+    fifo_cache_t cache{vertex_count, cache_size};
+    for (size_t cluster_ix = 0; cluster_ix < clusters.size(); cluster_ix++) {
+        const auto start = clusters[cluster_ix];
+        const auto end
+          = cluster_ix + 1 < clusters.size() ? clusters[cluster_ix + 1] : triangle_count;
+        cache.flush();
+        uint32_t cluster_misses = 0;
+        for (auto index : indices.subspan(start * 3, (end - start) * 3)) {
+            if (cache.access(index)) cluster_misses++;
+        }
+        const auto cluster_acmr
+          = static_cast<float>(cluster_misses) / static_cast<float>(end - start);
+
+        cache.flush();
+        uint32_t split = start;
+        uint32_t misses = 0;
+        soft_clusters.push_back(start);
+        for (uint32_t triangle = start; triangle < end; triangle++) {
+            for (size_t corner = 0; corner < 3; corner++) {
+                if (cache.access(indices[triangle * 3 + corner])) misses++;
+            }
+            const auto acmr = static_cast<float>(misses) / static_cast<float>(triangle + 1 - split);
+            if (triangle + 1 < end && acmr <= threshold * cluster_acmr) {
+                split = triangle + 1;
+                misses = 0;
+                cache.flush();
+                soft_clusters.push_back(split);
+            }
+        }
+    }
+
+    const auto get_position = [&](uint32_t vertex) {
+        const float* position = positions.data() + vertex * stride;
+        return glm::vec3{position[0], position[1], position[2]};
+    };
+    glm::vec3 mesh_centroid{0.0f};
+    for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        mesh_centroid += get_position(vertex);
+    }
+    mesh_centroid /= static_cast<float>(std::max<size_t>(vertex_count, 1));
+
+    // clusters facing away from the center are drawn first
+    std::vector<float> sort_keys(soft_clusters.size());
+    for (size_t cluster_ix = 0; cluster_ix < soft_clusters.size(); cluster_ix++) {
+        const auto start = soft_clusters[cluster_ix];
+        const auto end = cluster_ix + 1 < soft_clusters.size() ? soft_clusters[cluster_ix + 1]
+                                                               : triangle_count;
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area_sum = 0.0f;
+        for (uint32_t triangle = start; triangle < end; triangle++) {
+            auto a = get_position(indices[triangle * 3]);
+            auto b = get_position(indices[triangle * 3 + 1]);
+            auto c = get_position(indices[triangle * 3 + 2]);
+            // length is twice the triangle's area
+            auto area_normal = glm::cross(b - a, c - a);
+            auto area = glm::length(area_normal);
+            centroid += (a + b + c) * (area / 3.0f);
+            normal += area_normal;
+            area_sum += area;
+        }
+        if (area_sum == 0.0f || glm::length(normal) == 0.0f) continue;
+        sort_keys[cluster_ix]
+          = glm::dot(centroid / area_sum - mesh_centroid, glm::normalize(normal));
+    }
+
+    std::vector<size_t> order(soft_clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t lhs, size_t rhs) { return sort_keys[lhs] > sort_keys[rhs]; });
+
+    std::vector<uint32_t> result{};
+    result.reserve(indices.size());
+    for (auto cluster_ix : order) {
+        const auto start = soft_clusters[cluster_ix];
+        const auto end = cluster_ix + 1 < soft_clusters.size() ? soft_clusters[cluster_ix + 1]
+                                                               : triangle_count;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+size_t optimize_vertex_fetch(std::vector<float>& vertices, size_t stride,
+                             std::span<uint32_t> indices) {
+    constexpr auto unmapped = UINT32_MAX;
+    const size_t vertex_count = vertices.size() / stride;
+    std::vector<uint32_t> remap(vertex_count, unmapped);
+    std::vector<float> result{};
+    result.reserve(vertices.size());
+    uint32_t next_vertex = 0;
+    for (auto& index : indices) {
+        if (remap[index] == unmapped) {
+            remap[index] = next_vertex++;
+            result.insert(result.end(), vertices.begin() + index * stride,
+                          vertices.begin() + (index + 1) * stride);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(result);
+    return next_vertex;
+}
+
+} // namespace pgre::math
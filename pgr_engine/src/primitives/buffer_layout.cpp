@@ -1,5 +1,4 @@
 #include <primitives/buffer_layout.h>
-#include <assets/materials/phong_material.h>
 
 namespace pgre::primitives {
 
@@ -22,6 +21,9 @@ int buffer_element_t::get_size() const  {
         case GL_HALF_FLOAT: return items_per_vertex * 2;
         case GL_FLOAT: return items_per_vertex * 4;
         case GL_DOUBLE: return items_per_vertex * 8;
+        // all components are packed in one 32-bit value
+        case GL_INT_2_10_10_10_REV: return 4;
+        case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
         default: throw std::runtime_error("Buffer element size unknown.");
     }
 }
@@ -34,16 +36,14 @@ void buffer_layout_t::enable_and_point() const {
 }
 
 buffer_layout_t::buffer_layout_t(std::initializer_list<buffer_element_t> elements,
-                                 std::shared_ptr<material_t> material)
-  : buffer_layout_t(std::vector<buffer_element_t>{elements}, std::move(material)) {}
+                                 shader_program_t& shader)
+  : buffer_layout_t(std::vector<buffer_element_t>{elements}, shader) {}
 
 buffer_layout_t::buffer_layout_t(const std::vector<buffer_element_t>& elements,
-                                 std::shared_ptr<material_t> material)
-  : _material(std::move(material)) {
+                                 shader_program_t& shader) {
     int offset = 0;
     unsigned int shader_loc = 0;
     bool shader_pos_not_found = false;
-    auto& shader = _material->get_shader();
     for (const auto& element : elements) {
         try {
             shader_loc = shader.get_attrib_location(std::string(element.glsl_name));
@@ -62,4 +62,18 @@ buffer_layout_t::buffer_layout_t(const std::vector<buffer_element_t>& elements,
     _stride = offset;
 }
 
+buffer_layout_t::buffer_layout_t(const std::vector<buffer_element_t>& elements, GLsizei stride,
+                                 shader_program_t& shader)
+  : _stride(stride) {
+    for (const auto& element : elements) {
+        try {
+            auto shader_loc = shader.get_attrib_location(std::string(element.glsl_name));
+            _elements.push_back(element);
+            _elements.rbegin()->shader_location = shader_loc;
+        } catch (const pgre::shader_attrib_inactive_error& err) {
+            spdlog::warn("{} Vertex attribute won't be active.", err.what());
+        }
+    }
+}
+
 } // namespace pgre::primitives
\ No newline at end of file
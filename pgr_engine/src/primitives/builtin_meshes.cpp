@@ -18,10 +18,10 @@ namespace {
                                          4, 0, 7, 7, 0, 3, 3, 2, 7, 7, 2, 6, 4, 5, 0, 0, 5, 1};
 } // namespace
 
-std::shared_ptr<primitives::vertex_array_t>
-  get_cube_vao(const std::shared_ptr<material_t>& material, bool normals, bool tex_coords) {
-    constexpr auto make_vao = [](auto& material){
-        auto vao = std::make_shared<primitives::vertex_array_t>();
+asset_ref_t<primitives::vertex_array_t>
+  get_cube_vao(shader_program_t& shader, bool normals, bool tex_coords) {
+    constexpr auto make_vao = [](auto& shader){
+        auto vao = asset_table_t<primitives::vertex_array_t>::get().create();
         auto ebo = std::make_shared<primitives::index_buffer_t>();
         auto vbo = std::make_shared<primitives::vertex_buffer_t>();
 
@@ -29,7 +29,7 @@ std::shared_ptr<primitives::vertex_array_t>
         ebo->set_data(sizeof(unsigned int) * 36, reinterpret_cast<const void*>(cube_indices));
         vao->add_vertex_buffer(
           vbo, std::make_shared<primitives::buffer_layout_t>(
-                 std::initializer_list<primitives::buffer_element_t>{{GL_FLOAT, 3, "position"}}, material));
+                 std::initializer_list<primitives::buffer_element_t>{{GL_FLOAT, 3, "position"}}, shader));
         vao->set_index_buffer(ebo);
         return vao;
     };
@@ -37,7 +37,7 @@ std::shared_ptr<primitives::vertex_array_t>
     if (normals || tex_coords)
         throw std::runtime_error("Builtin cube with normals and/or tex_coords not impl yet.");
 
-    return make_vao(material);
+    return make_vao(shader);
 }
 
 }  // namespace pgre::builtin_meshes
\ No newline at end of file
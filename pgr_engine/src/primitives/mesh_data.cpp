@@ -0,0 +1,29 @@
+#include <primitives/mesh_data.h>
+
+namespace pgre::primitives {
+
+asset_ref_t<vertex_array_t> mesh_view_t::upload(shader_program_t& shader) const {
+    auto index_buffer = std::make_shared<index_buffer_t>();
+    index_buffer->set_storage(static_cast<GLsizeiptr>(indices.size_bytes()), indices.data());
+
+    auto vertex_array = asset_table_t<vertex_array_t>::get().create();
+    if (!vertices.empty()) {
+        auto vertex_buffer = std::make_shared<vertex_buffer_t>();
+        vertex_buffer->set_storage(static_cast<GLsizeiptr>(vertices.size_bytes()),
+                                   vertices.data());
+        vertex_array->add_vertex_buffer(vertex_buffer,
+                                        std::make_shared<buffer_layout_t>(elements, shader));
+    }
+    for (const auto& stream : streams) {
+        auto vertex_buffer = std::make_shared<vertex_buffer_t>();
+        vertex_buffer->set_storage(static_cast<GLsizeiptr>(stream.data.size_bytes()),
+                                   stream.data.data());
+        vertex_array->add_vertex_buffer(
+          vertex_buffer, std::make_shared<buffer_layout_t>(stream.elements, stream.stride, shader));
+    }
+    vertex_array->set_index_buffer(index_buffer, index_type);
+    if (position_transform) vertex_array->set_position_transform(*position_transform);
+    return vertex_array;
+}
+
+} // namespace pgre::primitives
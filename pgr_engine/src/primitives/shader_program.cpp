@@ -1,5 +1,7 @@
 #include <primitives/shader_program.h>
+#include <utility/vfs.h>
 #include <fmt/std.h>
+#include <fmt/ranges.h>
 
 namespace pgre {
 shader_attrib_inactive_error::shader_attrib_inactive_error(const std::string& what)
@@ -15,9 +17,9 @@ namespace {
      * @brief Load shader source from input stream (proprietary multi-shader format used)
      * 
      * @param stream the input stream
-     * @return std::map<uint32_t, std::stringstream> map[shader_type_t::*] = shader_source
+     * @return std::map<uint32_t, std::string> map[shader_type_t::*] = shader_source
      */
-    std::map<uint32_t, std::stringstream> load_shader_source_from_stream(std::istream& stream) {
+    std::map<uint32_t, std::string> load_shader_source_from_stream(std::istream& stream) {
         
         std::string line;
         std::map<uint32_t, std::stringstream> shader_streams{};
@@ -45,17 +47,49 @@ namespace {
             }
         }
 
-        return shader_streams;
+        std::map<uint32_t, std::string> retval{};
+        for (auto& [shader_type, src_stream] : shader_streams) {
+            retval[shader_type] = src_stream.str();
+        }
+        return retval;
+    }
+
+    /**
+     * @brief Inserts a #define for each symbol in place of the `shader::defines` marker line, or
+     * after the #version directive if there is no marker (#version must stay the first directive).
+     */
+    std::string inject_defines(const std::string& src, const shader_defines_t& defines) {
+        std::string define_lines;
+        for (const auto& define : defines) {
+            define_lines += fmt::format("#define {}\n", define);
+        }
+
+        constexpr std::string_view marker = "shader::defines";
+        if (auto marker_pos = src.find(marker); marker_pos != std::string::npos) {
+            auto line_start = src.rfind('\n', marker_pos);
+            line_start = line_start == std::string::npos ? 0 : line_start + 1;
+            auto line_end = src.find('\n', marker_pos);
+            line_end = line_end == std::string::npos ? src.size() : line_end + 1;
+            return src.substr(0, line_start) + define_lines + src.substr(line_end);
+        }
+        if (defines.empty()) return src;
+
+        size_t insert_pos = 0;
+        if (auto version_pos = src.find("#version"); version_pos != std::string::npos) {
+            insert_pos = src.find('\n', version_pos);
+            insert_pos = insert_pos == std::string::npos ? src.size() : insert_pos + 1;
+        }
+        return src.substr(0, insert_pos) + define_lines + src.substr(insert_pos);
     }
 } // namespace
 
-bool shader_program_t::compile_shader_program(std::map<uint32_t, std::stringstream>& source_map) const{
+bool shader_program_t::compile_shader_program(const std::map<uint32_t, std::string>& source_map) const{
     int success = 0;
     std::vector<int> compiled_shader_ids; //FIXME: heap bad, vector bad, stack good, array good
     bool shader_compilation_failed = false;
     for (const auto& glID_src : source_map) {
         GLint shader_id = glCreateShader(glID_src.first);
-        auto shader_src_str = glID_src.second.str();
+        auto shader_src_str = inject_defines(glID_src.second, _defines);
         const char* shader_src = shader_src_str.c_str();
         glShaderSource(shader_id, 1, &shader_src, nullptr);
         glCompileShader(shader_id);
@@ -103,12 +137,14 @@ bool shader_program_t::compile_shader_program(std::map<uint32_t, std::stringstre
 }
 
 shader_program_t::shader_program_t(const std::filesystem::path& file_path) : program_id(glCreateProgram()) {
-    std::ifstream shader_file(file_path);
-    if (!shader_file.good()) {
+    auto shader_file = vfs_t::get().open(file_path);
+    if (!shader_file) {
         throw std::runtime_error(fmt::format("Couldn't open shader file \"{}\" for reading.", file_path));
     }
-    auto source_map = load_shader_source_from_stream(shader_file);
-    if (!compile_shader_program(source_map))
+    std::stringstream shader_stream{std::string{
+      reinterpret_cast<const char*>(shader_file->get_data().data()), shader_file->get_size()}};
+    _sources = load_shader_source_from_stream(shader_stream);
+    if (!compile_shader_program(_sources))
         throw ::std::runtime_error(
           fmt::format("Shader program compilation failed. (Shader file: \"{}\")", file_path.string()));
 }
@@ -116,11 +152,38 @@ shader_program_t::shader_program_t(std::stringstream& shader_data) : program_id(
     constexpr size_t max_infolog_len = 1024;
     char infolog[max_infolog_len];
     int success = 0;
-    auto source_map = load_shader_source_from_stream(shader_data);
-    if (!compile_shader_program(source_map))
+    _sources = load_shader_source_from_stream(shader_data);
+    if (!compile_shader_program(_sources))
         throw ::std::runtime_error("Shader program compilation failed. (File not loaded from disk.)");
 }
 
+shader_program_t::shader_program_t(const std::map<uint32_t, std::string>& sources,
+                                   shader_defines_t defines)
+  : _defines(std::move(defines)), program_id(glCreateProgram()) {
+    if (!compile_shader_program(sources))
+        throw ::std::runtime_error(fmt::format(
+          "Shader program variant compilation failed. (Defines: {})", fmt::join(_defines, ", ")));
+}
+
+shader_program_t::~shader_program_t() {
+    if (program_id != 0) glDeleteProgram(program_id);
+}
+
+shader_program_t& shader_program_t::get_variant(const shader_defines_t& defines) {
+    debug_assert(_defines.empty(), "Variants can only be requested from the base shader program.");
+    if (defines.empty()) return *this;
+
+    auto it = _variants.find(defines);
+    if (it == _variants.end()) {
+        spdlog::info("Compiling shader variant ({}).", fmt::join(defines, ", "));
+        it = _variants
+               .emplace(defines, std::unique_ptr<shader_program_t>(
+                                   new shader_program_t(_sources, defines)))
+               .first;
+    }
+    return *it->second;
+}
+
 unsigned int shader_program_t::get_attrib_location(const std::string& glsl_name) const {
     if (auto loc = glGetAttribLocation(program_id, glsl_name.c_str()); loc >=0){
         return loc;
@@ -202,4 +265,14 @@ bool shader_program_t::set_uniform(const std::string& glsl_name, bool x) {
     return true;
 }
 
+bool shader_program_t::set_uniform_block_binding(const std::string& block_name, GLuint binding) {
+    auto block_index = glGetUniformBlockIndex(program_id, block_name.c_str());
+    if (block_index == GL_INVALID_INDEX) {
+        spdlog::warn("Uniform block '{}' not found in shader program.", block_name);
+        return false;
+    }
+    glUniformBlockBinding(program_id, block_index, binding);
+    return true;
+}
+
 } // namespace pgre
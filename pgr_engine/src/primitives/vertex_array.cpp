@@ -3,7 +3,27 @@
 namespace pgre::primitives {
 
 vertex_array_t::vertex_array_t() { glGenVertexArrays(1, &_gl_id); }
-vertex_array_t::~vertex_array_t() { glDeleteVertexArrays(1, &_gl_id); }
+vertex_array_t::~vertex_array_t() {
+    if (_gl_id != 0) glDeleteVertexArrays(1, &_gl_id);
+}
+
+vertex_array_t::vertex_array_t(vertex_array_t&& other) noexcept
+  : _gl_id(std::exchange(other._gl_id, 0)),
+    _vertex_buffers(std::move(other._vertex_buffers)),
+    _index_buffer(std::move(other._index_buffer)),
+    _index_type(other._index_type),
+    _index_count(other._index_count),
+    _position_transform(other._position_transform) {}
+
+vertex_array_t& vertex_array_t::operator=(vertex_array_t&& other) noexcept {
+    std::swap(_gl_id, other._gl_id);
+    std::swap(_vertex_buffers, other._vertex_buffers);
+    std::swap(_index_buffer, other._index_buffer);
+    std::swap(_index_type, other._index_type);
+    std::swap(_index_count, other._index_count);
+    std::swap(_position_transform, other._position_transform);
+    return *this;
+}
 
 void vertex_array_t::bind() const { glBindVertexArray(_gl_id); }
 
@@ -17,11 +37,17 @@ vertex_array_t& vertex_array_t::add_vertex_buffer(const std::shared_ptr<vertex_b
     return *this;
 }
 
-vertex_array_t& vertex_array_t::set_index_buffer(const std::shared_ptr<index_buffer_t>& buffer) {
+vertex_array_t& vertex_array_t::set_index_buffer(const std::shared_ptr<index_buffer_t>& buffer,
+                                                 GLenum index_type) {
     this->bind();
     buffer->bind();
 
     _index_buffer = buffer;
+    _index_type = index_type;
+    size_t index_size = sizeof(GLuint);
+    if (index_type == GL_UNSIGNED_SHORT) index_size = sizeof(GLushort);
+    if (index_type == GL_UNSIGNED_BYTE) index_size = sizeof(GLubyte);
+    _index_count = static_cast<GLsizei>(buffer->get_size() / static_cast<GLsizeiptr>(index_size));
     return *this;
 }
 
@@ -1,9 +1,12 @@
 
-#include <assets/materials/phong_material.h>
-#include <assets/materials/skybox_material.h>
-#include <assets/materials/flat_color_material.h>
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include <assets/materials/all_materials.h>
 #include <renderer/sorting_renderer.h>
 #include <scene/scene.h>
+#include <utility/vfs.h>
 
 namespace pgre {
 
@@ -26,30 +29,118 @@ void sorting_renderer_t::init() {
 }
 
 void sorting_renderer_t::recompile_shaders() {
+    // the sources the materials compile, read as one batch
+    vfs_t::get().prefetch({"resources/shaders/phong.glsl", "resources/shaders/skybox.glsl",
+                           "resources/shaders/flat.glsl"});
     phong_material_t::init();
     skybox_material_t::init();
     flat_color_material_t::init();
 }
 
-void sorting_renderer_t::render(){
-    for (auto& [ix, render_command_vec]: _render_commands){
-        if (!render_command_vec.empty()) render_command_vec[0].material->set_scene_uniforms(*_curr_scene);
-        for (auto& rc: render_command_vec){
-            rc.material->use(*_curr_scene);
-            rc.material->set_matrices(rc.transform, _curr_v_matrix, _curr_p_matrix, _curr_pv_matrix);
+template<typename MaterialTy>
+void sorting_renderer_t::render(std::vector<render_command_t<MaterialTy>>& render_commands) {
+    if (render_commands.empty()) return;
+    auto& materials = asset_table_t<material_variant_t>::get();
+    auto& vertex_arrays = asset_table_t<primitives::vertex_array_t>::get();
+    std::get<MaterialTy>(materials[render_commands[0].material]).set_scene_uniforms(*_curr_scene);
+    constexpr bool instanceable = requires(MaterialTy& m) { m.get_instancing_key(); };
+
+    // opaque commands sharing a material are grouped, so use() only runs on material change,
+    // and visit the materials in table order. Blended ones are drawn after them back to front,
+    // ties keeping submission order.
+    auto transparent = std::ranges::stable_partition(
+      render_commands, [&materials](const render_command_t<MaterialTy>& rc) {
+          return !std::get<MaterialTy>(materials[rc.material]).has_transparency();
+      });
+    const auto opaque = std::ranges::subrange(render_commands.begin(), transparent.begin());
+    if constexpr (instanceable) {
+        for (auto& rc: opaque) {
+            rc.instancing_key = std::get<MaterialTy>(materials[rc.material]).get_instancing_key();
+        }
+    }
+    // instanceable commands go first, grouped by key and vertex array so each group is one
+    // instanced draw
+    std::ranges::stable_sort(opaque, std::less<>{}, [](const render_command_t<MaterialTy>& rc) {
+        constexpr auto not_instanceable = std::numeric_limits<uint64_t>::max();
+        return std::tuple{rc.instancing_key.value_or(not_instanceable),
+                          rc.instancing_key ? rc.vao.get_value() : 0U,
+                          rc.instancing_key ? rc.primitive : 0U, rc.material.get_index()};
+    });
+    // view space z grows towards the camera
+    std::ranges::stable_sort(transparent, std::less<>{},
+                             [this](const render_command_t<MaterialTy>& rc) {
+                                 return (_curr_v_matrix * (*rc.transform)[3]).z;
+                             });
+
+    const auto get_model_matrix = [&vertex_arrays](const render_command_t<MaterialTy>& rc) {
+        const auto& position_transform = vertex_arrays[rc.vao].get_position_transform();
+        return position_transform ? *rc.transform * *position_transform : *rc.transform;
+    };
+    material_handle_t curr_material_handle{};
+    MaterialTy* curr_material = nullptr;
+    for (auto it = render_commands.begin(); it != render_commands.end();) {
+        const auto& vao = vertex_arrays[it->vao];
+        debug_assert(vao.get_index_buffer() != nullptr, "VAO in render command has no index buffer.");
+        if constexpr (instanceable) {
+            // only opaque commands have a key
+            const auto run_end = !it->instancing_key
+                                   ? std::next(it)
+                                   : std::find_if(std::next(it), transparent.begin(),
+                                                  [&it](const render_command_t<MaterialTy>& rc) {
+                                                      return rc.instancing_key != it->instancing_key
+                                                             || rc.vao != it->vao
+                                                             || rc.primitive != it->primitive;
+                                                  });
+            if (std::distance(it, run_end) > 1) {
+                std::vector<typename MaterialTy::instance_t> instances{};
+                instances.reserve(std::distance(it, run_end));
+                for (const auto& rc: std::ranges::subrange(it, run_end)) {
+                    const auto& material = std::get<MaterialTy>(materials[rc.material]);
+                    material.request_texture_detail(rc.screen_size);
+                    instances.push_back({&material, get_model_matrix(rc)});
+                }
+                std::get<MaterialTy>(materials[it->material])
+                  .draw_instanced(vao, it->primitive, instances, _curr_v_matrix, _curr_pv_matrix);
+                // the instanced variant is bound now, the next material has to be used again
+                curr_material_handle = {};
+#ifndef PGRE_DISABLE_DEBUG_CHECKS
+                vao.unbind();
+#endif
+                it = run_end;
+                continue;
+            }
+        }
+
+        if (it->material != curr_material_handle) {
+            curr_material = &std::get<MaterialTy>(materials[it->material]);
+            curr_material->use(*_curr_scene);
+            curr_material_handle = it->material;
+        }
+        if constexpr (requires { curr_material->request_texture_detail(it->screen_size); }) {
+            curr_material->request_texture_detail(it->screen_size);
+        }
+        if constexpr (requires { curr_material->set_vertex_format(vao); }) {
+            curr_material->set_vertex_format(vao);
+        }
+        curr_material->set_matrices(get_model_matrix(*it), _curr_v_matrix, _curr_p_matrix,
+                                    _curr_pv_matrix);
 
-            rc.vao->bind();
-            debug_assert(rc.vao->get_index_buffer() != nullptr, "VAO in render command has no index buffer.");
-            glDrawElements(rc.primitive, rc.vao->get_index_buffer()->get_count(), GL_UNSIGNED_INT,
-                           nullptr);
+        vao.bind();
+        glDrawElements(it->primitive, vao.get_index_count(), vao.get_index_type(), nullptr);
 
 #ifndef PGRE_DISABLE_DEBUG_CHECKS
-            rc.vao->unbind();
+        vao.unbind();
 #endif
-        }
+        ++it;
     }
 }
 
+void sorting_renderer_t::render() {
+    // PGRE_MATERIAL_TYPES is ordered by material_sort_index, so this preserves render order
+    std::apply([this](auto&... render_commands) { (render(render_commands), ...); },
+               _render_commands);
+}
+
 void sorting_renderer_t::begin_scene(scene::scene_t& scene) {
     _curr_scene = &scene;
     auto [camera, camera_view] = scene.get_active_camera();
@@ -62,16 +153,28 @@ void sorting_renderer_t::begin_scene(scene::scene_t& scene) {
 
 void sorting_renderer_t::end_scene() {
     render();
-    for (auto& [ix, rc_queue] : _render_commands){
-        rc_queue.clear();
-    }
+    std::apply([](auto&... render_commands) { (render_commands.clear(), ...); },
+               _render_commands);
 }
 
 void sorting_renderer_t::submit(const glm::mat4& transform,
-                                std::shared_ptr<primitives::vertex_array_t> vao,
-                                std::shared_ptr<material_t> material, GLenum primitive) {
-    _render_commands[material->get_material_sort_index()].emplace_back(
-      transform, std::move(vao), std::move(material), primitive);
+                                asset_handle_t<primitives::vertex_array_t> vao,
+                                material_handle_t material, GLenum primitive, float screen_size) {
+    // material_variant_t holds PGRE_MATERIAL_TYPES, so every alternative has a command list
+    std::visit(
+      [&](auto& concrete_material) {
+          using material_type = std::remove_cvref_t<decltype(concrete_material)>;
+          std::get<std::vector<render_command_t<material_type>>>(_render_commands)
+            .emplace_back(&transform, vao, material, primitive, screen_size);
+      },
+      asset_table_t<material_variant_t>::get()[material]);
+}
+
+void renderer::submit(const glm::mat4& transform, asset_handle_t<primitives::vertex_array_t> vao,
+                      material_handle_t material, GLenum primitive, float screen_size) {
+    // sorting_renderer_t is final, so this call doesn't go through the vtable
+    static_cast<sorting_renderer_t&>(*_instance).submit(transform, vao, material, primitive,
+                                                        screen_size);
 }
 
 } // namespace pgre
@@ -0,0 +1,758 @@
+#include <scene/gltf_import.h>
+#include <utility/vfs.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+// rapidjson, as bundled with cereal, set up to throw instead of asserting
+#include <cereal/archives/json.hpp>
+#include <fmt/format.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <spdlog/spdlog.h>
+
+namespace pgre::scene {
+
+namespace {
+    namespace json = CEREAL_RAPIDJSON_NAMESPACE;
+
+    constexpr uint32_t glb_magic = 0x46546C67;      // "glTF"
+    constexpr uint32_t glb_json_chunk = 0x4E4F534A; // "JSON"
+    constexpr uint32_t glb_bin_chunk = 0x004E4942;  // "BIN\0"
+    constexpr uint32_t gltf_triangles = 4;
+
+    [[noreturn]] void throw_invalid(std::string_view what) {
+        throw std::runtime_error(fmt::format("Invalid glTF: {}", what));
+    }
+
+    const json::Value* find_member(const json::Value& object, const char* name) {
+        if (!object.IsObject()) return nullptr;
+        auto it = object.FindMember(name);
+        return it == object.MemberEnd() ? nullptr : &it->value;
+    }
+
+    uint32_t get_uint(const json::Value& object, const char* name, uint32_t fallback) {
+        const auto* value = find_member(object, name);
+        return value && value->IsUint() ? value->GetUint() : fallback;
+    }
+
+    float get_float(const json::Value& object, const char* name, float fallback) {
+        const auto* value = find_member(object, name);
+        return value && value->IsNumber() ? value->GetFloat() : fallback;
+    }
+
+    /**
+     * @brief Reads an array of numbers of at least size elements into a float array.
+     */
+    template<size_t size>
+    std::array<float, size> get_floats(const json::Value& object, const char* name,
+                                       std::array<float, size> fallback) {
+        const auto* value = find_member(object, name);
+        if (!value || !value->IsArray() || value->Size() < size) return fallback;
+        for (json::SizeType i = 0; i < size; i++) fallback[i] = (*value)[i].GetFloat();
+        return fallback;
+    }
+
+    /**
+     * @brief Get the element at ix of the top level array name.
+     */
+    const json::Value& get_object(const json::Value& root, const char* name, uint32_t ix) {
+        const auto* array = find_member(root, name);
+        if (!array || !array->IsArray() || ix >= array->Size())
+            throw_invalid(fmt::format("{} {} doesn't exist", name, ix));
+        return (*array)[ix];
+    }
+
+    /**
+     * @brief Decodes percent-encoded characters of a relative URI. Malformed escapes are kept
+     * as they are.
+     */
+    std::string decode_uri(std::string_view uri) {
+        const auto hex_value = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+        std::string decoded{};
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); i++) {
+            if (uri[i] == '%' && uri.size() - i > 2) {
+                const auto high = hex_value(uri[i + 1]);
+                const auto low = hex_value(uri[i + 2]);
+                if (high >= 0 && low >= 0) {
+                    decoded.push_back(static_cast<char>(high * 16 + low));
+                    i += 2;
+                    continue;
+                }
+            }
+            decoded.push_back(uri[i]);
+        }
+        return decoded;
+    }
+
+    std::vector<uint8_t> decode_base64(std::string_view encoded) {
+        const auto decode_char = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+        std::vector<uint8_t> decoded{};
+        decoded.reserve(encoded.size() / 4 * 3);
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (auto c : encoded) {
+            if (c == '=') break;
+            const auto value = decode_char(c);
+            if (value < 0) throw_invalid("malformed base64 data URI");
+            bits = (bits << 6U) | static_cast<uint32_t>(value);
+            bit_count += 6;
+            if (bit_count >= 8) {
+                bit_count -= 8;
+                decoded.push_back(static_cast<uint8_t>(bits >> static_cast<uint32_t>(bit_count)));
+            }
+        }
+        return decoded;
+    }
+
+    /**
+     * @brief Decodes a base64 data URI, the only kind glTF allows.
+     */
+    std::vector<uint8_t> decode_data_uri(std::string_view uri) {
+        const auto data_start = uri.find(";base64,");
+        if (data_start == std::string_view::npos)
+            throw_invalid("only base64 data URIs are supported");
+        return decode_base64(uri.substr(data_start + 8));
+    }
+
+    uint32_t get_component_size(GLenum component_type) {
+        switch (component_type) {
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT: return 2;
+            case GL_UNSIGNED_INT:
+            case GL_FLOAT: return 4;
+            default: throw_invalid(fmt::format("unknown component type {}", component_type));
+        }
+    }
+
+    uint32_t get_component_count(std::string_view type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        throw_invalid(fmt::format("accessor type {} can't be a vertex attribute", type));
+    }
+
+    /**
+     * @brief Reads a component as a float, normalized integers are mapped to [0, 1] or [-1, 1].
+     */
+    float read_component(const uint8_t* data, GLenum component_type, bool normalized) {
+        const auto read = [data]<typename T>(T) {
+            T value{};
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        };
+        switch (component_type) {
+            case GL_FLOAT: return read(float{});
+            case GL_UNSIGNED_BYTE: {
+                auto value = static_cast<float>(read(uint8_t{}));
+                return normalized ? value / 255.0f : value;
+            }
+            case GL_UNSIGNED_SHORT: {
+                auto value = static_cast<float>(read(uint16_t{}));
+                return normalized ? value / 65535.0f : value;
+            }
+            case GL_BYTE: {
+                auto value = static_cast<float>(read(int8_t{}));
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case GL_SHORT: {
+                auto value = static_cast<float>(read(int16_t{}));
+                return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            default: return static_cast<float>(read(uint32_t{}));
+        }
+    }
+
+    /**
+     * @brief A glTF accessor, resolved to the bytes of its buffer view.
+     */
+    struct accessor_t
+    {
+        /**
+         * @brief The whole buffer view.
+         */
+        std::span<const uint8_t> view{};
+        uint32_t view_ix = 0;
+        /**
+         * @brief Whether the buffer view has a byteStride, it may then be interleaved.
+         */
+        bool strided_view = false;
+        uint32_t offset = 0;
+        uint32_t stride = 0;
+        uint32_t count = 0;
+        GLenum component_type = GL_FLOAT;
+        uint32_t component_count = 1;
+        bool normalized = false;
+        const json::Value* object = nullptr;
+
+        [[nodiscard]] uint32_t get_element_size() const {
+            return get_component_size(component_type) * component_count;
+        }
+
+        /**
+         * @brief Get the element at ix.
+         */
+        [[nodiscard]] const uint8_t* get(uint32_t ix) const {
+            return view.data() + offset + static_cast<size_t>(ix) * stride;
+        }
+    };
+
+    /**
+     * @brief A parsed glTF file with its buffers, which live in the imported scene.
+     */
+    struct gltf_file_t
+    {
+        json::Document document{};
+        std::vector<std::span<const uint8_t>> buffers{};
+
+        [[nodiscard]] std::span<const uint8_t> get_buffer_view(uint32_t view_ix) const {
+            const auto& view_json = get_object(document, "bufferViews", view_ix);
+            const auto buffer_ix = get_uint(view_json, "buffer", UINT32_MAX);
+            if (buffer_ix >= buffers.size()) throw_invalid("buffer view without a buffer");
+            const auto view_offset = get_uint(view_json, "byteOffset", 0);
+            const auto view_length = get_uint(view_json, "byteLength", 0);
+            if (static_cast<size_t>(view_offset) + view_length > buffers[buffer_ix].size())
+                throw_invalid(fmt::format("buffer view {} exceeds its buffer", view_ix));
+            return buffers[buffer_ix].subspan(view_offset, view_length);
+        }
+
+        [[nodiscard]] accessor_t get_accessor(uint32_t accessor_ix) const {
+            const auto& accessor_json = get_object(document, "accessors", accessor_ix);
+            if (find_member(accessor_json, "sparse"))
+                throw std::runtime_error("sparse accessors aren't supported");
+            const auto view_ix = get_uint(accessor_json, "bufferView", UINT32_MAX);
+            if (view_ix == UINT32_MAX)
+                throw std::runtime_error("accessors without a buffer view aren't supported");
+            const auto& view_json = get_object(document, "bufferViews", view_ix);
+
+            const auto* type = find_member(accessor_json, "type");
+            if (!type || !type->IsString()) throw_invalid("accessor without a type");
+            accessor_t accessor{};
+            accessor.view = get_buffer_view(view_ix);
+            accessor.view_ix = view_ix;
+            accessor.offset = get_uint(accessor_json, "byteOffset", 0);
+            accessor.count = get_uint(accessor_json, "count", 0);
+            accessor.component_type = get_uint(accessor_json, "componentType", 0);
+            accessor.component_count = get_component_count(type->GetString());
+            const auto* normalized = find_member(accessor_json, "normalized");
+            accessor.normalized = normalized && normalized->IsTrue();
+            accessor.strided_view = find_member(view_json, "byteStride") != nullptr;
+            accessor.stride = get_uint(view_json, "byteStride", accessor.get_element_size());
+            accessor.object = &accessor_json;
+            if (accessor.count > 0
+                && accessor.offset + static_cast<size_t>(accessor.count - 1) * accessor.stride
+                       + accessor.get_element_size()
+                     > accessor.view.size())
+                throw_invalid(fmt::format("accessor {} exceeds its buffer view", accessor_ix));
+            return accessor;
+        }
+    };
+
+    /**
+     * @brief Maps or decodes the buffers into the imported scene.
+     *
+     * @param glb_bin the BIN chunk of a .glb file, used by a buffer without an uri
+     */
+    void load_buffers(gltf_file_t& file, const std::filesystem::path& source_dir,
+                      std::span<const uint8_t> glb_bin, imported_scene_t& scene) {
+        const auto* buffers = find_member(file.document, "buffers");
+        if (!buffers || !buffers->IsArray()) return;
+        for (const auto& buffer : buffers->GetArray()) {
+            const auto byte_length = get_uint(buffer, "byteLength", 0);
+            std::span<const uint8_t> data{};
+            const auto* uri = find_member(buffer, "uri");
+            if (!uri) {
+                data = glb_bin;
+            } else if (std::string_view uri_str = uri->GetString(); uri_str.starts_with("data:")) {
+                data = scene.add_buffer(decode_data_uri(uri_str));
+            } else {
+                const auto buffer_path = source_dir / decode_uri(uri_str);
+                auto buffer_file = vfs_t::get().open(buffer_path);
+                if (!buffer_file) {
+                    throw std::runtime_error(
+                      fmt::format("Failed to map glTF buffer {}", buffer_path.string()));
+                }
+                auto mapped = scene.add_file(std::move(*buffer_file));
+                data = {reinterpret_cast<const uint8_t*>(mapped.data()), mapped.size()};
+            }
+            if (data.size() < byte_length) throw_invalid("buffer shorter than its byteLength");
+            file.buffers.push_back(data.first(byte_length));
+        }
+    }
+
+    /**
+     * @brief Adds the images stored in buffer views or data URIs to the scene's embedded
+     * textures, buffer views are used in place.
+     *
+     * @return std::vector<std::optional<uint32_t>> index in imported_scene_t::embedded_textures
+     * of each image, nullopt for external images.
+     */
+    std::vector<std::optional<uint32_t>> load_embedded_images(const gltf_file_t& file,
+                                                              imported_scene_t& scene) {
+        std::vector<std::optional<uint32_t>> image_textures{};
+        const auto* images = find_member(file.document, "images");
+        if (!images || !images->IsArray()) return image_textures;
+        for (const auto& image : images->GetArray()) {
+            auto& texture_ix = image_textures.emplace_back();
+            std::span<const uint8_t> data{};
+            if (const auto* view_ix = find_member(image, "bufferView")) {
+                data = file.get_buffer_view(view_ix->GetUint());
+            } else if (const auto* uri = find_member(image, "uri");
+                       uri && std::string_view{uri->GetString()}.starts_with("data:")) {
+                data = scene.add_buffer(decode_data_uri(uri->GetString()));
+            } else {
+                continue;
+            }
+            texture_ix = static_cast<uint32_t>(scene.embedded_textures.size());
+            scene.embedded_textures.push_back({data});
+        }
+        return image_textures;
+    }
+
+    /**
+     * @brief Texture coordinates converted to floats with v flipped, textures are loaded bottom
+     * row first while glTF's v points down.
+     */
+    primitives::vertex_stream_view_t convert_tex_coords(const accessor_t& accessor,
+                                                        imported_scene_t& scene) {
+        if (accessor.component_count != 2) throw_invalid("TEXCOORD_0 must be VEC2");
+        const auto component_size = get_component_size(accessor.component_type);
+        std::vector<uint8_t> data(static_cast<size_t>(accessor.count) * 2 * sizeof(float));
+        for (uint32_t vertex_ix = 0; vertex_ix < accessor.count; vertex_ix++) {
+            const auto* element = accessor.get(vertex_ix);
+            std::array<float, 2> uv{
+              read_component(element, accessor.component_type, accessor.normalized),
+              1.0f
+                - read_component(element + component_size, accessor.component_type,
+                                 accessor.normalized)};
+            std::memcpy(data.data() + vertex_ix * sizeof(uv), uv.data(), sizeof(uv));
+        }
+        return {scene.add_buffer(std::move(data)), {{GL_FLOAT, 2, "tex_coord"}},
+                static_cast<GLsizei>(2 * sizeof(float))};
+    }
+
+    /**
+     * @brief Groups the attributes into vertex streams, one per interleaved buffer view, or per
+     * attribute otherwise, each viewing only the used part of the buffer view.
+     */
+    using attribute_t = std::pair<primitives::buffer_element_t, accessor_t>;
+    std::vector<primitives::vertex_stream_view_t>
+      make_streams(const std::vector<attribute_t>& attributes) {
+        struct pending_stream_t
+        {
+            std::optional<uint32_t> view_ix;
+            std::vector<attribute_t> attributes;
+        };
+        std::vector<pending_stream_t> pending{};
+        for (const auto& attribute : attributes) {
+            const auto& accessor = attribute.second;
+            auto stream = std::ranges::find_if(pending, [&](const auto& stream) {
+                return accessor.strided_view && stream.view_ix == accessor.view_ix;
+            });
+            if (stream == pending.end()) {
+                pending.push_back(
+                  {accessor.strided_view ? std::optional{accessor.view_ix} : std::nullopt, {}});
+                stream = std::prev(pending.end());
+            }
+            stream->attributes.push_back(attribute);
+        }
+
+        std::vector<primitives::vertex_stream_view_t> streams{};
+        for (auto& stream : pending) {
+            const auto& first_accessor = stream.attributes.front().second;
+            size_t start = SIZE_MAX;
+            size_t end = 0;
+            for (const auto& [element, accessor] : stream.attributes) {
+                start = std::min<size_t>(start, accessor.offset);
+                end = std::max<size_t>(end, accessor.offset
+                                              + static_cast<size_t>(accessor.count - 1)
+                                                  * accessor.stride
+                                              + accessor.get_element_size());
+            }
+            auto& view = streams.emplace_back();
+            view.data = first_accessor.view.subspan(start, end - start);
+            view.stride = static_cast<GLsizei>(first_accessor.stride);
+            for (auto [element, accessor] : stream.attributes) {
+                element.start_offset_bytes = accessor.offset - start;
+                view.elements.push_back(element);
+            }
+        }
+        return streams;
+    }
+
+    uint32_t get_max_index(std::span<const uint8_t> indices, GLenum index_type) {
+        const auto max_of = [indices]<typename IndexTy>(IndexTy /*type*/) {
+            uint32_t max_index = 0;
+            for (size_t offset = 0; offset + sizeof(IndexTy) <= indices.size();
+                 offset += sizeof(IndexTy)) {
+                IndexTy index{};
+                std::memcpy(&index, indices.data() + offset, sizeof(IndexTy));
+                max_index = std::max<uint32_t>(max_index, index);
+            }
+            return max_index;
+        };
+        switch (index_type) {
+            case GL_UNSIGNED_BYTE: return max_of(GLubyte{});
+            case GL_UNSIGNED_SHORT: return max_of(GLushort{});
+            default: return max_of(GLuint{});
+        }
+    }
+
+    /**
+     * @param default_material_ix material of primitives without one, one past the file's
+     */
+    primitives::mesh_view_t convert_primitive(const gltf_file_t& file,
+                                              const json::Value& primitive,
+                                              uint32_t default_material_ix,
+                                              imported_scene_t& scene) {
+        if (get_uint(primitive, "mode", gltf_triangles) != gltf_triangles)
+            throw std::runtime_error("only triangle primitives are supported");
+        const auto* attributes = find_member(primitive, "attributes");
+        if (!attributes || !find_member(*attributes, "POSITION"))
+            throw_invalid("primitive without positions");
+
+        primitives::mesh_view_t mesh{};
+        mesh.material_ix = default_material_ix;
+        if (const auto* material = find_member(primitive, "material")) {
+            if (!material->IsUint() || material->GetUint() >= default_material_ix)
+                throw_invalid("material doesn't exist");
+            mesh.material_ix = material->GetUint();
+        }
+
+        const auto positions = file.get_accessor(get_uint(*attributes, "POSITION", 0));
+        const auto vertex_count = positions.count;
+        const auto aabb_min = get_floats<3>(*positions.object, "min", {0.0f, 0.0f, 0.0f});
+        const auto aabb_max = get_floats<3>(*positions.object, "max", {0.0f, 0.0f, 0.0f});
+        mesh.aabb = {glm::make_vec3(aabb_min.data()), glm::make_vec3(aabb_max.data())};
+
+        std::vector<attribute_t> uploaded{};
+        const auto add_attribute = [&](const accessor_t& accessor, std::string_view name) {
+            if (accessor.count != vertex_count)
+                throw_invalid("attributes of a primitive differ in count");
+            uploaded.emplace_back(primitives::buffer_element_t{accessor.component_type,
+                                                               accessor.component_count, name,
+                                                               accessor.normalized},
+                                  accessor);
+        };
+        add_attribute(positions, "position");
+        if (const auto* normal = find_member(*attributes, "NORMAL")) {
+            add_attribute(file.get_accessor(normal->GetUint()), "normal");
+        } else {
+            spdlog::warn("Import: glTF primitive without normals, it won't be lit correctly.");
+        }
+        mesh.streams = make_streams(uploaded);
+        if (const auto* tex_coords = find_member(*attributes, "TEXCOORD_0")) {
+            const auto accessor = file.get_accessor(tex_coords->GetUint());
+            if (accessor.count != vertex_count)
+                throw_invalid("attributes of a primitive differ in count");
+            mesh.streams.push_back(convert_tex_coords(accessor, scene));
+        }
+
+        if (const auto* indices_json = find_member(primitive, "indices")) {
+            const auto indices = file.get_accessor(indices_json->GetUint());
+            if (indices.component_count != 1
+                || (indices.component_type != GL_UNSIGNED_BYTE
+                    && indices.component_type != GL_UNSIGNED_SHORT
+                    && indices.component_type != GL_UNSIGNED_INT))
+                throw_invalid("indices must be unsigned scalars");
+            if (indices.stride != indices.get_element_size())
+                throw_invalid("indices must be tightly packed");
+            mesh.indices = indices.view.subspan(
+              indices.offset, static_cast<size_t>(indices.count) * indices.stride);
+            mesh.index_type = indices.component_type;
+            // the accessor's max is optional and not verified, so the indices are scanned
+            if (indices.count > 0 && get_max_index(mesh.indices, mesh.index_type) >= vertex_count)
+                throw_invalid("index exceeds the vertex count");
+        } else {
+            std::vector<uint8_t> indices(static_cast<size_t>(vertex_count) * sizeof(GLuint));
+            for (GLuint i = 0; i < vertex_count; i++) {
+                std::memcpy(indices.data() + i * sizeof(GLuint), &i, sizeof(GLuint));
+            }
+            mesh.indices = scene.add_buffer(std::move(indices));
+            mesh.index_type = GL_UNSIGNED_INT;
+        }
+        return mesh;
+    }
+
+    /**
+     * @param image_textures see load_embedded_images
+     */
+    imported_material_t
+      convert_material(const json::Value& document, const json::Value& material,
+                       const std::filesystem::path& source_dir,
+                       const std::vector<std::optional<uint32_t>>& image_textures) {
+        imported_material_t imported{};
+        const auto* pbr = find_member(material, "pbrMetallicRoughness");
+        const auto base_color = pbr ? get_floats<4>(*pbr, "baseColorFactor", {1, 1, 1, 1})
+                                    : std::array<float, 4>{1, 1, 1, 1};
+        const auto metallic = pbr ? get_float(*pbr, "metallicFactor", 1.0f) : 1.0f;
+        const auto roughness = pbr ? get_float(*pbr, "roughnessFactor", 1.0f) : 1.0f;
+
+        // rough phong equivalents of the metallic-roughness parameters
+        imported.diffuse = glm::make_vec3(base_color.data());
+        imported.ambient = imported.diffuse;
+        imported.specular = glm::mix(glm::vec3{0.04f}, imported.diffuse, metallic);
+        imported.shininess = std::max(2.0f / std::max(std::pow(roughness, 4.0f), 1e-4f) - 2.0f,
+                                      1.0f);
+        if (const auto* alpha_mode = find_member(material, "alphaMode");
+            alpha_mode && std::string_view{alpha_mode->GetString()} == "BLEND")
+            imported.transparency = 1.0f - base_color[3];
+
+        const auto* texture_info = pbr ? find_member(*pbr, "baseColorTexture") : nullptr;
+        if (!texture_info) return imported;
+        if (get_uint(*texture_info, "texCoord", 0) != 0)
+            spdlog::warn("Import: only TEXCOORD_0 is supported, texture won't map correctly.");
+        const auto& texture
+          = get_object(document, "textures", get_uint(*texture_info, "index", 0));
+        const auto image_ix = get_uint(texture, "source", 0);
+        const auto& image = get_object(document, "images", image_ix);
+        if (image_textures[image_ix]) {
+            imported.embedded_texture_ix = image_textures[image_ix];
+        } else if (const auto* uri = find_member(image, "uri")) {
+            imported.color_texture_path = source_dir / decode_uri(uri->GetString());
+        }
+        return imported;
+    }
+
+    imported_light_t convert_light(const json::Value& light, std::string node_name) {
+        imported_light_t imported{};
+        imported.node_name = std::move(node_name);
+        // intensities are photometric, they don't translate to phong colors
+        imported.diffuse = glm::make_vec3(get_floats<3>(light, "color", {1, 1, 1}).data());
+        imported.specular = imported.diffuse;
+        // lights point down their node's -z
+        imported.direction = {0.0f, 0.0f, -1.0f};
+        imported.attenuation = {1.0f, 0.0f, 1.0f};
+
+        const auto* type = find_member(light, "type");
+        std::string_view type_str = type && type->IsString() ? type->GetString() : "";
+        if (type_str == "directional") {
+            imported.type = imported_light_t::type_t::sun;
+        } else if (type_str == "point") {
+            imported.type = imported_light_t::type_t::point;
+        } else if (type_str == "spot") {
+            imported.type = imported_light_t::type_t::spot;
+            const auto* spot = find_member(light, "spot");
+            imported.outer_cone_angle
+              = spot ? get_float(*spot, "outerConeAngle", glm::quarter_pi<float>())
+                     : glm::quarter_pi<float>();
+            imported.inner_cone_angle = spot ? get_float(*spot, "innerConeAngle", 0.0f) : 0.0f;
+            // the spot light component divides by the inner angle
+            if (imported.inner_cone_angle <= 0.0f)
+                imported.inner_cone_angle = imported.outer_cone_angle;
+        } else {
+            throw_invalid(fmt::format("unknown light type {}", type_str));
+        }
+        return imported;
+    }
+
+    glm::mat4 get_node_transform(const json::Value& node) {
+        if (find_member(node, "matrix")) {
+            return glm::make_mat4(get_floats<16>(node, "matrix", {}).data());
+        }
+        const auto translation = get_floats<3>(node, "translation", {0, 0, 0});
+        const auto rotation = get_floats<4>(node, "rotation", {0, 0, 0, 1});
+        const auto scale = get_floats<3>(node, "scale", {1, 1, 1});
+        return glm::translate(glm::mat4{1.0f}, glm::make_vec3(translation.data()))
+               * glm::mat4_cast(glm::quat{rotation[3], rotation[0], rotation[1], rotation[2]})
+               * glm::scale(glm::mat4{1.0f}, glm::make_vec3(scale.data()));
+    }
+
+    /**
+     * @brief State of flattening the node hierarchy.
+     */
+    struct node_importer_t
+    {
+        const json::Value& document;
+        const std::vector<std::vector<uint32_t>>& mesh_primitives;
+        imported_scene_t& scene;
+        std::vector<bool> visited{};
+
+        void import_node(uint32_t gltf_node_ix, uint32_t parent_ix) {
+            const auto& node_json = get_object(document, "nodes", gltf_node_ix);
+            // the hierarchy must be a forest, guard against cycles
+            if (visited[gltf_node_ix]) throw_invalid("node hierarchy isn't a tree");
+            visited[gltf_node_ix] = true;
+
+            auto& node = scene.nodes.emplace_back();
+            const auto* name = find_member(node_json, "name");
+            node.name = name && name->IsString() ? std::string{name->GetString()}
+                                                  : fmt::format("node_{}", gltf_node_ix);
+            node.transform = get_node_transform(node_json);
+            node.parent_ix = parent_ix;
+            if (auto mesh_ix = get_uint(node_json, "mesh", UINT32_MAX); mesh_ix != UINT32_MAX) {
+                if (mesh_ix >= mesh_primitives.size()) throw_invalid("mesh doesn't exist");
+                node.mesh_indices = mesh_primitives[mesh_ix];
+            }
+            if (const auto* light = find_member(node_json, "extensions")) {
+                if (const auto* punctual = find_member(*light, "KHR_lights_punctual")) {
+                    const auto* extensions = find_member(document, "extensions");
+                    const auto* file_punctual
+                      = extensions ? find_member(*extensions, "KHR_lights_punctual") : nullptr;
+                    const auto* lights
+                      = file_punctual ? find_member(*file_punctual, "lights") : nullptr;
+                    const auto light_ix = get_uint(*punctual, "light", UINT32_MAX);
+                    if (!lights || !lights->IsArray() || light_ix >= lights->Size())
+                        throw_invalid("light doesn't exist");
+                    scene.lights.push_back(convert_light((*lights)[light_ix], node.name));
+                }
+            }
+
+            const auto node_ix = static_cast<uint32_t>(scene.nodes.size() - 1);
+            if (const auto* children = find_member(node_json, "children")) {
+                for (const auto& child : children->GetArray()) {
+                    import_node(child.GetUint(), node_ix);
+                }
+            }
+        }
+    };
+} // namespace
+
+bool is_gltf(const std::filesystem::path& path) {
+    auto extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+    return extension == ".gltf" || extension == ".glb";
+}
+
+imported_scene_t import_gltf(const std::filesystem::path& path) {
+    auto mapping = vfs_t::get().open(path);
+    if (!mapping) throw std::runtime_error(fmt::format("Failed to open {}", path.string()));
+
+    imported_scene_t scene{};
+    gltf_file_t file{};
+    const auto source_dir = std::filesystem::absolute(path.parent_path());
+    const auto data = mapping->get_data();
+    std::span<const uint8_t> glb_bin{};
+    std::array<uint32_t, 3> header{};
+    if (data.size() >= sizeof(header)) std::memcpy(header.data(), data.data(), sizeof(header));
+    if (header[0] == glb_magic) {
+        if (header[1] != 2) throw_invalid(fmt::format("unsupported GLB version {}", header[1]));
+        // chunks follow the 12 byte header, each with an 8 byte header of its own
+        size_t offset = sizeof(header);
+        std::span<const std::byte> json_chunk{};
+        while (offset + 8 <= std::min<size_t>(header[2], data.size())) {
+            std::array<uint32_t, 2> chunk_header{};
+            std::memcpy(chunk_header.data(), data.data() + offset, sizeof(chunk_header));
+            offset += sizeof(chunk_header);
+            if (chunk_header[0] > data.size() - offset) throw_invalid("truncated GLB chunk");
+            const auto chunk = data.subspan(offset, chunk_header[0]);
+            if (chunk_header[1] == glb_json_chunk && json_chunk.empty()) json_chunk = chunk;
+            if (chunk_header[1] == glb_bin_chunk && glb_bin.empty())
+                glb_bin = {reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size()};
+            // chunks are 4 byte aligned
+            offset += (chunk_header[0] + 3U) & ~3U;
+        }
+        file.document.Parse(reinterpret_cast<const char*>(json_chunk.data()), json_chunk.size());
+    } else {
+        file.document.Parse(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    if (file.document.HasParseError() || !file.document.IsObject())
+        throw_invalid(
+          fmt::format("JSON parse error at offset {}", file.document.GetErrorOffset()));
+    if (const auto* asset = find_member(file.document, "asset")) {
+        const auto* version = find_member(*asset, "version");
+        if (version && version->IsString()
+            && !std::string_view{version->GetString()}.starts_with("2"))
+            throw_invalid(fmt::format("unsupported version {}", version->GetString()));
+    }
+    // the BIN chunk is uploaded from the mapping
+    if (!glb_bin.empty()) scene.add_file(std::move(*mapping));
+    load_buffers(file, source_dir, glb_bin, scene);
+    const auto image_textures = load_embedded_images(file, scene);
+
+    if (const auto* materials = find_member(file.document, "materials")) {
+        for (const auto& material : materials->GetArray()) {
+            scene.materials.push_back(
+              convert_material(file.document, material, source_dir, image_textures));
+        }
+    }
+    // for primitives without a material, added at the end if any uses it
+    const auto default_material_ix = static_cast<uint32_t>(scene.materials.size());
+
+    std::vector<std::vector<uint32_t>> mesh_primitives{};
+    size_t skipped_count = 0;
+    if (const auto* meshes = find_member(file.document, "meshes")) {
+        for (const auto& mesh : meshes->GetArray()) {
+            auto& primitive_indices = mesh_primitives.emplace_back();
+            const auto* primitives = find_member(mesh, "primitives");
+            if (!primitives) continue;
+            for (const auto& primitive : primitives->GetArray()) {
+                try {
+                    scene.meshes.push_back(
+                      convert_primitive(file, primitive, default_material_ix, scene));
+                    primitive_indices.push_back(static_cast<uint32_t>(scene.meshes.size() - 1));
+                } catch (const std::runtime_error& e) {
+                    spdlog::warn("Import: skipping glTF primitive: {}", e.what());
+                    skipped_count++;
+                }
+            }
+        }
+    }
+    if (std::ranges::any_of(scene.meshes, [default_material_ix](const auto& mesh) {
+            return mesh.material_ix == default_material_ix;
+        }))
+        scene.materials.emplace_back();
+    scene.geometry_sources.resize(scene.meshes.size());
+    std::iota(scene.geometry_sources.begin(), scene.geometry_sources.end(), 0);
+
+    // a root above the scene's nodes, like assimp's
+    auto& root = scene.nodes.emplace_back();
+    root.name = path.stem().string();
+    node_importer_t node_importer{file.document, mesh_primitives, scene};
+    const auto* nodes = find_member(file.document, "nodes");
+    node_importer.visited.resize(nodes && nodes->IsArray() ? nodes->Size() : 0, false);
+    const auto* scenes = find_member(file.document, "scenes");
+    if (scenes && scenes->IsArray() && scenes->Size() > 0) {
+        const auto& gltf_scene = get_object(file.document, "scenes",
+                                            get_uint(file.document, "scene", 0));
+        if (const auto* root_nodes = find_member(gltf_scene, "nodes")) {
+            for (const auto& node : root_nodes->GetArray()) {
+                node_importer.import_node(node.GetUint(), 0);
+            }
+        }
+    } else {
+        // without scenes, every node that isn't a child is a root
+        std::vector<bool> is_child(node_importer.visited.size(), false);
+        for (json::SizeType node_ix = 0; node_ix < is_child.size(); node_ix++) {
+            if (const auto* children = find_member((*nodes)[node_ix], "children")) {
+                for (const auto& child : children->GetArray()) {
+                    if (child.GetUint() < is_child.size()) is_child[child.GetUint()] = true;
+                }
+            }
+        }
+        for (uint32_t node_ix = 0; node_ix < is_child.size(); node_ix++) {
+            if (!is_child[node_ix]) node_importer.import_node(node_ix, 0);
+        }
+    }
+
+    spdlog::info("Import: read glTF {} with {} primitives, {} skipped.", path.string(),
+                 scene.meshes.size(), skipped_count);
+    return scene;
+}
+
+} // namespace pgre::scene
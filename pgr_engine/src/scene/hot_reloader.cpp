@@ -0,0 +1,169 @@
+#include <assets/asset_registry.h>
+#include <scene/hot_reloader.h>
+
+#include <algorithm>
+#include <set>
+
+#include <spdlog/spdlog.h>
+
+namespace pgre::scene {
+
+namespace {
+    std::filesystem::path get_watched_path(const std::filesystem::path& path) {
+        std::error_code err{};
+        auto canonical = std::filesystem::weakly_canonical(path, err);
+        return err ? std::filesystem::absolute(path).lexically_normal() : canonical;
+    }
+} // namespace
+
+hot_reloader_t& hot_reloader_t::get() {
+    static hot_reloader_t reloader{};
+    return reloader;
+}
+
+bool hot_reloader_t::watch(const std::filesystem::path& directory) {
+    if (!file_watcher_t::is_supported()) {
+        spdlog::warn("Hot reloading isn't supported on this platform.");
+        return false;
+    }
+    if (!_watcher) _watcher = std::make_unique<file_watcher_t>();
+    try {
+        _watcher->watch(directory);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to watch {} for hot reloading: {}", directory.string(), e.what());
+        return false;
+    }
+    spdlog::info("Hot reloading assets under {}.", directory.string());
+    return true;
+}
+
+void hot_reloader_t::track_import(
+  const std::filesystem::path& scene_file, const import_options_t& options,
+  const std::vector<asset_ref_t<primitives::vertex_array_t>>& vertex_arrays) {
+    if (!is_enabled() || vertex_arrays.empty()) return;
+    std::vector<asset_handle_t<primitives::vertex_array_t>> handles{};
+    handles.reserve(vertex_arrays.size());
+    for (const auto& vertex_array : vertex_arrays) {
+        handles.push_back(vertex_array.get_handle());
+    }
+    // imports reusing the assets of an earlier one are tracked once
+    if (std::ranges::any_of(_imports, [&handles](const auto& import) {
+            return import.vertex_arrays == handles;
+        }))
+        return;
+    _imports.push_back({get_watched_path(scene_file), options, std::move(handles)});
+}
+
+bool hot_reloader_t::is_import_output(const std::filesystem::path& file) const {
+    const auto extension = file.extension();
+    if (extension == ".pgmesh" || extension == ".pgtex" || extension == ".tmp") return true;
+    // <scene stem>_atlas_<index>.png next to the scene file
+    const auto watched_path = get_watched_path(file);
+    const auto filename = watched_path.filename().string();
+    return std::ranges::any_of(_imports, [&](const auto& import) {
+        return import.scene_file.parent_path() == watched_path.parent_path()
+               && filename.starts_with(import.scene_file.stem().string() + "_atlas_");
+    });
+}
+
+void hot_reloader_t::update() {
+    if (!_watcher) return;
+    finish_reloads();
+    const auto changed_files = _watcher->poll();
+    if (changed_files.empty()) return;
+
+    auto& vertex_arrays = asset_table_t<primitives::vertex_array_t>::get();
+    std::erase_if(_imports, [&vertex_arrays](const auto& import) {
+        return std::ranges::none_of(import.vertex_arrays, [&vertex_arrays](auto handle) {
+            return vertex_arrays.contains(handle);
+        });
+    });
+    std::erase_if(_reloaded_bounds, [&vertex_arrays](const auto& item) {
+        return !vertex_arrays.contains(
+          asset_handle_t<primitives::vertex_array_t>::from_value(item.first));
+    });
+
+    for (const auto& file : changed_files) {
+        if (is_import_output(file)) continue;
+        if (const auto count = asset_registry_t::get().reload_file(file); count > 0)
+            spdlog::info("Hot reloaded {} texture(s) of {}.", count, file.string());
+        const auto watched_path = get_watched_path(file);
+        for (const auto& import : _imports) {
+            if (import.scene_file == watched_path) start_reload(import);
+        }
+    }
+}
+
+void hot_reloader_t::start_reload(const tracked_import_t& import) {
+    auto reimport = import_job_t::start_reimport(import.scene_file, import.options);
+    // a reload of an older version of the file is dropped, it's read again anyway
+    auto it = std::ranges::find_if(_reloads, [&import](const auto& reload) {
+        return reload.import.vertex_arrays == import.vertex_arrays;
+    });
+    if (it != _reloads.end()) {
+        it->reimport = std::move(reimport);
+    } else {
+        _reloads.push_back({import, std::move(reimport)});
+    }
+}
+
+void hot_reloader_t::finish_reloads() {
+    std::erase_if(_reloads, [this](const pending_reload_t& reload) {
+        std::optional<std::vector<import_job_t::reimported_mesh_t>> meshes{};
+        try {
+            meshes = import_job_t::reimport_meshes(*reload.reimport);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to hot reload {}: {}", reload.import.scene_file.string(),
+                          e.what());
+            return true;
+        }
+        if (!meshes) return false;
+        swap_meshes(reload.import, *meshes);
+        return true;
+    });
+}
+
+void hot_reloader_t::swap_meshes(const tracked_import_t& import,
+                                 const std::vector<import_job_t::reimported_mesh_t>& meshes) {
+    // entities reference meshes by vertex array, only geometry can change in place, each vertex
+    // array of the import getting the new one of the same meshes
+    std::unordered_map<uint32_t, asset_handle_t<primitives::vertex_array_t>> replacements{};
+    std::set<uint32_t> new_vertex_arrays{};
+    bool same_structure = meshes.size() == import.vertex_arrays.size();
+    for (size_t i = 0; same_structure && i < meshes.size(); i++) {
+        const auto new_handle = meshes[i].vertex_array.get_handle();
+        auto it = replacements.try_emplace(import.vertex_arrays[i].get_value(), new_handle).first;
+        same_structure = it->second == new_handle;
+        new_vertex_arrays.insert(new_handle.get_value());
+    }
+    if (!same_structure || new_vertex_arrays.size() != replacements.size()) {
+        spdlog::warn("Meshes of {} can't be reloaded in place, as they were split differently. "
+                     "Import it again instead.",
+                     import.scene_file.string());
+        return;
+    }
+
+    auto& vertex_arrays = asset_table_t<primitives::vertex_array_t>::get();
+    size_t swapped = 0;
+    for (const auto& [old_value, new_handle] : replacements) {
+        const auto old_handle = asset_handle_t<primitives::vertex_array_t>::from_value(old_value);
+        if (!vertex_arrays.contains(old_handle)) continue;
+        // the old geometry is freed with the new vertex array's slot
+        std::swap(vertex_arrays[old_handle], vertex_arrays[new_handle]);
+        swapped++;
+    }
+    for (size_t i = 0; i < meshes.size(); i++) {
+        _reloaded_bounds.insert_or_assign(import.vertex_arrays[i].get_value(), meshes[i].aabb);
+    }
+    _revision++;
+    spdlog::info("Hot reloaded {} mesh(es) of {}.", swapped, import.scene_file.string());
+}
+
+std::optional<std::pair<glm::vec3, glm::vec3>> hot_reloader_t::find_reloaded_bounds(
+  asset_handle_t<primitives::vertex_array_t> vertex_array) const {
+    if (auto it = _reloaded_bounds.find(vertex_array.get_value()); it != _reloaded_bounds.end())
+        return it->second;
+    return std::nullopt;
+}
+
+} // namespace pgre::scene
@@ -0,0 +1,440 @@
+#include <scene/imported_scene.h>
+#include <assets/asset_registry.h>
+
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace pgre::scene {
+
+namespace {
+    constexpr uint32_t no_atlas = UINT32_MAX;
+    constexpr uint32_t no_embedded_texture = UINT32_MAX;
+
+    /**
+     * @brief Writes values as raw bytes. Strings and vertex data are padded to 4 bytes, so
+     * everything stays aligned in the mapped file.
+     */
+    class pgmesh_writer_t
+    {
+        std::ofstream _file;
+
+    public:
+        explicit pgmesh_writer_t(const std::filesystem::path& path)
+          : _file(path, std::ios::binary | std::ios::trunc) {
+            if (!_file) {
+                throw std::runtime_error(
+                  fmt::format("Failed to open {} for writing", path.string()));
+            }
+        }
+
+        template<typename T>
+        void write(const T& value) {
+            _file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        void write_array(const T* data, size_t count) {
+            _file.write(reinterpret_cast<const char*>(data),
+                        static_cast<std::streamsize>(count * sizeof(T)));
+        }
+
+        /**
+         * @brief Writes size bytes, padded to a multiple of 4.
+         */
+        void write_padded(const void* data, size_t size) {
+            write_array(static_cast<const char*>(data), size);
+            constexpr std::array<char, 4> padding{};
+            write_array(padding.data(), (4 - size % 4) % 4);
+        }
+
+        void write_string(std::string_view str) {
+            write(static_cast<uint32_t>(str.size()));
+            write_padded(str.data(), str.size());
+        }
+
+        [[nodiscard]] bool good() const { return _file.good(); }
+    };
+
+    /**
+     * @brief Reads what pgmesh_writer_t wrote from a mapped file.
+     */
+    class pgmesh_reader_t
+    {
+        std::span<const std::byte> _data;
+        size_t _offset = 0;
+
+        void check_size(size_t size) const {
+            if (size > _data.size() - _offset) throw std::runtime_error("Truncated .pgmesh file");
+        }
+
+    public:
+        explicit pgmesh_reader_t(std::span<const std::byte> data) : _data(data) {}
+
+        template<typename T>
+        T read() {
+            check_size(sizeof(T));
+            T value{};
+            std::memcpy(&value, _data.data() + _offset, sizeof(T));
+            _offset += sizeof(T);
+            return value;
+        }
+
+        /**
+         * @brief Get count values of T in place, the offset must be aligned for T.
+         */
+        template<typename T>
+        std::span<const T> read_span(size_t count) {
+            if (count > (_data.size() - _offset) / sizeof(T))
+                throw std::runtime_error("Truncated .pgmesh file");
+            std::span<const T> values{reinterpret_cast<const T*>(_data.data() + _offset), count};
+            _offset += count * sizeof(T);
+            return values;
+        }
+
+        /**
+         * @brief Get size bytes in place, skipping the padding after them.
+         */
+        std::span<const uint8_t> read_padded(size_t size) {
+            auto bytes = read_span<uint8_t>(size);
+            read_span<uint8_t>((4 - size % 4) % 4);
+            return bytes;
+        }
+
+        std::string read_string() {
+            auto chars = read_padded(read<uint32_t>());
+            return {chars.begin(), chars.end()};
+        }
+    };
+
+    void write_mesh(pgmesh_writer_t& writer, uint32_t geometry_source,
+                    const primitives::mesh_view_t& mesh) {
+        writer.write(geometry_source);
+        writer.write(mesh.material_ix);
+        writer.write(mesh.aabb.first);
+        writer.write(mesh.aabb.second);
+        writer.write(static_cast<uint32_t>(mesh.position_transform ? 1 : 0));
+        writer.write(mesh.position_transform.value_or(glm::mat4{1.0f}));
+        writer.write(static_cast<uint32_t>(mesh.elements.size()));
+        for (const auto& element : mesh.elements) {
+            writer.write_string(element.glsl_name);
+            writer.write(static_cast<uint32_t>(element.type));
+            writer.write(static_cast<uint32_t>(element.items_per_vertex));
+            writer.write(static_cast<uint32_t>(element.normalize ? 1 : 0));
+        }
+        writer.write(static_cast<uint32_t>(mesh.index_type));
+        writer.write(static_cast<uint64_t>(mesh.vertices.size()));
+        writer.write(static_cast<uint64_t>(mesh.indices.size()));
+        writer.write_padded(mesh.vertices.data(), mesh.vertices.size());
+        writer.write_padded(mesh.indices.data(), mesh.indices.size());
+    }
+
+    int64_t get_write_time(const std::filesystem::path& path) {
+        std::error_code err{};
+        auto write_time = std::filesystem::last_write_time(path, err);
+        return err ? 0 : static_cast<int64_t>(write_time.time_since_epoch().count());
+    }
+
+    uint64_t get_file_size(const std::filesystem::path& path) {
+        std::error_code err{};
+        auto size = std::filesystem::file_size(path, err);
+        return err ? 0 : static_cast<uint64_t>(size);
+    }
+
+    /**
+     * @brief Writes the scene through a temporary file, write_mesh_at writes each mesh.
+     */
+    template<typename WriteMeshFnTy>
+    void write_scene(const imported_scene_t& scene, const std::filesystem::path& path,
+                     const std::filesystem::path& source, size_t mesh_count,
+                     WriteMeshFnTy&& write_mesh_at) {
+        const auto source_dir = std::filesystem::absolute(source.parent_path());
+        // imports of the same file from other threads or processes write their own temp files
+        auto temp_path = path;
+        temp_path += fmt::format(".{:08x}{:08x}.tmp", std::random_device{}(),
+                                 std::random_device{}());
+        try {
+            pgmesh_writer_t writer{temp_path};
+            writer.write(imported_scene_t::magic);
+            writer.write(imported_scene_t::format_version);
+            writer.write(get_file_size(source));
+            writer.write(get_write_time(source));
+            writer.write_string(scene.source_key);
+            writer.write_string(scene.options_key);
+
+            writer.write(static_cast<uint32_t>(scene.nodes.size()));
+            for (const auto& node : scene.nodes) {
+                writer.write_string(node.name);
+                writer.write(node.transform);
+                writer.write(node.parent_ix);
+                writer.write(static_cast<uint32_t>(node.mesh_indices.size()));
+                writer.write_array(node.mesh_indices.data(), node.mesh_indices.size());
+            }
+
+            writer.write(static_cast<uint32_t>(scene.materials.size()));
+            for (const auto& material : scene.materials) {
+                writer.write(material.diffuse);
+                writer.write(material.ambient);
+                writer.write(material.specular);
+                writer.write(material.shininess);
+                writer.write(material.transparency);
+                writer.write_string(material.color_texture_path.empty()
+                                      ? std::string{}
+                                      : material.color_texture_path.lexically_relative(source_dir)
+                                          .generic_string());
+                writer.write(material.atlas_ix ? static_cast<uint32_t>(*material.atlas_ix)
+                                               : no_atlas);
+                writer.write(material.embedded_texture_ix.value_or(no_embedded_texture));
+            }
+
+            writer.write(static_cast<uint32_t>(scene.atlas_paths.size()));
+            for (const auto& atlas_path : scene.atlas_paths) {
+                writer.write_string(std::filesystem::absolute(atlas_path)
+                                      .lexically_relative(source_dir)
+                                      .generic_string());
+            }
+
+            writer.write(static_cast<uint32_t>(scene.embedded_textures.size()));
+            for (const auto& texture : scene.embedded_textures) {
+                writer.write(texture.width);
+                writer.write(texture.height);
+                writer.write(static_cast<uint64_t>(texture.data.size()));
+                writer.write_padded(texture.data.data(), texture.data.size());
+            }
+
+            writer.write(static_cast<uint32_t>(scene.lights.size()));
+            for (const auto& light : scene.lights) {
+                writer.write(light.type);
+                writer.write_string(light.node_name);
+                writer.write(light.ambient);
+                writer.write(light.diffuse);
+                writer.write(light.specular);
+                writer.write(light.direction);
+                writer.write(light.attenuation);
+                writer.write(light.outer_cone_angle);
+                writer.write(light.inner_cone_angle);
+            }
+
+            writer.write(static_cast<uint32_t>(mesh_count));
+            for (size_t mesh_ix = 0; mesh_ix < mesh_count; mesh_ix++) {
+                write_mesh_at(writer, mesh_ix);
+            }
+            if (!writer.good())
+                throw std::runtime_error(fmt::format("Failed to write {}", temp_path.string()));
+        } catch (...) {
+            std::error_code err{};
+            std::filesystem::remove(temp_path, err);
+            throw;
+        }
+
+        std::error_code err{};
+        std::filesystem::rename(temp_path, path, err);
+        if (err) {
+            std::filesystem::remove(temp_path, err);
+            throw std::runtime_error(fmt::format("Failed to replace {}", path.string()));
+        }
+    }
+
+    /**
+     * @brief Checks the indices read from a cache point into the scene, the import indexes with
+     * them unchecked.
+     *
+     * @throws std::runtime_error on the first invalid one.
+     */
+    void validate_indices(const imported_scene_t& scene) {
+        for (uint32_t node_ix = 0; node_ix < scene.nodes.size(); node_ix++) {
+            const auto& node = scene.nodes[node_ix];
+            // parents come before their children
+            if (node.parent_ix != imported_node_t::no_parent && node.parent_ix >= node_ix)
+                throw std::runtime_error("Invalid node parent");
+            for (auto mesh_ix : node.mesh_indices) {
+                if (mesh_ix >= scene.meshes.size()) throw std::runtime_error("Invalid node mesh");
+            }
+        }
+        for (const auto& material : scene.materials) {
+            if (material.atlas_ix && *material.atlas_ix >= scene.atlas_paths.size())
+                throw std::runtime_error("Invalid material atlas");
+        }
+        for (const auto& mesh : scene.meshes) {
+            if (mesh.material_ix >= scene.materials.size())
+                throw std::runtime_error("Invalid mesh material");
+        }
+    }
+} // namespace
+
+void imported_scene_t::set_mesh_data(std::vector<primitives::mesh_data_t>&& mesh_data) {
+    _mesh_data = std::move(mesh_data);
+    meshes.clear();
+    meshes.reserve(_mesh_data.size());
+    for (const auto& mesh : _mesh_data) meshes.push_back(mesh.get_view());
+    geometry_sources.resize(meshes.size());
+    std::iota(geometry_sources.begin(), geometry_sources.end(), 0);
+}
+
+std::span<const std::byte> imported_scene_t::add_file(vfs_file_t&& file) {
+    return _files.emplace_back(std::move(file)).get_data();
+}
+
+std::span<const uint8_t> imported_scene_t::add_buffer(std::vector<uint8_t>&& data) {
+    return _buffers.emplace_back(std::move(data));
+}
+
+void imported_scene_t::release_mesh_data(size_t mesh_ix) {
+    meshes[mesh_ix].vertices = {};
+    meshes[mesh_ix].indices = {};
+    meshes[mesh_ix].streams.clear();
+    if (mesh_ix < _mesh_data.size()) {
+        _mesh_data[mesh_ix].vertices = {};
+        _mesh_data[mesh_ix].indices = {};
+    }
+}
+
+std::filesystem::path imported_scene_t::get_cache_path(const std::filesystem::path& source) {
+    auto cache_path = source;
+    cache_path += ".pgmesh";
+    return cache_path;
+}
+
+void imported_scene_t::write(const std::filesystem::path& path,
+                             const std::filesystem::path& source) const {
+    write_scene(*this, path, source, meshes.size(),
+                [this](pgmesh_writer_t& writer, size_t mesh_ix) {
+                    write_mesh(writer, geometry_sources[mesh_ix], meshes[mesh_ix]);
+                });
+}
+
+void imported_scene_t::write(
+  const std::filesystem::path& path, const std::filesystem::path& source, size_t mesh_count,
+  const std::function<primitives::mesh_data_t(size_t)>& get_mesh) const {
+    write_scene(*this, path, source, mesh_count,
+                [&get_mesh](pgmesh_writer_t& writer, size_t mesh_ix) {
+                    auto mesh = get_mesh(mesh_ix);
+                    write_mesh(writer, static_cast<uint32_t>(mesh_ix), mesh.get_view());
+                });
+}
+
+std::optional<imported_scene_t> imported_scene_t::read(const std::filesystem::path& path,
+                                                       const std::filesystem::path& source,
+                                                       std::string_view options_key) {
+    auto file = vfs_t::get().open(path);
+    if (!file) return std::nullopt;
+
+    try {
+        pgmesh_reader_t reader{file->get_data()};
+        if (reader.read<std::array<char, 4>>() != magic
+            || reader.read<uint32_t>() != format_version)
+            return std::nullopt;
+
+        imported_scene_t scene{};
+        auto source_size = reader.read<uint64_t>();
+        auto source_write_time = reader.read<int64_t>();
+        scene.source_key = reader.read_string();
+        scene.options_key = reader.read_string();
+        if (scene.options_key != options_key) return std::nullopt;
+        // a touched but unchanged source keeps its cache
+        if ((source_size != get_file_size(source) || source_write_time != get_write_time(source))
+            && scene.source_key != asset_registry_t::get().get_file_key(source))
+            return std::nullopt;
+
+        const auto source_dir = std::filesystem::absolute(source.parent_path());
+        scene.nodes.resize(reader.read<uint32_t>());
+        for (auto& node : scene.nodes) {
+            node.name = reader.read_string();
+            node.transform = reader.read<glm::mat4>();
+            node.parent_ix = reader.read<uint32_t>();
+            auto mesh_indices = reader.read_span<uint32_t>(reader.read<uint32_t>());
+            node.mesh_indices.assign(mesh_indices.begin(), mesh_indices.end());
+        }
+
+        scene.materials.resize(reader.read<uint32_t>());
+        for (auto& material : scene.materials) {
+            material.diffuse = reader.read<glm::vec3>();
+            material.ambient = reader.read<glm::vec3>();
+            material.specular = reader.read<glm::vec3>();
+            material.shininess = reader.read<float>();
+            material.transparency = reader.read<float>();
+            if (auto texture_path = reader.read_string(); !texture_path.empty())
+                material.color_texture_path = source_dir / texture_path;
+            if (auto atlas_ix = reader.read<uint32_t>(); atlas_ix != no_atlas)
+                material.atlas_ix = atlas_ix;
+            if (auto texture_ix = reader.read<uint32_t>(); texture_ix != no_embedded_texture)
+                material.embedded_texture_ix = texture_ix;
+        }
+
+        scene.atlas_paths.resize(reader.read<uint32_t>());
+        for (auto& atlas_path : scene.atlas_paths) {
+            atlas_path = source_dir / reader.read_string();
+            // atlases are written by the import, they may have been deleted since
+            if (!std::filesystem::is_regular_file(atlas_path)) return std::nullopt;
+        }
+
+        scene.embedded_textures.resize(reader.read<uint32_t>());
+        for (auto& texture : scene.embedded_textures) {
+            texture.width = reader.read<uint32_t>();
+            texture.height = reader.read<uint32_t>();
+            texture.data = reader.read_padded(reader.read<uint64_t>());
+        }
+        for (const auto& material : scene.materials) {
+            if (material.embedded_texture_ix
+                && *material.embedded_texture_ix >= scene.embedded_textures.size())
+                throw std::runtime_error("Invalid embedded texture");
+        }
+
+        scene.lights.resize(reader.read<uint32_t>());
+        for (auto& light : scene.lights) {
+            const auto type = reader.read<uint32_t>();
+            if (type > static_cast<uint32_t>(imported_light_t::type_t::spot))
+                throw std::runtime_error("Invalid light type");
+            light.type = static_cast<imported_light_t::type_t>(type);
+            light.node_name = reader.read_string();
+            light.ambient = reader.read<glm::vec3>();
+            light.diffuse = reader.read<glm::vec3>();
+            light.specular = reader.read<glm::vec3>();
+            light.direction = reader.read<glm::vec3>();
+            light.attenuation = reader.read<glm::vec3>();
+            light.outer_cone_angle = reader.read<float>();
+            light.inner_cone_angle = reader.read<float>();
+        }
+
+        scene.meshes.resize(reader.read<uint32_t>());
+        scene.geometry_sources.resize(scene.meshes.size());
+        for (size_t mesh_ix = 0; mesh_ix < scene.meshes.size(); mesh_ix++) {
+            auto& mesh = scene.meshes[mesh_ix];
+            scene.geometry_sources[mesh_ix] = reader.read<uint32_t>();
+            if (scene.geometry_sources[mesh_ix] > mesh_ix)
+                throw std::runtime_error("Invalid geometry source");
+            mesh.material_ix = reader.read<uint32_t>();
+            mesh.aabb.first = reader.read<glm::vec3>();
+            mesh.aabb.second = reader.read<glm::vec3>();
+            auto has_position_transform = reader.read<uint32_t>() != 0;
+            auto position_transform = reader.read<glm::mat4>();
+            if (has_position_transform) mesh.position_transform = position_transform;
+            mesh.elements.resize(reader.read<uint32_t>());
+            for (auto& element : mesh.elements) {
+                auto name = reader.read_string();
+                auto type = static_cast<GLenum>(reader.read<uint32_t>());
+                auto items_per_vertex = reader.read<uint32_t>();
+                auto normalize = reader.read<uint32_t>() != 0;
+                element = primitives::buffer_element_t{type, items_per_vertex, name, normalize};
+            }
+            mesh.index_type = static_cast<GLenum>(reader.read<uint32_t>());
+            auto vertex_bytes = reader.read<uint64_t>();
+            auto index_bytes = reader.read<uint64_t>();
+            mesh.vertices = reader.read_padded(vertex_bytes);
+            mesh.indices = reader.read_padded(index_bytes);
+        }
+        validate_indices(scene);
+        scene.add_file(std::move(*file));
+        return scene;
+    } catch (const std::runtime_error& e) {
+        spdlog::warn("Ignoring mesh cache {}: {}", path.string(), e.what());
+        return std::nullopt;
+    }
+}
+
+} // namespace pgre::scene
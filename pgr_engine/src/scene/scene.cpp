@@ -1,16 +1,63 @@
 #include "renderer/renderer.h"
 #include <filesystem>
 #include <scene/scene.h>
+#include <assets/asset_archive.h>
+#include <assets/asset_registry.h>
+#include <assets/materials/all_materials.h>
+#include <assets/textures/texture_cooker.h>
 #include <glad/glad.h>
 
 #include <components/all_components.h>
 #include <scene/entity.h>
+#include <scene/hot_reloader.h>
 #include <cerealization/glm_serializers.h>
 #include <cerealization/std_serializers.h>
 #include <cereal/archives/json.hpp>
+#include <utility/call_at_scope_exit.h>
+#include <utility/vfs.h>
 
 namespace pgre::scene {
 
+namespace {
+    /**
+     * @brief Get the files loading the assets reads, cooked caches in place of the sources of
+     * compressed textures.
+     */
+    std::vector<std::filesystem::path> get_asset_files(const asset_archive_context_t& assets) {
+        std::vector<std::filesystem::path> files{};
+        for (const auto& material : assets.materials) {
+            if (auto* phong = std::get_if<phong_material_t>(&*material)) {
+                if (!phong->_color_texture || phong->_color_texture->get_path().empty()) continue;
+                const auto& path = phong->_color_texture->get_path();
+                files.push_back(phong->_color_texture->is_compressed()
+                                  ? texture_cooker_t::get_cache_path(path)
+                                  : path);
+            } else if (auto* skybox = std::get_if<skybox_material_t>(&*material)) {
+                const auto& cubemap = skybox->_cubemap_texture;
+                if (!cubemap || cubemap->get_paths().empty()) continue;
+                auto face_sources = cubemap_texture_t::get_face_sources(cubemap->get_paths());
+                if (cubemap->is_compressed()) {
+                    files.push_back(texture_cooker_t::get_cache_path(face_sources.front(),
+                                                                     face_sources.size()));
+                } else {
+                    files.insert(files.end(), face_sources.begin(), face_sources.end());
+                }
+            }
+        }
+        return files;
+    }
+
+    std::vector<std::filesystem::path> read_manifest(const std::filesystem::path& path) {
+        std::vector<std::filesystem::path> files{};
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) files.emplace_back(std::u8string(line.begin(), line.end()));
+        }
+        return files;
+    }
+} // namespace
+
 scene_t::scene_t() {
     _registry.on_destroy<component::camera_component_t>()
       .connect<&scene_t::on_camera_component_remove>(this);
@@ -52,6 +99,8 @@ std::pair<std::shared_ptr<perspective_camera_t>, glm::mat4> scene_t::get_active_
 }
 
 void scene_t::update(const interval_t& delta) {
+    process_imports();
+    update_reloaded_bounds();
     // update things that can affect transforms
     _registry.view<component::keyframe_animator_t>().each(
       [&delta, this](auto entity, component::keyframe_animator_t& animator_c) {
@@ -107,11 +156,18 @@ void scene_t::on_event(event_t& event) {
 void scene_t::render() {
     if (_active_camera_owner == entt::null) return;
     renderer::begin_scene(*this);
+    auto [camera, view_m] = get_active_camera();
+    const auto proj_m = camera->get_projection_matrix();
+    const auto viewport_height = static_cast<float>(app_t::get_window().get_dimensions().y);
     auto mesh_view = _registry.view<component::transform_t, component::mesh_t>();
     for (entt::entity entity : mesh_view) {
         auto& mesh_component = _registry.get<component::mesh_t>(entity);
-        renderer::submit(_registry.get<component::transform_t>(entity), mesh_component.v_array,
-                         mesh_component.material);
+        auto& transform = _registry.get<component::transform_t>(entity);
+        auto screen_size = std::numeric_limits<float>::infinity();
+        if (auto* bb = _registry.try_get<component::bounding_box_t>(entity))
+            screen_size = bb->get_projected_size(transform, view_m, proj_m, viewport_height);
+        renderer::submit(transform, mesh_component.v_array.get_handle(),
+                         mesh_component.material.get_handle(), GL_TRIANGLES, screen_size);
     }
     auto curve_view = _registry.view<component::transform_t, component::coons_curve_animator_t>();
     for (entt::entity entity : curve_view) {
@@ -123,7 +179,8 @@ void scene_t::render() {
         auto transform = glm::mat4(1);
         if (hier.parent != entt::null)
             transform = _registry.get<component::transform_t>(hier.parent);
-        renderer::submit(transform, curve.get_cp_vao(), curve.get_material(), GL_POINTS);
+        renderer::submit(transform, curve.get_cp_vao().get_handle(),
+                         curve.get_material().get_handle(), GL_POINTS);
     }
     renderer::end_scene();
 }
@@ -163,20 +220,53 @@ void scene_t::serialize(const std::filesystem::path& filename) {
         spdlog::error("Failed to open file for serialization: {}", filename.string());
         return;
     }
-    cereal::BinaryOutputArchive output(out);
+    // assets are written once, ahead of the components referencing them by index
+    asset_archive_context_t assets{};
+    _registry.view<component::mesh_t>().each(
+      [&assets](auto /*entity*/, const component::mesh_t& mesh_c) {
+          assets.vertex_arrays.add(mesh_c.v_array);
+          assets.materials.add(mesh_c.material);
+      });
+    cereal::UserDataAdapter<asset_archive_context_t, cereal::BinaryOutputArchive> output(assets,
+                                                                                        out);
+    output(assets);
     entt::snapshot{_registry}.entities(output).component<PGRE_COMPONENT_TYPES>(output);
     output(_active_camera_owner);
     out.flush();
     out.close();
+
+    std::ofstream manifest(get_manifest_path(filename));
+    for (const auto& file : get_asset_files(assets)) {
+        auto u8str = std::filesystem::absolute(file).lexically_normal().u8string();
+        manifest << std::string(u8str.begin(), u8str.end()) << '\n';
+    }
+    if (!manifest) spdlog::warn("Failed to write the manifest of {}", filename.string());
 }
 
 std::shared_ptr<scene_t> scene_t::deserialize(const std::filesystem::path& filename) {
     auto retval = std::make_shared<scene_t>();
+    // the asset files are read as one batch while the scene is parsed, instead of one by one as
+    // each asset is created
+    vfs_t::get().prefetch(read_manifest(get_manifest_path(filename)));
+    // textures streamed in the background hold on to their files until they read them
+    auto drop_prefetched = call_at_scope_exit_t([]() { vfs_t::get().drop_prefetched(); });
     std::ifstream in(filename, std::ios::binary);
-    cereal::BinaryInputArchive input(in);
+    asset_archive_context_t assets{};
+    cereal::UserDataAdapter<asset_archive_context_t, cereal::BinaryInputArchive> input(assets, in);
+    input(assets);
     entt::snapshot_loader{retval->_registry}.entities(input).component<PGRE_COMPONENT_TYPES>(input);
     input(retval->_active_camera_owner);
 
+    // textures already loaded by other scenes are shared instead of loaded again
+    auto& asset_registry = asset_registry_t::get();
+    for (const auto& material : assets.materials) {
+        if (auto* phong = std::get_if<phong_material_t>(&*material)) {
+            asset_registry.deduplicate(phong->_color_texture);
+        } else if (auto* skybox = std::get_if<skybox_material_t>(&*material)) {
+            asset_registry.deduplicate(skybox->_cubemap_texture);
+        }
+    }
+
     retval->_registry.view<component::transform_t, component::hierarchy_t>().each(
       [&registry = retval->_registry](auto /*entity*/, component::transform_t& transform_c,
                                       component::hierarchy_t& hier_c) {
@@ -188,6 +278,27 @@ std::shared_ptr<scene_t> scene_t::deserialize(const std::filesystem::path& filen
     return retval;
 }
 
+void scene_t::update_reloaded_bounds() {
+    const auto& reloader = hot_reloader_t::get();
+    if (reloader.get_revision() == _hot_reload_revision) return;
+    _hot_reload_revision = reloader.get_revision();
+    _registry.view<component::mesh_t, component::bounding_box_t>().each(
+      [&reloader](auto /*entity*/, const component::mesh_t& mesh_c,
+                  component::bounding_box_t& bb_c) {
+          if (auto bounds = reloader.find_reloaded_bounds(mesh_c.v_array.get_handle())) {
+              const bool enable_collisions = bb_c.enable_collisions;
+              bb_c = component::bounding_box_t{*bounds};
+              bb_c.enable_collisions = enable_collisions;
+          }
+      });
+}
+
+std::filesystem::path scene_t::get_manifest_path(const std::filesystem::path& filename) {
+    auto path = filename;
+    path += ".manifest";
+    return path;
+}
+
 std::optional<entity_t> scene_t::get_mesh_at_screenspace_coords(const glm::vec2& window_coords) {
     if (_active_camera_owner == entt::null) return std::nullopt;
     auto&& [camera, view_m] = get_active_camera();
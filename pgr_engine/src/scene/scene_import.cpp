@@ -1,13 +1,39 @@
 #include "math/aabb.h"
+#include <math/mesh_optimization.h>
 #include <scene/scene.h>
+#include <scene/gltf_import.h>
+#include <scene/hot_reloader.h>
+#include <scene/imported_scene.h>
+#include <scene/vfs_io_system.h>
+#include <assets/asset_registry.h>
+#include <assets/textures/texture_atlas.h>
+#include <assets/textures/texture_cooker.h>
 
 #include <scene/entity.h>
 #include <components/all_components.h>
+#include <primitives/mesh_data.h>
+#include <utility/hash.h>
+#include <utility/thread_pool.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image.h>
+
 glm::vec3 vec3_cast(const aiColor3D& v) { return glm::vec3(v.r, v.g, v.b); }
 glm::vec3 vec3_cast(const aiVector3D& v) { return glm::vec3(v.x, v.y, v.z); }
 glm::vec2 vec2_cast(const aiVector3D& v) {
@@ -18,12 +44,215 @@ glm::mat4 mat4_cast(const aiMatrix4x4& m) { return glm::transpose(glm::make_mat4
 
 namespace pgre::scene {
 
-std::vector<std::shared_ptr<phong_material_t>>
-  import_materials(const aiScene* ai_scene, const std::filesystem::path& scene_file) {
-    std::vector<std::shared_ptr<phong_material_t>> materials(ai_scene->mNumMaterials, nullptr);
+namespace {
+    /**
+     * @brief Reads files and runs the conversions, which wait for tasks on the global pool, so
+     * can't run on it.
+     */
+    thread_pool_t& get_import_pool() {
+        static thread_pool_t pool{1};
+        return pool;
+    }
+} // namespace
+
+/**
+ * @brief An embedded texture decoded on a worker thread, uploaded on the GL thread. Empty if it
+ * failed to decode.
+ */
+struct decoded_texture_t
+{
+    /**
+     * @brief RGBA pixels decoded by stb_image, bottom row first, RGB if there's no alpha and
+     * textures aren't compressed.
+     */
+    std::unique_ptr<stbi_uc, void (*)(void*)> pixels{nullptr, &stbi_image_free};
+    /**
+     * @brief Texels of a texture that wasn't encoded.
+     */
+    std::vector<aiTexel> texels{};
+    /**
+     * @brief Set instead of pixels if textures are compressed.
+     */
+    std::optional<cooked_texture_t> cooked{};
+    int width = 0;
+    int height = 0;
+    bool alpha = false;
+};
+
+struct import_job_t::prepared_t
+{
+    imported_scene_t scene{};
+    /**
+     * @brief Decodes scene.embedded_textures on the import pool, started only if the assets of
+     * an earlier import can't be reused.
+     */
+    std::future<std::vector<decoded_texture_t>> decoding{};
+    /**
+     * @brief The scene's embedded textures once decoded, each freed once uploaded.
+     */
+    std::vector<decoded_texture_t> embedded_textures{};
+    /**
+     * @brief Key of the imported file and import options, see register_imported_asset.
+     */
+    std::string import_key{};
+    /**
+     * @brief Whether assets of an earlier import of the same file are used.
+     */
+    bool reused = false;
+    /**
+     * @brief Whether the file was read and converted, rather than its cache mapped.
+     */
+    bool converted = false;
+    /**
+     * @brief Why the converted scene couldn't be cached, the import itself doesn't need it.
+     */
+    std::optional<std::string> cache_error{};
+
+    prepared_t() = default;
+    prepared_t(const prepared_t&) = delete;
+    prepared_t& operator=(const prepared_t&) = delete;
+    ~prepared_t() {
+        // the decoding reads the views in scene
+        if (decoding.valid()) decoding.wait();
+    }
+};
+
+/**
+ * @brief Flattens the node hierarchy depth first, the root's transform is left out.
+ */
+void import_nodes(const aiNode* ai_node, uint32_t parent_ix, std::vector<imported_node_t>& nodes) {
+    auto& node = nodes.emplace_back();
+    node.name = ai_node->mName.C_Str();
+    node.transform = parent_ix == imported_node_t::no_parent
+                       ? glm::mat4{1}
+                       : mat4_cast(ai_node->mTransformation);
+    node.parent_ix = parent_ix;
+    node.mesh_indices.assign(ai_node->mMeshes, ai_node->mMeshes + ai_node->mNumMeshes);
+
+    const auto node_ix = static_cast<uint32_t>(nodes.size() - 1);
+    for (unsigned int child_ix = 0; child_ix < ai_node->mNumChildren; child_ix++) {
+        import_nodes(ai_node->mChildren[child_ix], node_ix, nodes);
+    }
+}
+
+/**
+ * @brief Replaces the mesh indices of nodes with the indices of the meshes' clusters.
+ *
+ * @param first_clusters see plan_clusters
+ */
+void assign_clusters(std::vector<imported_node_t>& nodes,
+                     const std::vector<uint32_t>& first_clusters) {
+    for (auto& node : nodes) {
+        std::vector<uint32_t> cluster_indices{};
+        for (auto mesh_ix : node.mesh_indices) {
+            for (auto cluster_ix = first_clusters[mesh_ix];
+                 cluster_ix < first_clusters[mesh_ix + 1]; cluster_ix++) {
+                cluster_indices.push_back(cluster_ix);
+            }
+        }
+        node.mesh_indices = std::move(cluster_indices);
+    }
+}
+
+/**
+ * @brief Views of the textures embedded in the file, valid as long as ai_scene.
+ */
+std::vector<embedded_texture_t> import_embedded_textures(const aiScene* ai_scene) {
+    std::vector<embedded_texture_t> textures(ai_scene->mNumTextures);
+    for (unsigned int i = 0; i < ai_scene->mNumTextures; i++) {
+        const auto& ai_texture = *ai_scene->mTextures[i];
+        const auto* data = reinterpret_cast<const uint8_t*>(ai_texture.pcData);
+        if (ai_texture.mHeight == 0) {
+            // an encoded image of mWidth bytes
+            textures[i].data = {data, ai_texture.mWidth};
+        } else {
+            const auto texel_count = static_cast<size_t>(ai_texture.mWidth) * ai_texture.mHeight;
+            textures[i].data = {data, texel_count * sizeof(aiTexel)};
+            textures[i].width = ai_texture.mWidth;
+            textures[i].height = ai_texture.mHeight;
+        }
+    }
+    return textures;
+}
+
+/**
+ * @brief Copies the data of the views into buffers owned by scene, so they outlive the
+ * importer's scene they point into.
+ */
+void own_embedded_textures(imported_scene_t& scene) {
+    for (auto& texture : scene.embedded_textures) {
+        texture.data = scene.add_buffer({texture.data.begin(), texture.data.end()});
+    }
+}
+
+/**
+ * @brief Decodes embedded textures in parallel on the global pool, encoded images straight from
+ * the data the views point to. Compressed textures are cooked afterwards, as cooking waits for
+ * tasks on the pool itself.
+ */
+std::vector<decoded_texture_t>
+  decode_embedded_textures(const std::vector<embedded_texture_t>& textures, bool compress) {
+    std::vector<std::future<decoded_texture_t>> decoding{};
+    decoding.reserve(textures.size());
+    for (const auto& texture : textures) {
+        decoding.push_back(thread_pool_t::get_global().submit([&texture, compress]() {
+            // the global flag would race with decoding on other threads
+            stbi_set_flip_vertically_on_load_thread(1);
+            decoded_texture_t decoded{};
+            if (!texture.is_encoded()) {
+                decoded.texels.resize(static_cast<size_t>(texture.width) * texture.height);
+                if (texture.data.size() < decoded.texels.size() * sizeof(aiTexel))
+                    throw image_loading_error("Truncated texels.");
+                std::memcpy(decoded.texels.data(), texture.data.data(),
+                            decoded.texels.size() * sizeof(aiTexel));
+                decoded.width = static_cast<int>(texture.width);
+                decoded.height = static_cast<int>(texture.height);
+                decoded.alpha = true;
+                return decoded;
+            }
+            const auto* data = texture.data.data();
+            const auto size = static_cast<int>(texture.data.size());
+            int channels{};
+            if (stbi_info_from_memory(data, size, &decoded.width, &decoded.height, &channels) == 0)
+                throw image_loading_error(stbi_failure_reason());
+            decoded.alpha = channels == 2 || channels == 4;
+            // the cooker takes RGBA
+            decoded.pixels.reset(stbi_load_from_memory(data, size, &decoded.width,
+                                                       &decoded.height, &channels,
+                                                       compress || decoded.alpha ? 4 : 3));
+            if (!decoded.pixels) throw image_loading_error(stbi_failure_reason());
+            return decoded;
+        }));
+    }
+
+    std::vector<decoded_texture_t> decoded(textures.size());
+    for (size_t texture_ix = 0; texture_ix < decoding.size(); texture_ix++) {
+        try {
+            decoded[texture_ix] = decoding[texture_ix].get();
+        } catch (const std::exception& e) {
+            spdlog::warn("Import: embedded texture {} left out: {}", texture_ix, e.what());
+        }
+    }
+    if (!compress) return decoded;
+    for (auto& texture : decoded) {
+        if (!texture.pixels) continue;
+        const auto* pixels = texture.pixels.get();
+        const auto width = static_cast<uint32_t>(texture.width);
+        const auto height = static_cast<uint32_t>(texture.height);
+        texture.cooked = texture_cooker_t::cook_rgba(
+          {{pixels, pixels + static_cast<size_t>(width) * height * 4}}, width, height,
+          texture.alpha);
+        texture.pixels.reset();
+    }
+    return decoded;
+}
+
+std::vector<imported_material_t> import_materials(const aiScene* ai_scene,
+                                                  const std::filesystem::path& scene_file) {
+    std::vector<imported_material_t> materials(ai_scene->mNumMaterials);
     for (unsigned int i = 0; i < ai_scene->mNumMaterials; i++) {
         aiMaterial& ai_material = *ai_scene->mMaterials[i];
-        static aiColor3D ambient{1.0f}, diffuse{1.0f}, specular{1.0f}, transparent{0.0f};
+        aiColor3D ambient{1.0f}, diffuse{1.0f}, specular{1.0f};
         ai_real shininess{1.0f}, transparency{0.0f};
         if (ai_material.Get(AI_MATKEY_COLOR_AMBIENT, ambient) != AI_SUCCESS)
             spdlog::error("Import: Failed to get material ambient color.");
@@ -44,219 +273,1008 @@ std::vector<std::shared_ptr<phong_material_t>>
         //         spdlog::error("Import: Failed to get material opacity and transparency.");
         // }
 
-        std::shared_ptr<texture2D_t> color_texture{nullptr};
+        auto& material = materials[i];
+        material.diffuse = vec3_cast(diffuse);
+        material.ambient = vec3_cast(ambient);
+        material.specular = vec3_cast(specular);
+        material.shininess = shininess;
+        material.transparency = transparency;
         if (ai_material.GetTextureCount(aiTextureType_DIFFUSE) > 0) {
             aiString path;
             if (ai_material.GetTexture(aiTextureType_DIFFUSE, 0, &path, nullptr, nullptr, nullptr,
                                        nullptr, nullptr)
                 == AI_SUCCESS) {
-                color_texture = std::make_shared<texture2D_t>(
-                  (std::filesystem::absolute(scene_file.parent_path()) / path.C_Str()).string());
+                // referenced as "*N", or by file name in FBX files
+                if (auto [embedded, texture_ix]
+                    = ai_scene->GetEmbeddedTextureAndIndex(path.C_Str());
+                    embedded) {
+                    material.embedded_texture_ix = static_cast<uint32_t>(texture_ix);
+                } else {
+                    material.color_texture_path
+                      = std::filesystem::absolute(scene_file.parent_path()) / path.C_Str();
+                }
             } else {
                 spdlog::error("Import: failed to get diffuse texture for material.");
             }
         }
+    }
+    return materials;
+}
 
-        if (color_texture) {
-            materials[i] = std::make_shared<phong_material_t>(
-              std::move(color_texture), glm::vec3{diffuse.r, diffuse.g, diffuse.b},
-              glm::vec3{ambient.r, ambient.g, ambient.b},
-              glm::vec3{specular.r, specular.g, specular.b}, shininess, transparency);
+/**
+ * @brief Packs small diffuse textures of imported materials into atlases, and writes them next
+ * to the scene file. Doesn't touch OpenGL.
+ *
+ * @param atlas_paths receives the paths of the written atlases.
+ * @return std::vector<glm::vec4> per material UV transform (scale in xy, offset in zw) to apply
+ * to the texture coordinates of meshes using the material.
+ */
+std::vector<glm::vec4>
+  build_texture_atlases(const aiScene* ai_scene, const std::filesystem::path& scene_file,
+                        const import_options_t& options,
+                        std::vector<imported_material_t>& materials,
+                        std::vector<std::filesystem::path>& atlas_paths) {
+    std::vector<glm::vec4> uv_transforms(materials.size(), glm::vec4{1.0f, 1.0f, 0.0f, 0.0f});
+
+    // UVs outside of [0, 1] rely on texture wrapping, which can't work with an atlas
+    constexpr float uv_epsilon = 1e-4f;
+    std::vector<bool> can_be_atlased(materials.size(), true);
+    for (unsigned int mesh_ix = 0; mesh_ix < ai_scene->mNumMeshes; mesh_ix++) {
+        auto* ai_mesh = ai_scene->mMeshes[mesh_ix];
+        if (!can_be_atlased[ai_mesh->mMaterialIndex]) continue;
+        if (!ai_mesh->HasTextureCoords(0)) {
+            can_be_atlased[ai_mesh->mMaterialIndex] = false;
+            continue;
+        }
+        for (unsigned int vertex_ix = 0; vertex_ix < ai_mesh->mNumVertices; vertex_ix++) {
+            const auto& uv = ai_mesh->mTextureCoords[0][vertex_ix];
+            if (uv.x < -uv_epsilon || uv.x > 1.0f + uv_epsilon || uv.y < -uv_epsilon
+                || uv.y > 1.0f + uv_epsilon) {
+                can_be_atlased[ai_mesh->mMaterialIndex] = false;
+                break;
+            }
+        }
+    }
+
+    texture_atlas_builder_t atlas_builder{options.atlas_size, options.atlas_padding};
+    std::map<std::filesystem::path, texture_atlas_builder_t::entry_t> packed_textures{};
+    std::vector<std::optional<texture_atlas_builder_t::entry_t>> material_entries(materials.size());
+    for (size_t material_ix = 0; material_ix < materials.size(); material_ix++) {
+        const auto& path = materials[material_ix].color_texture_path;
+        if (!can_be_atlased[material_ix] || path.empty()) continue;
+        const auto size = texture_atlas_builder_t::get_image_size(path);
+        if (!size || size->x > options.atlas_max_texture_size
+            || size->y > options.atlas_max_texture_size)
+            continue;
+
+        if (auto it = packed_textures.find(path); it != packed_textures.end()) {
+            material_entries[material_ix] = it->second;
+            continue;
+        }
+        try {
+            if (auto entry = atlas_builder.add(*texture_atlas_builder_t::load_image(path))) {
+                packed_textures.emplace(path, *entry);
+                material_entries[material_ix] = *entry;
+            }
+        } catch (const image_loading_error& e) {
+            spdlog::warn("Import: texture not atlased: {}", e.what());
+        }
+    }
+    if (atlas_builder.get_atlas_count() == 0) return uv_transforms;
+
+    for (size_t atlas_ix = 0; atlas_ix < atlas_builder.get_atlas_count(); atlas_ix++) {
+        atlas_paths.push_back(scene_file.parent_path()
+                              / fmt::format("{}_atlas_{}.png", scene_file.stem().string(),
+                                            atlas_ix));
+        atlas_builder.write_atlas(atlas_ix, atlas_paths.back());
+    }
+    for (size_t material_ix = 0; material_ix < materials.size(); material_ix++) {
+        if (!material_entries[material_ix]) continue;
+        materials[material_ix].atlas_ix = material_entries[material_ix]->atlas_ix;
+        uv_transforms[material_ix] = material_entries[material_ix]->uv_scale_offset;
+    }
+    spdlog::info("Import: packed {} textures into {} atlases.", packed_textures.size(),
+                 atlas_paths.size());
+    return uv_transforms;
+}
+
+/**
+ * @brief Post-transform cache efficiency of a mesh before and after optimize_mesh.
+ */
+struct mesh_optimization_stats_t
+{
+    size_t triangle_count = 0;
+    size_t vertex_count = 0;
+    math::vertex_cache_stats_t before{};
+    math::vertex_cache_stats_t after{};
+};
+
+/**
+ * @brief Sizes of a mesh before and after convert_mesh.
+ */
+struct mesh_conversion_stats_t
+{
+    size_t source_vertex_count = 0;
+    size_t vertex_count = 0;
+    mesh_optimization_stats_t optimization{};
+};
+
+/**
+ * @brief Reorders triangles for vertex cache efficiency and less overdraw, then vertices in the
+ * order the triangles use them.
+ *
+ * @param vertices interleaved vertices, starting with the position
+ * @param stride number of floats per vertex
+ */
+mesh_optimization_stats_t optimize_mesh(std::vector<float>& vertices, size_t stride,
+                                        std::vector<GLuint>& indices) {
+    mesh_optimization_stats_t stats{indices.size() / 3, vertices.size() / stride};
+    stats.before = math::analyze_vertex_cache(indices, stats.vertex_count);
+    auto clusters = math::optimize_vertex_cache(indices, stats.vertex_count);
+    math::optimize_overdraw(indices, vertices, stride, clusters);
+    stats.vertex_count = math::optimize_vertex_fetch(vertices, stride, indices);
+    stats.after = math::analyze_vertex_cache(indices, stats.vertex_count);
+    return stats;
+}
+
+/**
+ * @brief Maps a direction to the octahedron's faces unfolded onto [-1, 1]^2, see
+ * decode_octahedral in phong.glsl.
+ */
+glm::vec2 encode_octahedral(glm::vec3 direction) {
+    const auto l1_length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (l1_length == 0.0f) return glm::vec2{0.0f};
+    direction /= l1_length;
+    const glm::vec2 octahedral{direction.x, direction.y};
+    if (direction.z >= 0.0f) return octahedral;
+    // the lower half is folded over the diagonals
+    const glm::vec2 sign{octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f};
+    return (1.0f - glm::abs(glm::vec2{octahedral.y, octahedral.x})) * sign;
+}
+
+/**
+ * @brief Packs vertices to 16 bytes: positions normalized to 16 bits relative to the bounding
+ * box, model space normals octahedral encoded in two 16-bit components, UVs normalized to 16
+ * bits, or half floats if they don't lie in [0, 1]. Indices are 16-bit if there are few enough
+ * vertices.
+ *
+ * @param vertices interleaved float positions, normals and, if tex_coords, UVs
+ */
+void pack_compact(primitives::mesh_data_t& mesh, const std::vector<float>& vertices,
+                  bool tex_coords, const std::vector<GLuint>& indices) {
+    const size_t stride = tex_coords ? 8 : 6;
+    const size_t vertex_count = vertices.size() / stride;
+    const auto& [aabb_min, aabb_max] = mesh.aabb;
+    // flat meshes keep a non-zero scale, so the model matrix stays invertible
+    const auto extent = glm::max(aabb_max - aabb_min, glm::vec3{1e-6f});
+    mesh.position_transform = glm::scale(glm::translate(glm::mat4{1.0f}, aabb_min), extent);
+
+    bool unorm_tex_coords = true;
+    for (size_t vertex_ix = 0; tex_coords && vertex_ix < vertex_count; vertex_ix++) {
+        const auto uv = glm::make_vec2(vertices.data() + vertex_ix * stride + 6);
+        if (glm::any(glm::lessThan(uv, glm::vec2{0.0f}))
+            || glm::any(glm::greaterThan(uv, glm::vec2{1.0f}))) {
+            unorm_tex_coords = false;
+            break;
+        }
+    }
+
+    mesh.elements = {{GL_UNSIGNED_SHORT, 4, "position", true},
+                     {GL_SHORT, 2, "normal", true}};
+    if (tex_coords) {
+        if (unorm_tex_coords) {
+            mesh.elements.emplace_back(GL_UNSIGNED_SHORT, 2, "tex_coord", true);
         } else {
-            materials[i] = std::make_shared<phong_material_t>(
-              glm::vec3{diffuse.r, diffuse.g, diffuse.b},
-              glm::vec3{ambient.r, ambient.g, ambient.b},
-              glm::vec3{specular.r, specular.g, specular.b}, shininess, transparency);
+            mesh.elements.emplace_back(GL_HALF_FLOAT, 2, "tex_coord");
         }
     }
-    return materials;
+
+    struct packed_vertex_t
+    {
+        uint64_t position;
+        uint32_t normal;
+        uint32_t tex_coord;
+    };
+    static_assert(sizeof(packed_vertex_t) == 16);
+    const size_t packed_stride = tex_coords ? sizeof(packed_vertex_t) : 12;
+    mesh.vertices.resize(vertex_count * packed_stride);
+    for (size_t vertex_ix = 0; vertex_ix < vertex_count; vertex_ix++) {
+        const float* vertex = vertices.data() + vertex_ix * stride;
+        packed_vertex_t packed{};
+        packed.position
+          = glm::packUnorm4x16(glm::vec4{(glm::make_vec3(vertex) - aabb_min) / extent, 1.0f});
+        // independent of the bounding box, phong.glsl scales them like positions once decoded
+        packed.normal = glm::packSnorm2x16(encode_octahedral(glm::make_vec3(vertex + 3)));
+        if (tex_coords) {
+            const auto uv = glm::make_vec2(vertex + 6);
+            packed.tex_coord = unorm_tex_coords ? glm::packUnorm2x16(uv) : glm::packHalf2x16(uv);
+        }
+        memcpy(mesh.vertices.data() + vertex_ix * packed_stride, &packed, packed_stride);
+    }
+
+    // 0xFFFF is left out, it's the usual primitive restart index
+    if (vertex_count < std::numeric_limits<GLushort>::max()) {
+        mesh.index_type = GL_UNSIGNED_SHORT;
+        mesh.indices.resize(indices.size() * sizeof(GLushort));
+        auto* packed_indices = reinterpret_cast<GLushort*>(mesh.indices.data());
+        for (size_t i = 0; i < indices.size(); i++) {
+            packed_indices[i] = static_cast<GLushort>(indices[i]);
+        }
+    } else {
+        mesh.indices.resize(indices.size() * sizeof(GLuint));
+        memcpy(mesh.indices.data(), indices.data(), mesh.indices.size());
+    }
 }
 
-std::vector<std::pair<std::shared_ptr<primitives::vertex_array_t>, std::pair<glm::vec3, glm::vec3>>>
-  import_meshes(const aiScene* ai_scene) {
-    std::vector<
-      std::pair<std::shared_ptr<primitives::vertex_array_t>, std::pair<glm::vec3, glm::vec3>>>
-      vertex_arrays(ai_scene->mNumMeshes);
-    for (unsigned int i = 0; i < ai_scene->mNumMeshes; i++) {
-        vertex_arrays[i].first = std::make_shared<primitives::vertex_array_t>();
-        auto vertex_buffer = std::make_shared<primitives::vertex_buffer_t>();
-        auto index_buffer = std::make_shared<primitives::index_buffer_t>();
-
-        auto* ai_mesh = ai_scene->mMeshes[i];
-
-        if (!ai_mesh->HasNormals()) throw std::runtime_error("Mesh has no normals!");
-        bool tex_coords = ai_mesh->HasTextureCoords(0);
-
-        /*                            \/ -- position + normals .*/
-        uint8_t floats_per_vertex = (6 + (tex_coords ? 2 : 0));
-        std::vector<float> interleaved_data(floats_per_vertex * ai_mesh->mNumVertices);
-
-        for (size_t vertex_ix = 0; vertex_ix < ai_mesh->mNumVertices; vertex_ix++) {
-            memcpy(interleaved_data.data() + vertex_ix * floats_per_vertex,
-                   &ai_mesh->mVertices[vertex_ix], 3 * sizeof(float));
-            memcpy(interleaved_data.data() + vertex_ix * floats_per_vertex + 3,
-                   &ai_mesh->mNormals[vertex_ix], 3 * sizeof(float));
-            if (tex_coords) {
-                interleaved_data[vertex_ix * floats_per_vertex + 6]
-                  = ai_mesh->mTextureCoords[0][vertex_ix].x;
-                interleaved_data[vertex_ix * floats_per_vertex + 7]
-                  = ai_mesh->mTextureCoords[0][vertex_ix].y;
+/**
+ * @brief Faces of an aiMesh converted into a mesh of their own.
+ */
+struct mesh_cluster_t
+{
+    const aiMesh* ai_mesh;
+    uint32_t first_face;
+    uint32_t face_count;
+};
+
+/**
+ * @brief Splits meshes into clusters of at most cluster_triangle_count faces, a mesh is a single
+ * cluster if it's 0.
+ *
+ * @param first_clusters set to the index of each mesh's first cluster, followed by the cluster
+ * count
+ */
+std::vector<mesh_cluster_t> plan_clusters(const aiScene* ai_scene, uint32_t cluster_triangle_count,
+                                          std::vector<uint32_t>& first_clusters) {
+    std::vector<mesh_cluster_t> clusters{};
+    first_clusters.clear();
+    for (unsigned int mesh_ix = 0; mesh_ix < ai_scene->mNumMeshes; mesh_ix++) {
+        const auto* ai_mesh = ai_scene->mMeshes[mesh_ix];
+        first_clusters.push_back(static_cast<uint32_t>(clusters.size()));
+        const auto cluster_size
+          = cluster_triangle_count == 0 ? ai_mesh->mNumFaces : cluster_triangle_count;
+        uint32_t first_face = 0;
+        do {
+            const auto face_count = std::min(cluster_size, ai_mesh->mNumFaces - first_face);
+            clusters.push_back({ai_mesh, first_face, face_count});
+            first_face += face_count;
+        } while (first_face < ai_mesh->mNumFaces);
+    }
+    first_clusters.push_back(static_cast<uint32_t>(clusters.size()));
+    return clusters;
+}
+
+/**
+ * @brief Converts a cluster of an aiMesh to interleaved vertex data and indices, with only the
+ * vertices the cluster uses. Doesn't touch OpenGL.
+ *
+ * @param stats set to the cluster's sizes, and cache efficiency if it's optimized
+ */
+primitives::mesh_data_t convert_mesh(const mesh_cluster_t& cluster, const glm::vec4& uv_transform,
+                                     const import_options_t& options,
+                                     mesh_conversion_stats_t& stats) {
+    const auto* ai_mesh = cluster.ai_mesh;
+    if (!ai_mesh->HasNormals()) throw std::runtime_error("Mesh has no normals!");
+    bool tex_coords = ai_mesh->HasTextureCoords(0);
+
+    // a whole mesh keeps its vertex order, clusters are remapped to the vertices they use
+    const bool whole_mesh = cluster.face_count == ai_mesh->mNumFaces;
+    std::vector<uint32_t> source_vertices{};
+    std::unordered_map<uint32_t, uint32_t> cluster_vertices{};
+    std::vector<GLuint> indices(static_cast<size_t>(cluster.face_count) * 3);
+    for (uint32_t face_ix = 0; face_ix < cluster.face_count; face_ix++) {
+        const auto& face = ai_mesh->mFaces[cluster.first_face + face_ix];
+        debug_assert(face.mNumIndices == 3, "Sorry to say bro... Non triangular mesh :(");
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            auto& index = indices[face_ix * 3 + corner];
+            if (whole_mesh) {
+                index = face.mIndices[corner];
+                continue;
             }
+            auto [it, inserted] = cluster_vertices.try_emplace(
+              face.mIndices[corner], static_cast<uint32_t>(source_vertices.size()));
+            if (inserted) source_vertices.push_back(face.mIndices[corner]);
+            index = it->second;
+        }
+    }
+    if (whole_mesh) {
+        source_vertices.resize(ai_mesh->mNumVertices);
+        std::iota(source_vertices.begin(), source_vertices.end(), 0);
+    }
+
+    /*                            \/ -- position + normals .*/
+    uint8_t floats_per_vertex = (6 + (tex_coords ? 2 : 0));
+    std::vector<float> vertices(floats_per_vertex * source_vertices.size());
+
+    for (size_t vertex_ix = 0; vertex_ix < source_vertices.size(); vertex_ix++) {
+        const auto source_ix = source_vertices[vertex_ix];
+        memcpy(vertices.data() + vertex_ix * floats_per_vertex, &ai_mesh->mVertices[source_ix],
+               3 * sizeof(float));
+        memcpy(vertices.data() + vertex_ix * floats_per_vertex + 3, &ai_mesh->mNormals[source_ix],
+               3 * sizeof(float));
+        if (tex_coords) {
+            vertices[vertex_ix * floats_per_vertex + 6]
+              = ai_mesh->mTextureCoords[0][source_ix].x * uv_transform.x + uv_transform.z;
+            vertices[vertex_ix * floats_per_vertex + 7]
+              = ai_mesh->mTextureCoords[0][source_ix].y * uv_transform.y + uv_transform.w;
         }
+    }
+    stats.source_vertex_count = source_vertices.size();
+    if (options.weld_vertices) {
+        std::vector<float> epsilons(3, options.weld_position_epsilon);
+        epsilons.resize(6, options.weld_normal_epsilon);
+        epsilons.resize(floats_per_vertex, options.weld_uv_epsilon);
+        math::weld_vertices(vertices, floats_per_vertex, indices, epsilons);
+    }
+    if (options.optimize_meshes) {
+        stats.optimization = optimize_mesh(vertices, floats_per_vertex, indices);
+    }
+    stats.vertex_count = vertices.size() / floats_per_vertex;
 
-        vertex_buffer->set_data(interleaved_data.size() * sizeof(float), interleaved_data.data());
+    primitives::mesh_data_t mesh{};
+    mesh.material_ix = ai_mesh->mMaterialIndex;
+    mesh.aabb = math::calc_aabb(vertices.data(), vertices.size() / floats_per_vertex,
+                                floats_per_vertex);
+    if (options.compact_vertices) {
+        pack_compact(mesh, vertices, tex_coords, indices);
+        return mesh;
+    }
 
-        auto layout = primitives::buffer_layout_t( // INTERLEAVED!!!
-          tex_coords
-            ? std::initializer_list<primitives::buffer_element_t>{{GL_FLOAT, 3, "position"},
-                                                                  {GL_FLOAT, 3, "normal"},
-                                                                  {GL_FLOAT, 2, "tex_coord"}}
-            : std::initializer_list<primitives::buffer_element_t>{{GL_FLOAT, 3, "position"},
-                                                                  {GL_FLOAT, 3, "normal"}},
-          std::make_shared<phong_material_t>());
+    mesh.elements = {{GL_FLOAT, 3, "position"}, {GL_FLOAT, 3, "normal"}};
+    if (tex_coords) mesh.elements.emplace_back(GL_FLOAT, 2, "tex_coord");
+    mesh.vertices.resize(vertices.size() * sizeof(float));
+    memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+    mesh.indices.resize(indices.size() * sizeof(GLuint));
+    memcpy(mesh.indices.data(), indices.data(), mesh.indices.size());
+    return mesh;
+}
 
-        std::vector<GLuint> indices(ai_mesh->mNumFaces * 3);
-        for (unsigned int face_ix = 0; face_ix < ai_mesh->mNumFaces; face_ix++) {
-            debug_assert(ai_mesh->mFaces[face_ix].mNumIndices == 3,
-                         "Sorry to say bro... Non triangular mesh :(");
-            memcpy(indices.data() + (face_ix * 3), ai_mesh->mFaces[face_ix].mIndices,
-                   3 * sizeof(GLuint));
+/**
+ * @brief Logs the totals of the conversion stats of all clusters.
+ */
+void log_conversion_stats(const std::vector<mesh_conversion_stats_t>& stats,
+                          const import_options_t& options) {
+    if (options.weld_vertices) {
+        size_t source_vertex_count = 0, vertex_count = 0;
+        for (const auto& mesh_stats : stats) {
+            source_vertex_count += mesh_stats.source_vertex_count;
+            vertex_count += mesh_stats.vertex_count;
+        }
+        spdlog::info("Import: welding left {} of {} vertices.", vertex_count,
+                     source_vertex_count);
+    }
+    if (options.optimize_meshes) {
+        // totals over all meshes, weighted by their size
+        size_t triangle_count = 0, vertex_count = 0;
+        float misses_before = 0.0f, misses_after = 0.0f;
+        for (const auto& conversion_stats : stats) {
+            const auto& mesh_stats = conversion_stats.optimization;
+            triangle_count += mesh_stats.triangle_count;
+            vertex_count += mesh_stats.vertex_count;
+            misses_before += mesh_stats.before.acmr * static_cast<float>(mesh_stats.triangle_count);
+            misses_after += mesh_stats.after.acmr * static_cast<float>(mesh_stats.triangle_count);
         }
-        index_buffer->set_data(indices);
+        if (triangle_count > 0 && vertex_count > 0) {
+            spdlog::info("Import: vertex cache optimized, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> "
+                         "{:.3f}.",
+                         misses_before / static_cast<float>(triangle_count),
+                         misses_after / static_cast<float>(triangle_count),
+                         misses_before / static_cast<float>(vertex_count),
+                         misses_after / static_cast<float>(vertex_count));
+        }
+    }
+}
+
+/**
+ * @brief Converts a cluster on the global pool.
+ */
+std::future<primitives::mesh_data_t>
+  submit_conversion(const mesh_cluster_t& cluster, const std::vector<glm::vec4>& uv_transforms,
+                    const import_options_t& options, mesh_conversion_stats_t& stats,
+                    std::atomic<uint32_t>& converted_count) {
+    return thread_pool_t::get_global().submit(
+      [&cluster, &uv_transform = uv_transforms[cluster.ai_mesh->mMaterialIndex], &options,
+       &stats, &converted_count]() {
+          auto mesh = convert_mesh(cluster, uv_transform, options, stats);
+          converted_count++;
+          return mesh;
+      });
+}
+
+/**
+ * @brief Converts all clusters, one task per cluster on the global pool since mesh sizes vary a
+ * lot. Doesn't touch OpenGL.
+ *
+ * @param converted_count incremented as clusters are converted
+ */
+std::vector<primitives::mesh_data_t> convert_meshes(const std::vector<mesh_cluster_t>& clusters,
+                                                    const std::vector<glm::vec4>& uv_transforms,
+                                                    const import_options_t& options,
+                                                    std::atomic<uint32_t>& converted_count) {
+    std::vector<std::future<primitives::mesh_data_t>> conversions{};
+    std::vector<mesh_conversion_stats_t> stats(clusters.size());
+    conversions.reserve(clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++) {
+        conversions.push_back(
+          submit_conversion(clusters[i], uv_transforms, options, stats[i], converted_count));
+    }
+    // the tasks reference ai_scene, so wait for all of them before rethrowing
+    for (auto& conversion : conversions) conversion.wait();
+
+    std::vector<primitives::mesh_data_t> meshes{};
+    meshes.reserve(conversions.size());
+    for (auto& conversion : conversions) meshes.push_back(conversion.get());
+    log_conversion_stats(stats, options);
+    return meshes;
+}
 
-        vertex_arrays[i].first->add_vertex_buffer(
-          vertex_buffer, std::make_shared<primitives::buffer_layout_t>(layout));
-        vertex_arrays[i].first->set_index_buffer(index_buffer);
-        vertex_arrays[i].second = math::calc_aabb(&(ai_scene->mMeshes[i]->mVertices[0].x),
-                                                  ai_scene->mMeshes[i]->mNumVertices);
+/**
+ * @brief Converts clusters straight into the .pgmesh cache, only a few per pool thread at a
+ * time, so memory use doesn't grow with mesh size. Doesn't touch OpenGL.
+ *
+ * @param scene everything but the meshes, written with them
+ * @param converted_count incremented as clusters are converted
+ * @throws std::runtime_error if writing the cache or converting fails.
+ */
+void stream_meshes_to_cache(const imported_scene_t& scene, const std::filesystem::path& cache_path,
+                            const std::filesystem::path& scene_file,
+                            const std::vector<mesh_cluster_t>& clusters,
+                            const std::vector<glm::vec4>& uv_transforms,
+                            const import_options_t& options,
+                            std::atomic<uint32_t>& converted_count) {
+    const size_t max_in_flight = 2 * thread_pool_t::get_global().get_thread_count();
+    std::vector<mesh_conversion_stats_t> stats(clusters.size());
+    std::deque<std::future<primitives::mesh_data_t>> in_flight{};
+    size_t next_cluster = 0;
+    try {
+        scene.write(cache_path, scene_file, clusters.size(), [&](size_t mesh_ix) {
+            for (; next_cluster < clusters.size() && next_cluster < mesh_ix + max_in_flight;
+                 next_cluster++) {
+                in_flight.push_back(submit_conversion(clusters[next_cluster], uv_transforms,
+                                                      options, stats[next_cluster],
+                                                      converted_count));
+            }
+            auto conversion = std::move(in_flight.front());
+            in_flight.pop_front();
+            return conversion.get();
+        });
+    } catch (...) {
+        // the tasks reference clusters and stats
+        for (auto& conversion : in_flight) conversion.wait();
+        throw;
     }
-    return vertex_arrays;
+    log_conversion_stats(stats, options);
+}
+
+/**
+ * @brief Whether two meshes can share a vertex array, materials aside.
+ */
+bool same_geometry(const primitives::mesh_view_t& lhs, const primitives::mesh_view_t& rhs) {
+    const auto same_element = [](const auto& lhs_element, const auto& rhs_element) {
+        return lhs_element.glsl_name == rhs_element.glsl_name
+               && lhs_element.type == rhs_element.type
+               && lhs_element.items_per_vertex == rhs_element.items_per_vertex
+               && lhs_element.normalize == rhs_element.normalize;
+    };
+    return lhs.index_type == rhs.index_type && lhs.position_transform == rhs.position_transform
+           && std::ranges::equal(lhs.elements, rhs.elements, same_element)
+           && std::ranges::equal(lhs.vertices, rhs.vertices)
+           && std::ranges::equal(lhs.indices, rhs.indices);
 }
 
-void import_lights(const aiScene* ai_scene, scene_t* scene, entt::registry& registry) {
+/**
+ * @brief Finds meshes with the same geometry as an earlier mesh, by content hash, points their
+ * imported_scene_t::geometry_sources at it and releases their data.
+ */
+void deduplicate_meshes(imported_scene_t& scene) {
+    std::unordered_map<uint64_t, std::vector<uint32_t>> meshes_by_hash{};
+    size_t duplicate_count = 0;
+    size_t saved_bytes = 0;
+    for (uint32_t mesh_ix = 0; mesh_ix < scene.meshes.size(); mesh_ix++) {
+        const auto& mesh = scene.meshes[mesh_ix];
+        auto hash = hash_bytes(mesh.vertices.data(), mesh.vertices.size());
+        hash = hash_bytes(mesh.indices.data(), mesh.indices.size(), hash);
+        auto& candidates = meshes_by_hash[hash];
+        auto source = std::ranges::find_if(candidates, [&](uint32_t candidate) {
+            return same_geometry(scene.meshes[candidate], mesh);
+        });
+        if (source == candidates.end()) {
+            candidates.push_back(mesh_ix);
+            continue;
+        }
+        scene.geometry_sources[mesh_ix] = *source;
+        duplicate_count++;
+        saved_bytes += mesh.vertices.size() + mesh.indices.size();
+        scene.release_mesh_data(mesh_ix);
+    }
+    if (duplicate_count > 0) {
+        spdlog::info("Import: {} meshes duplicate the geometry of others and share their vertex "
+                     "arrays, saving {} KiB.",
+                     duplicate_count, saved_bytes / 1024);
+    }
+}
+
+std::vector<imported_light_t> import_lights(const aiScene* ai_scene) {
+    std::vector<imported_light_t> lights{};
     for (unsigned int i = 0; i < ai_scene->mNumLights; i++) {
         auto* ai_light = ai_scene->mLights[i];
+        imported_light_t light{};
+        switch (ai_light->mType) {
+            case aiLightSource_DIRECTIONAL: light.type = imported_light_t::type_t::sun; break;
+            case aiLightSource_POINT: light.type = imported_light_t::type_t::point; break;
+            case aiLightSource_SPOT: light.type = imported_light_t::type_t::spot; break;
+            default: spdlog::warn("Trying to import unsupported light type."); continue;
+        }
+        light.node_name = ai_light->mName.C_Str();
+        light.ambient = vec3_cast(ai_light->mColorAmbient);
+        light.diffuse = vec3_cast(ai_light->mColorDiffuse);
+        light.specular = vec3_cast(ai_light->mColorSpecular);
+        light.direction = vec3_cast(ai_light->mDirection);
+        light.attenuation = glm::vec3{ai_light->mAttenuationConstant, ai_light->mAttenuationLinear,
+                                      ai_light->mAttenuationQuadratic};
+        light.outer_cone_angle = ai_light->mAngleOuterCone;
+        light.inner_cone_angle = ai_light->mAngleInnerCone;
+        lights.push_back(std::move(light));
+    }
+    return lights;
+}
+
+void add_lights(const std::vector<imported_light_t>& lights, scene_t* scene,
+                entt::registry& registry) {
+    for (const auto& light : lights) {
         auto named = registry.view<component::tag_t>();
         entt::entity light_owner = entt::null;
         for (auto entity : named) {
-            if (registry.get<component::tag_t>(entity).tag == ai_light->mName.C_Str()) {
+            if (registry.get<component::tag_t>(entity).tag == light.node_name) {
                 light_owner = entity;
                 break;
             }
         }
         debug_assert(light_owner != entt::null, "Each light was supposed to have a node...");
         auto light_entity = entity_t{light_owner, scene};
-        switch (ai_light->mType) {
-            case aiLightSource_DIRECTIONAL:
+        switch (light.type) {
+            case imported_light_t::type_t::sun:
                 light_entity.add_component<component::sun_light_t>(
-                  vec3_cast(ai_light->mColorAmbient), vec3_cast(ai_light->mColorDiffuse),
-                  vec3_cast(ai_light->mColorSpecular), vec3_cast(ai_light->mDirection));
+                  light.ambient, light.diffuse, light.specular, light.direction);
                 break;
-            case aiLightSource_POINT:
+            case imported_light_t::type_t::point:
                 light_entity.add_component<component::point_light_t>(
-                  vec3_cast(ai_light->mColorAmbient), vec3_cast(ai_light->mColorDiffuse),
-                  vec3_cast(ai_light->mColorSpecular),
-                  glm::vec3{ai_light->mAttenuationConstant, ai_light->mAttenuationLinear,
-                            ai_light->mAttenuationQuadratic});
+                  light.ambient, light.diffuse, light.specular, light.attenuation);
                 break;
-            case aiLightSource_SPOT:
+            case imported_light_t::type_t::spot:
                 light_entity.add_component<component::spot_light_t>(
-                  vec3_cast(ai_light->mColorAmbient), vec3_cast(ai_light->mColorDiffuse),
-                  vec3_cast(ai_light->mColorSpecular), vec3_cast(ai_light->mDirection),
-                  ai_light->mAngleOuterCone,
-                  0.5f * (ai_light->mAngleOuterCone / ai_light->mAngleInnerCone),
-                  glm::vec3{ai_light->mAttenuationConstant, ai_light->mAttenuationLinear,
-                            ai_light->mAttenuationQuadratic});
-                break;
-            default:
-                light_entity.destroy();
-                spdlog::warn("Trying to import unsupported light type.");
+                  light.ambient, light.diffuse, light.specular, light.direction,
+                  light.outer_cone_angle, 0.5f * (light.outer_cone_angle / light.inner_cone_angle),
+                  light.attenuation);
                 break;
         }
     }
 }
 
 void add_mesh_and_bb_components(
-  scene_t& scene, entity_t& target, aiNode* ai_node,
-  std::vector<std::shared_ptr<phong_material_t>>& materials,
-  std::vector<std::pair<std::shared_ptr<primitives::vertex_array_t>,
-                        std::pair<glm::vec3, glm::vec3>>>& vertex_arrays,
-  const aiScene* ai_scene) {
-    if (ai_node->mNumMeshes >= 1) {
-        auto vao_arr_ix = ai_node->mMeshes[0];
-
-        target.add_component<component::mesh_t>(
-          vertex_arrays[vao_arr_ix].first,
-          materials[ai_scene->mMeshes[vao_arr_ix]->mMaterialIndex]);
-        target.add_component<component::bounding_box_t>(vertex_arrays[vao_arr_ix].second);
-    }
-    for (auto mesh_ix = 1; mesh_ix < ai_node->mNumMeshes; mesh_ix++) {
+  scene_t& scene, entity_t& target, const imported_node_t& node,
+  const std::vector<material_ref_t>& materials,
+  const std::vector<asset_ref_t<primitives::vertex_array_t>>& vertex_arrays,
+  const std::vector<primitives::mesh_view_t>& meshes) {
+    if (!node.mesh_indices.empty()) {
+        auto vao_arr_ix = node.mesh_indices[0];
+
+        target.add_component<component::mesh_t>(vertex_arrays[vao_arr_ix],
+                                                 materials[meshes[vao_arr_ix].material_ix]);
+        target.add_component<component::bounding_box_t>(meshes[vao_arr_ix].aabb);
+    }
+    for (size_t mesh_ix = 1; mesh_ix < node.mesh_indices.size(); mesh_ix++) {
         auto sub_entity
           = scene.create_entity(fmt::format("{}__sub_mesh_{}", target.get_name(), mesh_ix));
         target.add_child(sub_entity);
-        auto vao_arr_ix = ai_node->mMeshes[mesh_ix];
+        auto vao_arr_ix = node.mesh_indices[mesh_ix];
 
-        sub_entity.add_component<component::mesh_t>(
-          vertex_arrays[vao_arr_ix].first,
-          materials[ai_scene->mMeshes[vao_arr_ix]->mMaterialIndex]);
-        sub_entity.add_component<component::bounding_box_t>(vertex_arrays[vao_arr_ix].second);
+        sub_entity.add_component<component::mesh_t>(vertex_arrays[vao_arr_ix],
+                                                     materials[meshes[vao_arr_ix].material_ix]);
+        sub_entity.add_component<component::bounding_box_t>(meshes[vao_arr_ix].aabb);
     }
 }
 
-std::optional<entity_t> scene_t::import_from_file(const std::filesystem::path& scene_file) {
-    static Assimp::Importer importer;
-    importer.SetPropertyInteger(AI_CONFIG_PP_PTV_NORMALIZE, 1);
+/**
+ * @brief Looks up assets registered by an earlier import.
+ *
+ * @param import_key key of the imported file and import options
+ * @param kind asset kind, part of the asset keys
+ * @param count number of assets of this kind in the file
+ * @return std::optional<std::vector<asset_ref_t<AssetTy>>> the assets, nullopt unless all of
+ * them are still alive.
+ */
+template<typename AssetTy>
+std::optional<std::vector<asset_ref_t<AssetTy>>>
+  find_imported_assets(const std::string& import_key, std::string_view kind, size_t count) {
+    std::vector<asset_ref_t<AssetTy>> assets(count);
+    for (size_t i = 0; i < count; i++) {
+        assets[i] = asset_registry_t::get().find_ref<AssetTy>(
+          fmt::format("{}/{}/{}", import_key, kind, i));
+        if (!assets[i]) return std::nullopt;
+    }
+    return assets;
+}
 
-    const aiScene* ai_scene
-      = importer.ReadFile(scene_file.string(), aiProcess_Triangulate | aiProcess_GenSmoothNormals
-                                                 | aiProcess_GenUVCoords);
+/**
+ * @brief Registers imported assets, replacing them with equivalent ones that are still alive.
+ */
+template<typename AssetTy>
+void register_imported_asset(const std::string& import_key, std::string_view kind, size_t ix,
+                             asset_ref_t<AssetTy>& asset) {
+    asset = asset_registry_t::get().get_or_create_ref<AssetTy>(
+      fmt::format("{}/{}/{}", import_key, kind, ix), [&asset]() { return asset; });
+}
 
-    // abort if the loader fails
-    if (ai_scene == NULL) {
-        spdlog::error("Scene/object failed: {}", importer.GetErrorString());
-        return std::nullopt;
+import_job_t::import_job_t(scene_t& scene, std::filesystem::path scene_file,
+                           import_options_t options)
+  : _scene(&scene), _scene_file(std::move(scene_file)), _options(options) {}
+
+import_job_t::import_job_t(std::filesystem::path scene_file, import_options_t options)
+  : _scene(nullptr), _scene_file(std::move(scene_file)), _options(options) {}
+
+import_job_t::~import_job_t() = default;
+
+std::unique_ptr<import_job_t::prepared_t> import_job_t::prepare() {
+    auto prepared = std::make_unique<prepared_t>();
+    auto& scene = prepared->scene;
+    const auto options_key
+      = fmt::format("{}:{}:{}:{}:{}:{}:{}:{}:{}:{}:{}:{}:{}", _options.compress_textures,
+                    _options.build_texture_atlases, _options.atlas_max_texture_size,
+                    _options.atlas_size, _options.atlas_padding, _options.optimize_meshes,
+                    _options.compact_vertices, _options.weld_vertices,
+                    _options.weld_position_epsilon, _options.weld_normal_epsilon,
+                    _options.weld_uv_epsilon, _options.deduplicate_meshes,
+                    _options.cluster_triangle_count);
+    const auto cache_path = imported_scene_t::get_cache_path(_scene_file);
+
+    if (is_gltf(_scene_file)) {
+        // already in a GPU friendly layout, so neither processed nor cached
+        scene = import_gltf(_scene_file);
+        scene.source_key = asset_registry_t::get().get_file_key(_scene_file);
+        scene.options_key = options_key;
+    } else if (auto cached = imported_scene_t::read(cache_path, _scene_file, options_key)) {
+        scene = std::move(*cached);
+    } else {
+        // freed with the aiScene once converted
+        Assimp::Importer importer{};
+        // the importer takes ownership
+        importer.SetIOHandler(new vfs_io_system_t{});
+        importer.SetPropertyInteger(AI_CONFIG_PP_PTV_NORMALIZE, 1);
+        const aiScene* ai_scene = importer.ReadFile(
+          _scene_file.string(),
+          aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_GenUVCoords);
+
+        // abort if the loader fails
+        if (ai_scene == nullptr) {
+            throw std::runtime_error(
+              fmt::format("Scene/object failed: {}", importer.GetErrorString()));
+        }
+        _mesh_count = ai_scene->mNumMeshes;
+        prepared->converted = true;
+
+        scene.source_key = asset_registry_t::get().get_file_key(_scene_file);
+        scene.options_key = options_key;
+        import_nodes(ai_scene->mRootNode, imported_node_t::no_parent, scene.nodes);
+        scene.embedded_textures = import_embedded_textures(ai_scene);
+        scene.materials = import_materials(ai_scene, _scene_file);
+        auto uv_transforms = _options.build_texture_atlases
+                               ? build_texture_atlases(ai_scene, _scene_file, _options,
+                                                       scene.materials, scene.atlas_paths)
+                               : std::vector<glm::vec4>(scene.materials.size(),
+                                                        glm::vec4{1.0f, 1.0f, 0.0f, 0.0f});
+        std::vector<uint32_t> first_clusters{};
+        const auto clusters
+          = plan_clusters(ai_scene, _options.cluster_triangle_count, first_clusters);
+        assign_clusters(scene.nodes, first_clusters);
+        _mesh_count = static_cast<uint32_t>(clusters.size());
+        scene.lights = import_lights(ai_scene);
+
+        std::optional<imported_scene_t> streamed{};
+        if (_options.stream_meshes) {
+            try {
+                stream_meshes_to_cache(scene, cache_path, _scene_file, clusters, uv_transforms,
+                                       _options, _converted_mesh_count);
+                // meshes are uploaded from the mapped cache
+                importer.FreeScene();
+                streamed = imported_scene_t::read(cache_path, _scene_file, options_key);
+                if (!streamed) throw std::runtime_error("the written cache can't be read");
+            } catch (const std::runtime_error& e) {
+                spdlog::warn("Failed to stream meshes through the cache, converting them in "
+                             "memory: {}",
+                             e.what());
+                if (!importer.GetScene()) throw;
+                _converted_mesh_count = 0;
+            }
+        }
+        if (streamed) {
+            scene = std::move(*streamed);
+        } else {
+            scene.set_mesh_data(
+              convert_meshes(clusters, uv_transforms, _options, _converted_mesh_count));
+            if (_options.deduplicate_meshes) deduplicate_meshes(scene);
+            try {
+                scene.write(cache_path, _scene_file);
+            } catch (const std::runtime_error& e) {
+                spdlog::warn("Failed to cache imported meshes: {}", e.what());
+                prepared->cache_error = e.what();
+            }
+            // decoded only once it's known the assets of an earlier import can't be reused
+            own_embedded_textures(scene);
+        }
+    }
+    _mesh_count = static_cast<uint32_t>(scene.meshes.size());
+    _converted_mesh_count = static_cast<uint32_t>(scene.meshes.size());
+    _node_count = static_cast<uint32_t>(scene.nodes.size());
+
+    // importing an unchanged file with the same options again shares the GPU resources
+    prepared->import_key = fmt::format("{}:{}", scene.source_key, scene.options_key);
+    return prepared;
+}
+
+void import_job_t::start_creating_assets() {
+    auto& prepared = *_prepared;
+    auto reused_materials = find_imported_assets<material_variant_t>(
+      prepared.import_key, "material", prepared.scene.materials.size());
+    auto reused_vertex_arrays = find_imported_assets<primitives::vertex_array_t>(
+      prepared.import_key, "mesh", prepared.scene.meshes.size());
+    if (reused_materials && reused_vertex_arrays) {
+        spdlog::info("Import: reusing assets of an earlier import of {}.", _scene_file.string());
+        _materials = std::move(*reused_materials);
+        _vertex_arrays = std::move(*reused_vertex_arrays);
+        prepared.scene.atlas_paths.clear();
+        prepared.scene.embedded_textures.clear();
+        prepared.reused = true;
+    } else if (!prepared.scene.embedded_textures.empty()) {
+        // decoding waits for tasks on the global pool, so can't run on it
+        prepared.decoding
+          = get_import_pool().submit([&textures = prepared.scene.embedded_textures,
+                                      compress = _options.compress_textures]() {
+                return decode_embedded_textures(textures, compress);
+            });
     }
+    _stage = stage_t::creating_assets;
+}
 
-    debug_assert(ai_scene->mNumTextures == 0, "Sorry bro, embedded textures - no can do...");
+void import_job_t::create_next_asset() {
+    auto& prepared = *_prepared;
+    auto& scene = prepared.scene;
+    if (_atlases.size() < scene.atlas_paths.size()) {
+        // an identical atlas written by an earlier import is reused
+        _atlases.push_back(asset_registry_t::get().get_texture2D(
+          scene.atlas_paths[_atlases.size()], GL_LINEAR, GL_LINEAR, _options.compress_textures));
+    } else if (_embedded_textures.size() < scene.embedded_textures.size()) {
+        if (prepared.decoding.valid()) {
+            prepared.embedded_textures = prepared.decoding.get();
+            prepared.decoding = {};
+        }
+        auto& decoded = prepared.embedded_textures[_embedded_textures.size()];
+        std::shared_ptr<texture2D_t> texture{nullptr};
+        if (decoded.cooked) {
+            texture = std::make_shared<texture2D_t>(*decoded.cooked, GL_LINEAR, GL_LINEAR);
+        } else if (decoded.pixels) {
+            texture = std::make_shared<texture2D_t>(decoded.pixels.get(), decoded.width,
+                                                    decoded.height, decoded.alpha, GL_LINEAR,
+                                                    GL_LINEAR);
+        } else if (!decoded.texels.empty()) {
+            texture = std::make_shared<texture2D_t>(decoded.texels.data(), decoded.width,
+                                                    decoded.height, GL_LINEAR, GL_LINEAR);
+        }
+        _embedded_textures.push_back(std::move(texture));
+        decoded = {};
+    } else if (_materials.size() < scene.materials.size()) {
+        const auto& imported = scene.materials[_materials.size()];
+        std::shared_ptr<texture2D_t> color_texture{nullptr};
+        if (imported.atlas_ix) {
+            color_texture = _atlases[*imported.atlas_ix];
+        } else if (imported.embedded_texture_ix) {
+            color_texture = _embedded_textures[*imported.embedded_texture_ix];
+        } else if (!imported.color_texture_path.empty()) {
+            // materials referencing the same file share the texture
+            color_texture = asset_registry_t::get().get_texture2D(
+              imported.color_texture_path, GL_LINEAR, GL_LINEAR, _options.compress_textures);
+        }
+        if (color_texture) {
+            _materials.push_back(make_material<phong_material_t>(
+              std::move(color_texture), imported.diffuse, imported.ambient, imported.specular,
+              imported.shininess, imported.transparency));
+        } else {
+            _materials.push_back(make_material<phong_material_t>(
+              imported.diffuse, imported.ambient, imported.specular, imported.shininess,
+              imported.transparency));
+        }
+    } else if (_vertex_arrays.size() < scene.meshes.size()) {
+        const auto mesh_ix = _vertex_arrays.size();
+        if (const auto source_ix = scene.geometry_sources[mesh_ix]; source_ix != mesh_ix) {
+            _vertex_arrays.push_back(_vertex_arrays[source_ix]);
+        } else {
+            _vertex_arrays.push_back(
+              scene.meshes[mesh_ix].upload(phong_material_t::get_shader_s()));
+            scene.release_mesh_data(mesh_ix);
+        }
+    } else {
+        if (!prepared.reused) {
+            for (size_t i = 0; i < _materials.size(); i++) {
+                register_imported_asset(prepared.import_key, "material", i, _materials[i]);
+            }
+            for (size_t i = 0; i < _vertex_arrays.size(); i++) {
+                register_imported_asset(prepared.import_key, "mesh", i, _vertex_arrays[i]);
+            }
+        }
+        hot_reloader_t::get().track_import(_scene_file, _options, _vertex_arrays);
+        _stage = stage_t::creating_entities;
+    }
+}
 
-    auto materials = import_materials(ai_scene, scene_file);
-    auto vertex_arrays = import_meshes(ai_scene);
+void import_job_t::create_next_entity() {
+    auto& scene = _prepared->scene;
+    if (_node_entities.size() < scene.nodes.size()) {
+        const auto& node = scene.nodes[_node_entities.size()];
+        auto entity = _scene->create_entity(node.name, node.transform);
+        if (node.parent_ix == imported_node_t::no_parent) {
+            if (_root == entt::null) _root = entity.handle;
+        } else {
+            _scene->get_entity_helper(_node_entities[node.parent_ix]).add_child(entity);
+        }
+        add_mesh_and_bb_components(*_scene, entity, node, _materials, _vertex_arrays,
+                                   scene.meshes);
+        _node_entities.push_back(entity.handle);
+    }
 
-    // Create entities and scene graph
-    auto* ai_root = ai_scene->mRootNode;
-    entity_t root = this->create_entity(ai_root->mName.C_Str(), glm::mat4{1});
-    if (ai_root->mNumMeshes != 0) {
-        root.add_component<component::mesh_t>(
-          vertex_arrays[ai_root->mMeshes[0]].first,
-          materials[ai_scene->mMeshes[ai_root->mMeshes[0]]->mMaterialIndex]);
-        root.add_component<component::bounding_box_t>(vertex_arrays[ai_root->mMeshes[0]].second);
+    if (_node_entities.size() == scene.nodes.size()) {
+        // Has to be after hieararchy is created, as we add lights to existing entities.
+        add_lights(scene.lights, _scene, _scene->_registry);
+        _prepared.reset();
+        _atlases.clear();
+        _embedded_textures.clear();
+        _materials.clear();
+        _vertex_arrays.clear();
+        _stage = stage_t::done;
     }
+}
 
-    for (unsigned int child_ix = 0; child_ix < ai_root->mNumChildren; child_ix++) {
-        hierarchy_import_rec(root, ai_root->mChildren[child_ix], materials, vertex_arrays,
-                             ai_scene);
+bool import_job_t::process(std::chrono::steady_clock::time_point deadline) {
+    try {
+        if (_stage == stage_t::reading) {
+            if (!_prepared) {
+                if (_preparing.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+                    return false;
+                _prepared = _preparing.get();
+                _preparing = {};
+            }
+            start_creating_assets();
+        }
+        while (_stage == stage_t::creating_assets && std::chrono::steady_clock::now() < deadline) {
+            // only synchronous imports block on the embedded textures
+            auto& decoding = _prepared->decoding;
+            if (deadline != std::chrono::steady_clock::time_point::max() && decoding.valid()
+                && decoding.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+                break;
+            create_next_asset();
+        }
+        while (_stage == stage_t::creating_entities
+               && std::chrono::steady_clock::now() < deadline) {
+            create_next_entity();
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Import of {} failed: {}", _scene_file.string(), e.what());
+        _prepared.reset();
+        _stage = stage_t::failed;
     }
+    return is_done();
+}
 
-    // Has to be after hieararchy is created, as we add lights to existing entities.
-    import_lights(ai_scene, this, _registry);
+float import_job_t::get_progress() const {
+    // rough weights of the stages
+    constexpr float reading_weight = 0.5f;
+    constexpr float assets_weight = 0.3f;
+    const auto fraction = [](size_t done, size_t total) {
+        return total == 0 ? 1.0f : static_cast<float>(done) / static_cast<float>(total);
+    };
+    switch (_stage) {
+        case stage_t::reading: return reading_weight * fraction(_converted_mesh_count, _mesh_count);
+        case stage_t::creating_assets: {
+            const auto& scene = _prepared->scene;
+            return reading_weight
+                   + assets_weight
+                       * fraction(_atlases.size() + _embedded_textures.size()
+                                    + _materials.size() + _vertex_arrays.size(),
+                                  scene.atlas_paths.size() + scene.embedded_textures.size()
+                                    + scene.materials.size() + scene.meshes.size());
+        }
+        case stage_t::creating_entities:
+            return reading_weight + assets_weight
+                   + (1.0f - reading_weight - assets_weight)
+                       * fraction(_node_entities.size(), _node_count);
+        default: return 1.0f;
+    }
+}
+
+bool import_job_t::cook(const std::filesystem::path& scene_file, const import_options_t& options) {
+    // read in place at runtime
+    if (is_gltf(scene_file)) return false;
+    import_job_t job{scene_file, options};
+    const auto prepared = job.prepare();
+    if (!prepared->converted) return false;
+    // a cache of an earlier cook may still exist
+    if (prepared->cache_error)
+        throw std::runtime_error(
+          fmt::format("Failed to cache {}: {}", scene_file.string(), *prepared->cache_error));
+    return true;
+}
 
-    return root;
+std::shared_ptr<import_job_t> import_job_t::start_reimport(const std::filesystem::path& scene_file,
+                                                           const import_options_t& options) {
+    // the constructor without a scene is private
+    std::shared_ptr<import_job_t> job{new import_job_t{scene_file, options}};
+    job->_preparing = get_import_pool().submit(
+      [weak_job = std::weak_ptr{job}]() -> std::unique_ptr<prepared_t> {
+          auto job = weak_job.lock();
+          if (!job) return nullptr;
+          return job->prepare();
+      });
+    return job;
 }
 
-void scene_t::hierarchy_import_rec(
-  entity_t& parent, aiNode* ai_node, std::vector<std::shared_ptr<phong_material_t>>& materials,
-  std::vector<std::pair<std::shared_ptr<primitives::vertex_array_t>,
-                        std::pair<glm::vec3, glm::vec3>>>& vertex_arrays,
-  const aiScene* ai_scene) {
-    auto transform = mat4_cast(ai_node->mTransformation);
-    auto new_entity = this->create_entity(ai_node->mName.C_Str(), transform);
-    parent.add_child(new_entity);
+std::optional<std::vector<import_job_t::reimported_mesh_t>>
+  import_job_t::reimport_meshes(import_job_t& reimport) {
+    if (reimport._preparing.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        return std::nullopt;
+    auto prepared = reimport._preparing.get();
+    auto& scene = prepared->scene;
+    std::vector<reimported_mesh_t> meshes{};
+    meshes.reserve(scene.meshes.size());
+    for (size_t mesh_ix = 0; mesh_ix < scene.meshes.size(); mesh_ix++) {
+        const auto& mesh = scene.meshes[mesh_ix];
+        if (const auto source_ix = scene.geometry_sources[mesh_ix]; source_ix != mesh_ix) {
+            meshes.push_back({meshes[source_ix].vertex_array, mesh.aabb});
+        } else {
+            meshes.push_back({mesh.upload(phong_material_t::get_shader_s()), mesh.aabb});
+            scene.release_mesh_data(mesh_ix);
+        }
+    }
+    return meshes;
+}
 
-    add_mesh_and_bb_components(*this, new_entity, ai_node, materials, vertex_arrays, ai_scene);
+std::optional<entity_t> import_job_t::get_root() const {
+    if (_root == entt::null) return std::nullopt;
+    return entity_t{_root, _scene};
+}
 
-    for (unsigned int child_ix = 0; child_ix < ai_node->mNumChildren; child_ix++) {
-        hierarchy_import_rec(new_entity, ai_node->mChildren[child_ix], materials, vertex_arrays,
-                             ai_scene);
+std::optional<entity_t> scene_t::import_from_file(const std::filesystem::path& scene_file,
+                                                  const import_options_t& options) {
+    import_job_t job{*this, scene_file, options};
+    try {
+        job._prepared = job.prepare();
+    } catch (const std::exception& e) {
+        spdlog::error(e.what());
+        return std::nullopt;
     }
+    job.process(std::chrono::steady_clock::time_point::max());
+    return job.get_root();
 }
+
+std::shared_ptr<import_job_t> scene_t::import_from_file_async(
+  const std::filesystem::path& scene_file, const import_options_t& options) {
+    auto job = std::make_shared<import_job_t>(*this, scene_file, options);
+    // the future in the job owns the task, so it holds the job only while running, a job
+    // dropped before it starts isn't read at all
+    job->_preparing = get_import_pool().submit(
+      [weak_job = std::weak_ptr{job}]() -> std::unique_ptr<import_job_t::prepared_t> {
+          auto job = weak_job.lock();
+          if (!job) return nullptr;
+          return job->prepare();
+      });
+    _imports.push_back(job);
+    return job;
+}
+
+void scene_t::process_imports() {
+    if (_imports.empty()) return;
+    const auto deadline
+      = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<float, std::milli>{_import_frame_budget_ms});
+    std::erase_if(_imports, [deadline](const auto& job) { return job->process(deadline); });
+}
+
 } // namespace pgre::scene
@@ -0,0 +1,63 @@
+#include <scene/vfs_io_system.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace pgre::scene {
+
+namespace {
+    /**
+     * @brief Stream over the contents of a vfs_file_t.
+     */
+    class vfs_io_stream_t : public Assimp::IOStream
+    {
+        vfs_file_t _file;
+        size_t _position = 0;
+
+    public:
+        explicit vfs_io_stream_t(vfs_file_t&& file) : _file(std::move(file)) {}
+
+        size_t Read(void* buffer, size_t size, size_t count) override {
+            if (size == 0) return 0;
+            count = std::min(count, (_file.get_size() - _position) / size);
+            std::memcpy(buffer, _file.get_data().data() + _position, size * count);
+            _position += size * count;
+            return count;
+        }
+
+        size_t Write(const void* /*buffer*/, size_t /*size*/, size_t /*count*/) override {
+            return 0;
+        }
+
+        aiReturn Seek(size_t offset, aiOrigin origin) override {
+            size_t position{};
+            switch (origin) {
+                case aiOrigin_SET: position = offset; break;
+                case aiOrigin_CUR: position = _position + offset; break;
+                case aiOrigin_END: position = _file.get_size() - offset; break;
+                default: return aiReturn_FAILURE;
+            }
+            if (position > _file.get_size()) return aiReturn_FAILURE;
+            _position = position;
+            return aiReturn_SUCCESS;
+        }
+
+        [[nodiscard]] size_t Tell() const override { return _position; }
+        [[nodiscard]] size_t FileSize() const override { return _file.get_size(); }
+        void Flush() override {}
+    };
+} // namespace
+
+bool vfs_io_system_t::Exists(const char* file) const { return vfs_t::get().exists(file); }
+
+Assimp::IOStream* vfs_io_system_t::Open(const char* file, const char* mode) {
+    if (std::string_view{mode}.find_first_of("wa+") != std::string_view::npos) return nullptr;
+    auto opened = vfs_t::get().open(file);
+    if (!opened) return nullptr;
+    return new vfs_io_stream_t{std::move(*opened)};
+}
+
+void vfs_io_system_t::Close(Assimp::IOStream* stream) { delete stream; }
+
+} // namespace pgre::scene
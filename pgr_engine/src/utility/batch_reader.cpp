@@ -0,0 +1,303 @@
+#include <utility/batch_reader.h>
+#include <utility/call_at_scope_exit.h>
+#include <utility/thread_pool.h>
+
+#include <fstream>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PGRE_HAS_IO_URING
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#endif
+
+namespace pgre {
+
+namespace {
+    std::optional<std::vector<std::byte>> read_file(const std::filesystem::path& path) {
+        std::ifstream in{path, std::ios::binary | std::ios::ate};
+        if (!in) return std::nullopt;
+        std::vector<std::byte> contents(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(contents.data()),
+                static_cast<std::streamsize>(contents.size()));
+        if (!in) return std::nullopt;
+        return contents;
+    }
+
+    void read_on_pool(const std::vector<std::filesystem::path>& paths,
+                      const batch_reader_t::on_read_t& on_read) {
+        thread_pool_t::get_global().parallel_for(
+          0, paths.size(), [&](size_t ix) { on_read(ix, read_file(paths[ix])); });
+    }
+
+#ifdef PGRE_HAS_IO_URING
+    /**
+     * @brief Submission and completion rings of an io_uring instance, set up with the raw
+     * syscalls so liburing isn't needed.
+     */
+    class io_uring_t
+    {
+        int _fd = -1;
+        io_uring_params _params{};
+        void* _sq_ring = MAP_FAILED;
+        size_t _sq_ring_size = 0;
+        void* _cq_ring = MAP_FAILED;
+        size_t _cq_ring_size = 0;
+        io_uring_sqe* _sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        size_t _sqes_size = 0;
+        unsigned _to_submit = 0;
+
+        template<typename T>
+        T* at(void* ring, uint32_t offset) {
+            return reinterpret_cast<T*>(static_cast<std::byte*>(ring) + offset);
+        }
+        // the kernel reads and writes the ring indices concurrently
+        std::atomic_ref<unsigned> sq_tail() {
+            return std::atomic_ref{*at<unsigned>(_sq_ring, _params.sq_off.tail)};
+        }
+        std::atomic_ref<unsigned> cq_head() {
+            return std::atomic_ref{*at<unsigned>(_cq_ring, _params.cq_off.head)};
+        }
+        std::atomic_ref<unsigned> cq_tail() {
+            return std::atomic_ref{*at<unsigned>(_cq_ring, _params.cq_off.tail)};
+        }
+
+        io_uring_t() = default;
+
+    public:
+        /**
+         * @return nullptr if the kernel doesn't support io_uring or it's not permitted.
+         */
+        static std::unique_ptr<io_uring_t> create(unsigned entry_count) {
+            std::unique_ptr<io_uring_t> ring{new io_uring_t{}};
+            auto& params = ring->_params;
+            ring->_fd = static_cast<int>(syscall(__NR_io_uring_setup, entry_count, &params));
+            if (ring->_fd < 0) return nullptr;
+
+            ring->_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            ring->_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+                ring->_sq_ring_size = ring->_cq_ring_size
+                  = std::max(ring->_sq_ring_size, ring->_cq_ring_size);
+
+            ring->_sq_ring = mmap(nullptr, ring->_sq_ring_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring->_fd, IORING_OFF_SQ_RING);
+            if (ring->_sq_ring == MAP_FAILED) return nullptr;
+            if (single_mmap) {
+                ring->_cq_ring = ring->_sq_ring;
+            } else {
+                ring->_cq_ring = mmap(nullptr, ring->_cq_ring_size, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, ring->_fd, IORING_OFF_CQ_RING);
+                if (ring->_cq_ring == MAP_FAILED) return nullptr;
+            }
+            ring->_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            ring->_sqes = static_cast<io_uring_sqe*>(
+              mmap(nullptr, ring->_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring->_fd, IORING_OFF_SQES));
+            if (ring->_sqes == MAP_FAILED) return nullptr;
+            return ring;
+        }
+
+        ~io_uring_t() {
+            if (_sqes != MAP_FAILED) munmap(_sqes, _sqes_size);
+            if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring) munmap(_cq_ring, _cq_ring_size);
+            if (_sq_ring != MAP_FAILED) munmap(_sq_ring, _sq_ring_size);
+            if (_fd >= 0) close(_fd);
+        }
+
+        io_uring_t(const io_uring_t&) = delete;
+        io_uring_t& operator=(const io_uring_t&) = delete;
+
+        /**
+         * @brief Number of requests that can be in flight at once, the completion ring is
+         * never overflowed as long as no more are.
+         */
+        [[nodiscard]] unsigned get_entry_count() const { return _params.sq_entries; }
+
+        /**
+         * @brief Queues a readv request, submitted by the next submit_and_wait(). The iovec must
+         * stay valid until it's submitted, the buffer until it completes.
+         */
+        void push_readv(int fd, const iovec* vec, uint64_t offset, uint64_t user_data) {
+            const auto mask = *at<unsigned>(_sq_ring, _params.sq_off.ring_mask);
+            const auto tail = sq_tail().load(std::memory_order_relaxed);
+            const auto slot = tail & mask;
+            auto& sqe = _sqes[slot];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = fd;
+            sqe.addr = reinterpret_cast<uint64_t>(vec);
+            sqe.len = 1;
+            sqe.off = offset;
+            sqe.user_data = user_data;
+            at<unsigned>(_sq_ring, _params.sq_off.array)[slot] = slot;
+            sq_tail().store(tail + 1, std::memory_order_release);
+            _to_submit++;
+        }
+
+        /**
+         * @brief Submits the queued requests and waits for at least one completion.
+         *
+         * @throws std::runtime_error if io_uring_enter fails.
+         */
+        void submit_and_wait() {
+            while (true) {
+                const auto submitted
+                  = syscall(__NR_io_uring_enter, _fd, _to_submit, 1, IORING_ENTER_GETEVENTS,
+                            nullptr, 0);
+                if (submitted >= 0) {
+                    _to_submit -= static_cast<unsigned>(submitted);
+                    return;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    throw std::runtime_error(
+                      fmt::format("io_uring_enter failed: {}", std::strerror(errno)));
+            }
+        }
+
+        /**
+         * @brief Calls func(user_data, result) for each available completion, and frees them.
+         */
+        template<typename FuncTy>
+        void reap(FuncTy&& func) {
+            const auto mask = *at<unsigned>(_cq_ring, _params.cq_off.ring_mask);
+            const auto* cqes = at<io_uring_cqe>(_cq_ring, _params.cq_off.cqes);
+            auto head = cq_head().load(std::memory_order_relaxed);
+            const auto tail = cq_tail().load(std::memory_order_acquire);
+            for (; head != tail; head++) {
+                const auto& cqe = cqes[head & mask];
+                func(cqe.user_data, cqe.res);
+            }
+            cq_head().store(head, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief A file being read, requeued until all of it is read since reads may be short.
+     */
+    struct pending_read_t
+    {
+        int fd = -1;
+        std::vector<std::byte> contents{};
+        size_t read_size = 0;
+        iovec vec{};
+    };
+
+    void read_with_io_uring(io_uring_t& ring, const std::vector<std::filesystem::path>& paths,
+                            const batch_reader_t::on_read_t& on_read) {
+        // single reads are limited to what fits in an int result
+        constexpr size_t max_read_size = size_t{1} << 30;
+
+        std::vector<pending_read_t> reads(paths.size());
+        // files left open by a failure of the ring
+        call_at_scope_exit_t close_files{[&reads]() {
+            for (const auto& read : reads) {
+                if (read.fd >= 0) close(read.fd);
+            }
+        }};
+        std::deque<size_t> queue{};
+        size_t remaining = paths.size();
+        const auto finish = [&](size_t ix, bool success) {
+            auto& read = reads[ix];
+            if (read.fd >= 0) close(read.fd);
+            read.fd = -1;
+            remaining--;
+            if (success) {
+                on_read(ix, std::move(read.contents));
+            } else {
+                on_read(ix, std::nullopt);
+            }
+            read.contents = {};
+        };
+
+        for (size_t ix = 0; ix < paths.size(); ix++) {
+            auto& read = reads[ix];
+            read.fd = open(paths[ix].c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat file_stat{};
+            if (read.fd < 0 || fstat(read.fd, &file_stat) != 0) {
+                finish(ix, false);
+                continue;
+            }
+            read.contents.resize(static_cast<size_t>(file_stat.st_size));
+            if (read.contents.empty()) {
+                finish(ix, true);
+                continue;
+            }
+            queue.push_back(ix);
+        }
+
+        unsigned in_flight = 0;
+        while (remaining > 0) {
+            while (!queue.empty() && in_flight < ring.get_entry_count()) {
+                const auto ix = queue.front();
+                queue.pop_front();
+                auto& read = reads[ix];
+                read.vec.iov_base = read.contents.data() + read.read_size;
+                read.vec.iov_len = std::min(read.contents.size() - read.read_size, max_read_size);
+                ring.push_readv(read.fd, &read.vec, read.read_size, ix);
+                in_flight++;
+            }
+            ring.submit_and_wait();
+            ring.reap([&](uint64_t ix, int32_t result) {
+                in_flight--;
+                auto& read = reads[ix];
+                if (result == -EINTR || result == -EAGAIN) {
+                    queue.push_back(ix);
+                } else if (result < 0) {
+                    finish(ix, false);
+                } else if (result == 0) {
+                    // the file was truncated since it was opened
+                    read.contents.resize(read.read_size);
+                    finish(ix, true);
+                } else if ((read.read_size += static_cast<size_t>(result))
+                           == read.contents.size()) {
+                    finish(ix, true);
+                } else {
+                    queue.push_front(ix);
+                }
+            });
+        }
+    }
+
+    constexpr unsigned ring_entry_count = 64;
+#endif
+} // namespace
+
+void batch_reader_t::read(const std::vector<std::filesystem::path>& paths,
+                          const on_read_t& on_read) {
+    if (paths.empty()) return;
+#ifdef PGRE_HAS_IO_URING
+    if (auto ring = io_uring_t::create(ring_entry_count)) {
+        read_with_io_uring(*ring, paths, on_read);
+        return;
+    }
+#endif
+    read_on_pool(paths, on_read);
+}
+
+bool batch_reader_t::is_io_uring_available() {
+#ifdef PGRE_HAS_IO_URING
+    static const bool available = io_uring_t::create(1) != nullptr;
+    return available;
+#else
+    return false;
+#endif
+}
+
+} // namespace pgre
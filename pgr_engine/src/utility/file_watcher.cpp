@@ -0,0 +1,109 @@
+#include <utility/file_watcher.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace pgre {
+
+#ifdef __linux__
+
+namespace {
+    // files are reported once a writer closes them, or once renamed into place as editors do
+    // and the .pgtex and .pgmesh caches are, never while partly written
+    constexpr uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+} // namespace
+
+file_watcher_t::file_watcher_t() : _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+file_watcher_t::~file_watcher_t() {
+    if (_fd >= 0) close(_fd);
+}
+
+bool file_watcher_t::is_supported() { return true; }
+
+void file_watcher_t::add_watch(const std::filesystem::path& directory) {
+    const int wd = inotify_add_watch(_fd, directory.c_str(), watch_mask);
+    if (wd < 0)
+        throw std::runtime_error(
+          fmt::format("Failed to watch {}: {}", directory.string(), std::strerror(errno)));
+    _directories.insert_or_assign(wd, directory);
+}
+
+void file_watcher_t::watch(const std::filesystem::path& directory) {
+    if (_fd < 0)
+        throw std::runtime_error(fmt::format("Failed to initialize inotify: {}",
+                                             std::strerror(errno)));
+    const auto root = std::filesystem::absolute(directory).lexically_normal();
+    add_watch(root);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_directory()) add_watch(entry.path());
+    }
+}
+
+std::vector<std::filesystem::path> file_watcher_t::poll() {
+    std::vector<std::filesystem::path> changed{};
+    if (_fd < 0) return changed;
+
+    alignas(inotify_event) std::array<char, 4096> buffer{};
+    ssize_t size{};
+    while ((size = read(_fd, buffer.data(), buffer.size())) > 0) {
+        for (ssize_t offset = 0; offset < size;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_IGNORED) {
+                _directories.erase(event->wd);
+                continue;
+            }
+            auto it = _directories.find(event->wd);
+            if (it == _directories.end() || event->len == 0) continue;
+            auto path = it->second / event->name;
+            if (event->mask & IN_ISDIR) {
+                // files written into a new directory before it's watched are missed
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    try {
+                        watch(path);
+                    } catch (const std::exception&) {
+                        // removed again already
+                    }
+                }
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                if (std::ranges::find(changed, path) == changed.end())
+                    changed.push_back(std::move(path));
+            }
+        }
+    }
+    return changed;
+}
+
+#else
+
+file_watcher_t::file_watcher_t() = default;
+file_watcher_t::~file_watcher_t() = default;
+
+bool file_watcher_t::is_supported() { return false; }
+
+void file_watcher_t::add_watch(const std::filesystem::path& /*directory*/) {}
+
+void file_watcher_t::watch(const std::filesystem::path& directory) {
+    throw std::runtime_error(
+      fmt::format("Can't watch {}, file watching isn't supported on this platform",
+                  directory.string()));
+}
+
+std::vector<std::filesystem::path> file_watcher_t::poll() { return {}; }
+
+#endif
+
+} // namespace pgre
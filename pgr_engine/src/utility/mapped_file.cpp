@@ -0,0 +1,117 @@
+#include <utility/mapped_file.h>
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pgre {
+
+#ifdef _WIN32
+
+std::optional<mapped_file_t> mapped_file_t::map(const std::filesystem::path& path) {
+    mapped_file_t file{};
+    file._file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file._file_handle == INVALID_HANDLE_VALUE) {
+        file._file_handle = nullptr;
+        return std::nullopt;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file._file_handle, &size)) return std::nullopt;
+    file._size = static_cast<size_t>(size.QuadPart);
+    // empty files can't be mapped
+    if (file._size == 0) return file;
+
+    file._mapping_handle
+      = CreateFileMappingW(file._file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file._mapping_handle == nullptr) return std::nullopt;
+    file._data = static_cast<const std::byte*>(
+      MapViewOfFile(file._mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (file._data == nullptr) return std::nullopt;
+    return file;
+}
+
+void mapped_file_t::unmap() {
+    if (_data != nullptr) UnmapViewOfFile(_data);
+    if (_mapping_handle != nullptr) CloseHandle(_mapping_handle);
+    if (_file_handle != nullptr) CloseHandle(_file_handle);
+    _data = nullptr;
+    _mapping_handle = nullptr;
+    _file_handle = nullptr;
+    _size = 0;
+}
+
+mapped_file_t::mapped_file_t(mapped_file_t&& other) noexcept
+  : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)),
+    _file_handle(std::exchange(other._file_handle, nullptr)),
+    _mapping_handle(std::exchange(other._mapping_handle, nullptr)) {}
+
+mapped_file_t& mapped_file_t::operator=(mapped_file_t&& other) noexcept {
+    if (this == &other) return *this;
+    unmap();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    _file_handle = std::exchange(other._file_handle, nullptr);
+    _mapping_handle = std::exchange(other._mapping_handle, nullptr);
+    return *this;
+}
+
+#else
+
+std::optional<mapped_file_t> mapped_file_t::map(const std::filesystem::path& path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor == -1) return std::nullopt;
+    struct stat info
+    {};
+    if (fstat(descriptor, &info) == -1) {
+        close(descriptor);
+        return std::nullopt;
+    }
+
+    mapped_file_t file{};
+    file._size = static_cast<size_t>(info.st_size);
+    // empty files can't be mapped
+    if (file._size != 0) {
+        void* data = mmap(nullptr, file._size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data == MAP_FAILED) {
+            close(descriptor);
+            return std::nullopt;
+        }
+        file._data = static_cast<const std::byte*>(data);
+    }
+    // the mapping stays valid without the descriptor
+    close(descriptor);
+    return file;
+}
+
+void mapped_file_t::unmap() {
+    if (_data != nullptr) munmap(const_cast<std::byte*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+mapped_file_t::mapped_file_t(mapped_file_t&& other) noexcept
+  : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+mapped_file_t& mapped_file_t::operator=(mapped_file_t&& other) noexcept {
+    if (this == &other) return *this;
+    unmap();
+    _data = std::exchange(other._data, nullptr);
+    _size = std::exchange(other._size, 0);
+    return *this;
+}
+
+#endif
+
+mapped_file_t::~mapped_file_t() { unmap(); }
+
+} // namespace pgre
@@ -0,0 +1,36 @@
+#include <utility/task.h>
+
+namespace pgre {
+
+gl_thread_queue_t& gl_thread_queue_t::get() {
+    static gl_thread_queue_t queue{};
+    return queue;
+}
+
+void gl_thread_queue_t::set_gl_thread() {
+    std::lock_guard lock{_mutex};
+    _gl_thread_id = std::this_thread::get_id();
+}
+
+bool gl_thread_queue_t::is_gl_thread() const {
+    // set once at startup, before any coroutine runs
+    return _gl_thread_id == std::this_thread::get_id();
+}
+
+void gl_thread_queue_t::post(std::coroutine_handle<> handle) {
+    std::lock_guard lock{_mutex};
+    _pending.push_back(handle);
+}
+
+void gl_thread_queue_t::run_pending() {
+    std::vector<std::coroutine_handle<>> pending{};
+    {
+        std::lock_guard lock{_mutex};
+        pending.swap(_pending);
+    }
+    for (auto handle : pending) {
+        handle.resume();
+    }
+}
+
+} // namespace pgre
@@ -0,0 +1,40 @@
+#include <utility/thread_pool.h>
+
+namespace pgre {
+
+thread_pool_t::thread_pool_t(size_t thread_count) {
+    _workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+        _workers.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+thread_pool_t::~thread_pool_t() {
+    {
+        std::lock_guard lock{_mutex};
+        _stopping = true;
+    }
+    _task_available.notify_all();
+    for (auto& worker : _workers) worker.join();
+}
+
+thread_pool_t& thread_pool_t::get_global() {
+    static thread_pool_t pool{};
+    return pool;
+}
+
+void thread_pool_t::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{_mutex};
+            _task_available.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+            if (_tasks.empty()) return; // stopping and nothing left to do
+            task = std::move(_tasks.front());
+            _tasks.pop();
+        }
+        task();
+    }
+}
+
+} // namespace pgre
@@ -0,0 +1,315 @@
+#include <utility/batch_reader.h>
+#include <utility/hash.h>
+#include <utility/thread_pool.h>
+#include <utility/vfs.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace pgre {
+
+namespace {
+    struct pak_header_t
+    {
+        std::array<char, 4> magic;
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t reserved;
+    };
+
+    /**
+     * @brief Get the path relative to root, with '/' separators, nullopt if it isn't under
+     * root.
+     */
+    std::optional<std::string> get_key(const std::filesystem::path& path,
+                                       const std::filesystem::path& root) {
+        auto relative
+          = std::filesystem::absolute(path).lexically_normal().lexically_relative(root);
+        if (relative.empty() || *relative.begin() == "..") return std::nullopt;
+        return relative.generic_string();
+    }
+
+    std::filesystem::path get_root(const std::filesystem::path& root) {
+        return (root.empty() ? std::filesystem::current_path() : std::filesystem::absolute(root))
+          .lexically_normal();
+    }
+
+    uint64_t align_offset(uint64_t offset) {
+        constexpr auto alignment = pak_archive_t::entry_alignment;
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    std::string get_prefetch_key(const std::filesystem::path& path) {
+        return std::filesystem::absolute(path).lexically_normal().string();
+    }
+
+    /**
+     * @brief Single thread pool prefetches run on, batch_reader_t::read blocks and uses the
+     * global pool itself.
+     */
+    thread_pool_t& get_prefetch_pool() {
+        static thread_pool_t pool{1};
+        return pool;
+    }
+} // namespace
+
+pak_archive_t pak_archive_t::open(const std::filesystem::path& path) {
+    auto mapping = mapped_file_t::map(path);
+    if (!mapping) throw std::runtime_error(fmt::format("Failed to map {}", path.string()));
+    pak_archive_t archive{std::move(*mapping)};
+
+    const auto data = archive._mapping.get_data();
+    size_t offset = 0;
+    const auto read = [&](void* value, size_t size) {
+        if (size > data.size() - offset)
+            throw std::runtime_error(fmt::format("Truncated .pak file {}", path.string()));
+        std::memcpy(value, data.data() + offset, size);
+        offset += size;
+    };
+
+    pak_header_t header{};
+    read(&header, sizeof(header));
+    if (header.magic != magic || header.version != format_version)
+        throw std::runtime_error(
+          fmt::format("{} isn't a .pak file of version {}", path.string(), format_version));
+
+    archive._entries.reserve(header.entry_count);
+    for (uint32_t i = 0; i < header.entry_count; i++) {
+        entry_t entry{};
+        uint32_t key_size{};
+        read(&entry.offset, sizeof(entry.offset));
+        read(&entry.size, sizeof(entry.size));
+        read(&entry.hash, sizeof(entry.hash));
+        read(&key_size, sizeof(key_size));
+        std::string key(key_size, '\0');
+        read(key.data(), key_size);
+        offset += (4 - key_size % 4) % 4;
+        if (entry.offset > data.size() || entry.size > data.size() - entry.offset)
+            throw std::runtime_error(
+              fmt::format("Entry {} exceeds the .pak file {}", key, path.string()));
+        archive._entries.insert_or_assign(std::move(key), entry);
+    }
+    return archive;
+}
+
+void pak_archive_t::write(const std::filesystem::path& path, const std::filesystem::path& root,
+                          const std::vector<std::filesystem::path>& files) {
+    const auto root_path = get_root(root);
+    std::vector<std::string> keys{};
+    std::vector<mapped_file_t> mappings{};
+    for (const auto& file : files) {
+        auto key = get_key(file, root_path);
+        if (!key)
+            throw std::runtime_error(
+              fmt::format("{} isn't under {}", file.string(), root_path.string()));
+        auto mapping = mapped_file_t::map(file);
+        if (!mapping) throw std::runtime_error(fmt::format("Failed to map {}", file.string()));
+        keys.push_back(std::move(*key));
+        mappings.push_back(std::move(*mapping));
+    }
+
+    // the table of contents comes first, its size decides where the data starts
+    uint64_t toc_size = sizeof(pak_header_t);
+    for (const auto& key : keys) {
+        toc_size += 3 * sizeof(uint64_t) + sizeof(uint32_t) + (key.size() + 3) / 4 * 4;
+    }
+    std::vector<uint64_t> offsets{};
+    uint64_t offset = toc_size;
+    for (const auto& mapping : mappings) {
+        offset = align_offset(offset);
+        offsets.push_back(offset);
+        offset += mapping.get_size();
+    }
+
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    if (!out)
+        throw std::runtime_error(fmt::format("Failed to open {} for writing", path.string()));
+    const auto write_bytes = [&out](const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+    constexpr std::array<char, entry_alignment> padding{};
+
+    pak_header_t header{magic, format_version, static_cast<uint32_t>(keys.size()), 0};
+    write_bytes(&header, sizeof(header));
+    for (size_t i = 0; i < keys.size(); i++) {
+        const auto data = mappings[i].get_data();
+        const uint64_t size = data.size();
+        const uint64_t hash = hash_bytes(data.data(), data.size());
+        const auto key_size = static_cast<uint32_t>(keys[i].size());
+        write_bytes(&offsets[i], sizeof(offsets[i]));
+        write_bytes(&size, sizeof(size));
+        write_bytes(&hash, sizeof(hash));
+        write_bytes(&key_size, sizeof(key_size));
+        write_bytes(keys[i].data(), key_size);
+        write_bytes(padding.data(), (4 - key_size % 4) % 4);
+    }
+    uint64_t written = toc_size;
+    for (size_t i = 0; i < mappings.size(); i++) {
+        write_bytes(padding.data(), offsets[i] - written);
+        write_bytes(mappings[i].get_data().data(), mappings[i].get_size());
+        written = offsets[i] + mappings[i].get_size();
+    }
+    if (!out) throw std::runtime_error(fmt::format("Failed to write {}", path.string()));
+}
+
+const pak_archive_t::entry_t* pak_archive_t::find_entry(const std::string& key) const {
+    auto it = _entries.find(key);
+    return it == _entries.end() ? nullptr : &it->second;
+}
+
+vfs_t& vfs_t::get() {
+    static vfs_t vfs{};
+    return vfs;
+}
+
+void vfs_t::mount(const std::filesystem::path& pak_path, const std::filesystem::path& root) {
+    auto archive = std::make_shared<const pak_archive_t>(pak_archive_t::open(pak_path));
+    std::unique_lock lock{_mutex};
+    _mounts.push_back({std::move(archive), get_root(root)});
+}
+
+void vfs_t::unmount_all() {
+    std::unique_lock lock{_mutex};
+    _mounts.clear();
+}
+
+std::optional<std::pair<std::shared_ptr<const pak_archive_t>, pak_archive_t::entry_t>>
+  vfs_t::find(const std::filesystem::path& path) const {
+    std::shared_lock lock{_mutex};
+    for (auto it = _mounts.rbegin(); it != _mounts.rend(); ++it) {
+        auto key = get_key(path, it->root);
+        if (!key) continue;
+        if (const auto* entry = it->archive->find_entry(*key))
+            return std::make_pair(it->archive, *entry);
+    }
+    return std::nullopt;
+}
+
+void vfs_t::prefetch(const std::vector<std::filesystem::path>& paths) {
+    using promise_t = std::promise<std::shared_ptr<const std::vector<std::byte>>>;
+    auto promises = std::make_shared<std::vector<promise_t>>();
+    std::vector<std::filesystem::path> loose_paths{};
+    {
+        std::lock_guard lock{_prefetch_mutex};
+        for (const auto& path : paths) {
+            if (find(path)) continue;
+            auto key = get_prefetch_key(path);
+            if (_prefetched.contains(key)) continue;
+            _prefetched.emplace(std::move(key),
+                                prefetched_entry_t{promises->emplace_back().get_future().share()});
+            loose_paths.push_back(path);
+        }
+    }
+    if (loose_paths.empty()) return;
+
+    get_prefetch_pool().submit([paths = std::move(loose_paths), promises]() {
+        // files not read yet are mapped when opened, a broken promise would fail their open()
+        const auto set_unread = [&promises]() {
+            for (auto& promise : *promises) {
+                try {
+                    promise.set_value(nullptr);
+                } catch (const std::future_error&) {}
+            }
+        };
+        try {
+            batch_reader_t::read(paths, [&promises](size_t ix, auto&& contents) {
+                (*promises)[ix].set_value(
+                  contents ? std::make_shared<const std::vector<std::byte>>(std::move(*contents))
+                           : nullptr);
+            });
+        } catch (const std::exception& e) {
+            spdlog::warn("Prefetching failed: {}", e.what());
+            set_unread();
+        } catch (...) {
+            spdlog::warn("Prefetching failed");
+            set_unread();
+        }
+    });
+}
+
+void vfs_t::drop_prefetched() {
+    std::lock_guard lock{_prefetch_mutex};
+    for (auto it = _prefetched.begin(); it != _prefetched.end();) {
+        it->second.dropped = true;
+        it = it->second.hold_count == 0 ? _prefetched.erase(it) : std::next(it);
+    }
+}
+
+void vfs_t::hold_prefetched(const std::vector<std::filesystem::path>& paths) {
+    std::lock_guard lock{_prefetch_mutex};
+    if (_prefetched.empty()) return;
+    for (const auto& path : paths) {
+        auto it = _prefetched.find(get_prefetch_key(path));
+        if (it != _prefetched.end()) it->second.hold_count++;
+    }
+}
+
+void vfs_t::release_prefetched(const std::vector<std::filesystem::path>& paths) {
+    std::lock_guard lock{_prefetch_mutex};
+    if (_prefetched.empty()) return;
+    for (const auto& path : paths) {
+        // entries opened meanwhile are gone already
+        auto it = _prefetched.find(get_prefetch_key(path));
+        if (it == _prefetched.end() || it->second.hold_count == 0) continue;
+        if (--it->second.hold_count == 0 && it->second.dropped) _prefetched.erase(it);
+    }
+}
+
+std::optional<vfs_t::prefetched_t> vfs_t::find_prefetched(const std::filesystem::path& path,
+                                                          bool take) const {
+    std::lock_guard lock{_prefetch_mutex};
+    if (_prefetched.empty()) return std::nullopt;
+    auto it = _prefetched.find(get_prefetch_key(path));
+    if (it == _prefetched.end()) return std::nullopt;
+    auto prefetched = it->second.contents;
+    if (take) _prefetched.erase(it);
+    return prefetched;
+}
+
+std::optional<vfs_file_t> vfs_t::open(const std::filesystem::path& path) const {
+    if (auto found = find(path)) {
+        auto data = found->first->get_data(found->second);
+        return vfs_file_t{std::move(found->first), data};
+    }
+    if (auto prefetched = find_prefetched(path, true)) {
+        if (auto contents = prefetched->get()) return vfs_file_t{std::move(contents)};
+    }
+    auto mapping = mapped_file_t::map(path);
+    if (!mapping) return std::nullopt;
+    return vfs_file_t{std::move(*mapping)};
+}
+
+std::optional<vfs_file_t> vfs_t::peek(const std::filesystem::path& path) const {
+    if (auto found = find(path)) {
+        auto data = found->first->get_data(found->second);
+        return vfs_file_t{std::move(found->first), data};
+    }
+    // waiting for the whole batch would take longer than mapping the file
+    if (auto prefetched = find_prefetched(path, false);
+        prefetched && prefetched->wait_for(std::chrono::seconds{0}) == std::future_status::ready) {
+        if (auto contents = prefetched->get()) return vfs_file_t{std::move(contents)};
+    }
+    auto mapping = mapped_file_t::map(path);
+    if (!mapping) return std::nullopt;
+    return vfs_file_t{std::move(*mapping)};
+}
+
+bool vfs_t::exists(const std::filesystem::path& path) const {
+    if (find(path)) return true;
+    std::error_code err{};
+    return std::filesystem::is_regular_file(path, err);
+}
+
+std::optional<pak_archive_t::entry_t>
+  vfs_t::find_archived(const std::filesystem::path& path) const {
+    if (auto found = find(path)) return found->second;
+    return std::nullopt;
+}
+
+} // namespace pgre